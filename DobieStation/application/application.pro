@@ -34,6 +34,8 @@ INSTALLS += target
 
 SOURCES += ../../src/qt/main.cpp \
     ../../src/core/audio/utils.cpp \
+    ../../src/core/audio/audio_output.cpp \
+    ../../src/core/audio/audio_sink.cpp \
     ../../src/core/errors.cpp \
     ../../src/core/ee/emotion.cpp \
     ../../src/core/emulator.cpp \
@@ -75,6 +77,7 @@ SOURCES += ../../src/qt/main.cpp \
     ../../src/core/iop/spu/spu_interpolate.cpp \
     ../../src/core/iop/spu/spu_reverb.cpp \
     ../../src/qt/emuthread.cpp \
+    ../../src/qt/audiodevice.cpp \
     ../../src/core/tests/iop/alu.cpp \
     ../../src/core/ee/vif.cpp \
     ../../src/core/ee/ipu/ipu.cpp \
@@ -124,6 +127,8 @@ SOURCES += ../../src/qt/main.cpp \
 
 HEADERS += \
     ../../src/core/audio/utils.hpp \
+    ../../src/core/audio/audio_output.hpp \
+    ../../src/core/audio/audio_sink.hpp \
     ../../src/core/errors.hpp \
     ../../src/core/ee/emotion.hpp \
     ../../src/core/emulator.hpp \
@@ -161,6 +166,7 @@ HEADERS += \
     ../../src/core/iop/spu/spu_envelope.hpp \
     ../../src/core/iop/spu/spu_utils.hpp \
     ../../src/qt/emuthread.hpp \
+    ../../src/qt/audiodevice.hpp \
     ../../src/core/ee/vif.hpp \
     ../../src/core/int128.hpp \
     ../../src/core/ee/ipu/ipu.hpp \
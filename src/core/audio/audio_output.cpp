@@ -0,0 +1,72 @@
+#include <chrono>
+#include "audio_output.hpp"
+
+void TimeStretcher::reset()
+{
+    prev = {};
+    next = {};
+    pos = 0.0;
+}
+
+AudioOutput::AudioOutput() : running(false)
+{
+    stretcher.reset();
+}
+
+AudioOutput::~AudioOutput()
+{
+    stop();
+}
+
+void AudioOutput::start(std::unique_ptr<AudioSink> new_sink)
+{
+    stop();
+
+    stereo_sample discard[512];
+    while (ring.pop(discard, 512));
+
+    sink = std::move(new_sink);
+    stretcher.reset();
+    running = true;
+    consumer = std::thread(&AudioOutput::consumer_loop, this);
+}
+
+void AudioOutput::stop()
+{
+    if (!running)
+        return;
+
+    running = false;
+    consumer.join();
+    sink.reset();
+}
+
+void AudioOutput::consumer_loop()
+{
+    std::vector<stereo_sample> period(sink->get_period());
+
+    while (running)
+    {
+        stretcher.process(ring, TARGET_FILL, period.data(), period.size());
+        sink->write(period.data(), period.size());
+    }
+}
+
+//Samples that don't fit are dropped, which only happens when nothing paces the emulator to the output
+void AudioOutput::push_samples(const stereo_sample* samples, size_t count)
+{
+    if (running)
+        ring.try_push(samples, count);
+}
+
+//Frame pacing with the output as the clock: blocks until the consumer has played the buffer
+//back down to its target level. Returns false if there's no output to pace against.
+bool AudioOutput::wait_for_space()
+{
+    if (!running)
+        return false;
+
+    while (running && ring.size() > TARGET_FILL)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return true;
+}
@@ -0,0 +1,96 @@
+#ifndef AUDIO_OUTPUT_HPP
+#define AUDIO_OUTPUT_HPP
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "../circularFIFO.hpp"
+#include "audio_sink.hpp"
+
+//Resamples the emulator's output into exactly as many samples as the sink asks for.
+//The rate follows how full the ring is (dynamic rate control): the emulator running a little fast or
+//slow is evened out by a pitch change too small to hear, and running dry fades out instead of clicking.
+class TimeStretcher
+{
+    public:
+        //How far the rate may stray from 1:1
+        constexpr static double MAX_RATE_ADJUST = 0.05;
+
+        void reset();
+        template <typename Ring>
+        void process(Ring& ring, size_t target_fill, stereo_sample* out, size_t count);
+    private:
+        stereo_sample prev, next;
+        double pos;
+};
+
+//Carries the SPU2's output to an AudioSink on a thread of its own, decoupled from emulation speed
+class AudioOutput
+{
+    public:
+        constexpr static size_t RING_SIZE = 16384;
+        //Amount kept buffered, about 85 ms
+        constexpr static size_t TARGET_FILL = 4096;
+
+        AudioOutput();
+        ~AudioOutput();
+
+        void start(std::unique_ptr<AudioSink> sink);
+        void stop();
+        bool is_running();
+
+        //Emulation thread side
+        void push_samples(const stereo_sample* samples, size_t count);
+        size_t get_buffered_samples();
+        bool wait_for_space();
+    private:
+        CircularFifo<stereo_sample, RING_SIZE> ring;
+        std::unique_ptr<AudioSink> sink;
+        std::thread consumer;
+        std::atomic_bool running;
+
+        TimeStretcher stretcher;
+
+        void consumer_loop();
+};
+
+inline bool AudioOutput::is_running()
+{
+    return running;
+}
+
+inline size_t AudioOutput::get_buffered_samples()
+{
+    return ring.size();
+}
+
+template <typename Ring>
+void TimeStretcher::process(Ring& ring, size_t target_fill, stereo_sample* out, size_t count)
+{
+    double fill = (double)ring.size();
+    double rate = 1.0 + MAX_RATE_ADJUST * (fill - target_fill) / target_fill;
+    rate = std::max(1.0 - MAX_RATE_ADJUST, std::min(1.0 + MAX_RATE_ADJUST, rate));
+
+    for (size_t i = 0; i < count; i++)
+    {
+        while (pos >= 1.0)
+        {
+            prev = next;
+            if (!ring.pop(next))
+            {
+                //Ran dry, let the last sample die away
+                next.left = (next.left * 15) / 16;
+                next.right = (next.right * 15) / 16;
+            }
+            pos -= 1.0;
+        }
+
+        out[i].left = (int16_t)(prev.left + (next.left - prev.left) * pos);
+        out[i].right = (int16_t)(prev.right + (next.right - prev.right) * pos);
+        pos += rate;
+    }
+}
+
+#endif // AUDIO_OUTPUT_HPP
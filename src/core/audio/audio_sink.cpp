@@ -0,0 +1,36 @@
+#include <thread>
+#include "audio_sink.hpp"
+
+NullAudioSink::NullAudioSink(bool paced) : paced(paced), started(false)
+{
+
+}
+
+void NullAudioSink::write(const stereo_sample* samples, size_t count)
+{
+    if (!paced)
+        return;
+
+    //Keep to an absolute clock so that sleeping late doesn't add up over time
+    auto now = std::chrono::steady_clock::now();
+    if (!started || now - next_write > std::chrono::milliseconds(100))
+    {
+        next_write = now;
+        started = true;
+    }
+
+    next_write += std::chrono::nanoseconds(count * 1000000000ULL / 48000);
+    std::this_thread::sleep_until(next_write);
+}
+
+WAVAudioSink::WAVAudioSink(std::string filename, bool paced) : NullAudioSink(paced), writer(filename)
+{
+
+}
+
+void WAVAudioSink::write(const stereo_sample* samples, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        writer.append_pcm_stereo(samples[i]);
+    NullAudioSink::write(samples, count);
+}
@@ -0,0 +1,46 @@
+#ifndef AUDIO_SINK_HPP
+#define AUDIO_SINK_HPP
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include "utils.hpp"
+
+//Where AudioOutput's consumer thread sends the final mix.
+//A sink for a real device blocks in write until the device has taken the samples,
+//which is what paces the consumer to real time.
+class AudioSink
+{
+    public:
+        virtual ~AudioSink() {}
+
+        //Number of samples handed to write at a time
+        virtual size_t get_period() { return 512; }
+        virtual void write(const stereo_sample* samples, size_t count) = 0;
+};
+
+//Throws samples away. When paced, it takes them at the 48000 Hz rate of a real device,
+//otherwise as fast as they come, which is what headless runs and tests want.
+class NullAudioSink : public AudioSink
+{
+    public:
+        NullAudioSink(bool paced = true);
+
+        void write(const stereo_sample* samples, size_t count) override;
+    private:
+        bool paced;
+        bool started;
+        std::chrono::steady_clock::time_point next_write;
+};
+
+//Records what would have been played to a WAV file
+class WAVAudioSink : public NullAudioSink
+{
+    public:
+        WAVAudioSink(std::string filename, bool paced = false);
+
+        void write(const stereo_sample* samples, size_t count) override;
+    private:
+        WAVWriter writer;
+};
+
+#endif // AUDIO_SINK_HPP
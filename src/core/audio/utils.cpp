@@ -5,6 +5,8 @@
 
 WAVWriter::WAVWriter(std::string filename) : filename(filename)
 {
+    filling.reserve(BLOCK_SAMPLES);
+    writing.reserve(BLOCK_SAMPLES);
 }
 
 void WAVWriter::update_header()
@@ -30,36 +32,77 @@ void WAVWriter::update_header()
     file.write((char*)&sample_size, 2);
 
     file.write((char*)data, 4);
-    uint32_t size = header_size + data_size;
-    file.write((char*)&size, 4);
+    file.write((char*)&data_size, 4);
 }
 
 void WAVWriter::append_pcm_stereo(stereo_sample pcm)
 {
-    cache.push_back(pcm);
+    filling.push_back(pcm);
 
-    if (cache.size() > 0x200)
+    if (filling.size() >= BLOCK_SAMPLES)
+        submit_block();
+}
+
+//Hands the filled block over to the writer thread, waiting if it's still busy with the previous one
+void WAVWriter::submit_block()
+{
+    if (!writer.joinable())
+        writer = std::thread(&WAVWriter::writer_loop, this);
+
+    std::unique_lock<std::mutex> lock(writer_mutex);
+    writer_cv.wait(lock, [this] { return !block_pending; });
+    std::swap(filling, writing);
+    block_pending = true;
+    lock.unlock();
+    writer_cv.notify_all();
+}
+
+void WAVWriter::writer_loop()
+{
+    file.open(filename.c_str(), std::fstream::out | std::fstream::binary);
+    update_header();
+
+    int blocks_written = 0;
+    while (true)
     {
-        if (!file.is_open())
-            file.open(filename.c_str(), std::fstream::out | std::fstream::binary);
+        std::unique_lock<std::mutex> lock(writer_mutex);
+        writer_cv.wait(lock, [this] { return block_pending || quit; });
+        if (!block_pending)
+            break;
+        lock.unlock();
 
+        //stereo_sample is laid out as the interleaved left/right pairs the file wants
         file.seekp(44+data_size);
-        uint32_t samples = (uint32_t)cache.size();
+        file.write((char*)writing.data(), writing.size() * sizeof(stereo_sample));
+        data_size += (uint32_t)writing.size() * 4;
+        writing.clear();
 
-        for (uint32_t i = 0; i < samples; i++)
-        {
-            file.write((char*)&(cache.at(i).left), 2);
-            file.write((char*)&(cache.at(i).right), 2);
-        }
+        blocks_written++;
+        if (blocks_written % HEADER_UPDATE_BLOCKS == 0)
+            update_header();
 
-        data_size += samples * 4;
-
-        update_header();
-        cache.clear();
+        lock.lock();
+        block_pending = false;
+        lock.unlock();
+        writer_cv.notify_all();
     }
+
+    update_header();
+    file.close();
 }
 
 WAVWriter::~WAVWriter()
 {
-    file.close();
+    if (filling.size())
+        submit_block();
+
+    if (writer.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex);
+            quit = true;
+        }
+        writer_cv.notify_all();
+        writer.join();
+    }
 }
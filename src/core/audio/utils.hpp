@@ -1,11 +1,16 @@
 #ifndef __UTILS_H_
 #define __UTILS_H_
 #include "../iop/spu/spu_utils.hpp"
+#include <condition_variable>
 #include <fstream>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <string>
 
 
+//Samples are collected into large blocks, which a thread of its own writes out
+//while the next block fills up, so dumping doesn't hold up emulation.
 class WAVWriter
 {
     public:
@@ -13,7 +18,14 @@ class WAVWriter
         ~WAVWriter();
         void append_pcm_stereo(stereo_sample pcm);
     private:
+        //One second of audio
+        constexpr static size_t BLOCK_SAMPLES = 48000;
+        //The header is patched every few blocks, so that a crash still leaves a playable file
+        constexpr static int HEADER_UPDATE_BLOCKS = 5;
+
         void update_header();
+        void submit_block();
+        void writer_loop();
 
         std::fstream file;
         std::string filename;
@@ -22,7 +34,15 @@ class WAVWriter
         int channels = 2;
         uint16_t sample_size = 16;
 
-        std::vector<stereo_sample> cache;
+        //filling belongs to the emulation thread, writing to the writer thread while block_pending is set
+        std::vector<stereo_sample> filling;
+        std::vector<stereo_sample> writing;
+
+        std::thread writer;
+        std::mutex writer_mutex;
+        std::condition_variable writer_cv;
+        bool block_pending = false;
+        bool quit = false;
 
         const char* data = "data";
         const char* fmt = "fmt ";
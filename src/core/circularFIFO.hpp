@@ -7,6 +7,7 @@ a single bigger queue if at all reasonable though
 #ifndef CIRCULARFIFO_AQUIRE_RELEASE_H_
 #define CIRCULARFIFO_AQUIRE_RELEASE_H_
 
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
 
@@ -21,7 +22,11 @@ public:
     virtual ~CircularFifo() {}
 
     void push(const Element& item); // pushByMOve?
+    void push(const Element* items, size_t count);
+    size_t try_push(const Element* items, size_t count);
     bool pop(Element& item);
+    size_t pop(Element* items, size_t count);
+    size_t size() const;
 
     bool was_empty() const;
     bool was_full() const;
@@ -51,6 +56,38 @@ void CircularFifo<Element, Size>::push(const Element& item)
     }
 }
 
+// Pushes a contiguous run of elements, publishing them to the consumer all at once
+template<typename Element, size_t Size>
+void CircularFifo<Element, Size>::push(const Element* items, size_t count)
+{
+    const auto current_tail = _tail.load(std::memory_order_relaxed);
+    const auto current_head = _head.load(std::memory_order_acquire);
+    const size_t free_space = (current_head + Capacity - current_tail - 1) % Capacity;
+    if (count > free_space)
+        Errors::die("FIFO FULL!");
+
+    const size_t first_part = std::min<size_t>(count, Capacity - current_tail);
+    std::copy(items, items + first_part, &_array[current_tail]);
+    std::copy(items + first_part, items + count, &_array[0]);
+    _tail.store((current_tail + count) % Capacity, std::memory_order_release);
+}
+
+// Pushes as much of a run of elements as there is room for, returning how many made it in
+template<typename Element, size_t Size>
+size_t CircularFifo<Element, Size>::try_push(const Element* items, size_t count)
+{
+    const auto current_tail = _tail.load(std::memory_order_relaxed);
+    const auto current_head = _head.load(std::memory_order_acquire);
+    const size_t free_space = (current_head + Capacity - current_tail - 1) % Capacity;
+    count = std::min(count, free_space);
+
+    const size_t first_part = std::min<size_t>(count, Capacity - current_tail);
+    std::copy(items, items + first_part, &_array[current_tail]);
+    std::copy(items + first_part, items + count, &_array[0]);
+    _tail.store((current_tail + count) % Capacity, std::memory_order_release);
+    return count;
+}
+
 // Pop by Consumer can only update the head (load with relaxed, store with release)
 //     the tail must be accessed with at least aquire
 template<typename Element, size_t Size>
@@ -65,6 +102,29 @@ bool CircularFifo<Element, Size>::pop(Element& item)
     return true;
 }
 
+// Pops up to count elements, returning how many there were
+template<typename Element, size_t Size>
+size_t CircularFifo<Element, Size>::pop(Element* items, size_t count)
+{
+    const auto current_head = _head.load(std::memory_order_relaxed);
+    const auto current_tail = _tail.load(std::memory_order_acquire);
+    const size_t used = (current_tail + Capacity - current_head) % Capacity;
+    count = std::min(count, used);
+
+    const size_t first_part = std::min<size_t>(count, Capacity - current_head);
+    std::copy(&_array[current_head], &_array[current_head] + first_part, items);
+    std::copy(&_array[0], &_array[0] + (count - first_part), items + first_part);
+    _head.store((current_head + count) % Capacity, std::memory_order_release);
+    return count;
+}
+
+// snapshot, may already be out of date by the time the caller looks at it
+template<typename Element, size_t Size>
+size_t CircularFifo<Element, Size>::size() const
+{
+    return (_tail.load() + Capacity - _head.load()) % Capacity;
+}
+
 template<typename Element, size_t Size>
 bool CircularFifo<Element, Size>::was_empty() const
 {
@@ -129,8 +129,8 @@ class Cop0
         void set_tlb_modified(size_t page);
         bool get_tlb_modified(size_t page) const;
 
-        void load_state(std::ifstream &state);
-        void save_state(std::ofstream& state);
+        void load_state(std::istream &state);
+        void save_state(std::ostream& state);
 
         //Friends needed for JIT convenience
         friend class EE_JIT64;
@@ -77,8 +77,8 @@ class Cop1
         void c_eq_s(int reg1, int reg2);
         void c_le_s(int reg1, int reg2);
 
-        void load_state(std::ifstream& state);
-        void save_state(std::ofstream& state);
+        void load_state(std::istream& state);
+        void save_state(std::ostream& state);
 
         //Friends needed for JIT convenience
         friend class EE_JIT64;
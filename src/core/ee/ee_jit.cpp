@@ -22,6 +22,11 @@ namespace EE_JIT
     {
         jit64.reset(clear_cache);
     }
+
+    void invalidate(EmotionEngine* ee, const uint8_t* mem, size_t size)
+    {
+        jit64.invalidate(*ee, mem, size);
+    }
     /*
     void set_current_program(uint32_t crc)
     {
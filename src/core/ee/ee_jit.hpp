@@ -1,5 +1,6 @@
 #ifndef EE_JIT_HPP
 #define EE_JIT_HPP
+#include <cstddef>
 #include <cstdint>
 
 class EmotionEngine;
@@ -8,6 +9,10 @@ namespace EE_JIT
 {
     uint16_t run(EmotionEngine* ee);
     void reset(bool clear_cache);
+
+    //Drops the code translated from host memory in [mem, mem + size), and any code whose virtual page
+    //has been remapped since
+    void invalidate(EmotionEngine* ee, const uint8_t* mem, size_t size);
 };
 
 #endif // EE_JIT_HPP
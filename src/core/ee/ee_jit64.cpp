@@ -81,6 +81,11 @@ void EE_JIT64::reset(bool clear_cache)
     }
 }
 
+void EE_JIT64::invalidate(EmotionEngine& ee, const uint8_t* mem, size_t size)
+{
+    jit_heap.invalidate_memory(ee.tlb_map, mem, mem + size);
+}
+
 extern "C"
 uint8_t* exec_block_ee(EE_JIT64& jit, EmotionEngine& ee)
 {
@@ -238,7 +243,8 @@ EEJitBlockRecord* EE_JIT64::recompile_block(EmotionEngine& ee, IR::Block& block)
     else
         cleanup_recompiler(ee, true, true, block.get_cycle_count());
 
-    return jit_heap.insert_block(ee.get_PC(), &jit_block);
+    uint8_t* mem = ee.tlb_map[ee.get_PC() / 4096];
+    return jit_heap.insert_block(ee.get_PC(), &jit_block, (mem > (uint8_t*)1) ? mem : nullptr);
 }
 
 void EE_JIT64::emit_instruction(EmotionEngine &ee, IR::Instruction &instr)
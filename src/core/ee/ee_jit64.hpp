@@ -322,6 +322,7 @@ public:
 
     void reset(bool clear_cache = true);
     uint16_t run(EmotionEngine& ee);
+    void invalidate(EmotionEngine& ee, const uint8_t* mem, size_t size);
 
     friend uint8_t* exec_block_ee(EE_JIT64& jit, EmotionEngine& ee);
 };
@@ -214,8 +214,8 @@ class EmotionEngine
         void qmtc2(int source, int cop_reg);
         void cop2_updatevu0();
 
-        void load_state(std::ifstream& state);
-        void save_state(std::ofstream& state);
+        void load_state(std::istream& state);
+        void save_state(std::ostream& state);
 
         //Friends needed for JIT convenience
         friend class EE_JIT64;
@@ -239,6 +239,7 @@ class ImageProcessingUnit
 
         void reset();
         void run();
+        bool is_busy();
 
         uint64_t read_command();
         uint32_t read_control();
@@ -254,4 +255,9 @@ class ImageProcessingUnit
         void write_FIFO(uint128_t quad);
 };
 
+inline bool ImageProcessingUnit::is_busy()
+{
+    return ctrl.busy;
+}
+
 #endif // IPU_HPP
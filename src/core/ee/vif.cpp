@@ -91,6 +91,26 @@ bool VectorInterface::check_vif_stall(uint32_t value)
     return is_stalled;
 }
 
+//True when update() would have nothing to do: no data to process and no stall to resolve
+bool VectorInterface::is_idle()
+{
+    if (fifo_reverse || (vif_stalled & (STALL_DIRECT | STALL_MSKPATH3)))
+        return false;
+
+    //Stalled on IBIT, STOP or FBRK, which only the EE can clear
+    if (vif_stalled)
+        return true;
+
+    if (FIFO.size() || internal_FIFO.size() || stall_condition_active || (command & 0x60) == 0x60)
+        return false;
+
+    //These are acknowledged as stalls on the next update
+    if (!command && (vif_ibit_detected || vif_stop || vif_forcebreak))
+        return false;
+
+    return vif_cmd_status == VIF_IDLE || vif_cmd_status == VIF_WAIT;
+}
+
 void VectorInterface::update(int cycles)
 {
     if (fifo_reverse)
@@ -126,6 +126,7 @@ class VectorInterface
 
         void reset();
         void update(int cycles);
+        bool is_idle();
         bool transfer_word(uint32_t value);
         bool transfer_DMAtag(uint128_t tag);
         bool feed_DMA(uint128_t quad);
@@ -144,8 +145,8 @@ class VectorInterface
         void set_err(uint32_t value);
         void set_fbrst(uint32_t value);
 
-        void load_state(std::ifstream& state);
-        void save_state(std::ofstream& state);
+        void load_state(std::istream& state);
+        void save_state(std::ostream& state);
 };
 
 inline int VectorInterface::get_id()
@@ -159,6 +159,7 @@ void VectorUnit::reset()
     soft_reset();
 
     VU_JIT::reset(this);
+    VU_Interpreter::reset(*this);
     vumem_is_dirty = true; //assume we don't know the contents on reset
 
     PC = 0;
@@ -343,7 +344,7 @@ void VectorUnit::run()
         uint32_t upper_instr = *(uint32_t*)&instr_mem.m[(PC + 4) & mem_mask];
         uint32_t lower_instr = *(uint32_t*)&instr_mem.m[PC & mem_mask];
         //printf("[$%08X] $%08X:$%08X\n", PC, upper_instr, lower_instr);
-        VU_Interpreter::interpret(*this, upper_instr, lower_instr);
+        VU_Interpreter::interpret(*this, PC, upper_instr, lower_instr);
 
         PC += 8;
 
@@ -412,19 +413,7 @@ void VectorUnit::run()
         else if (transferring_GIF)
         {
             gif->request_PATH(1, true);
-            while (XGKICK_cycles >= 2)
-            {
-                if (gif->path_active(1, true))
-                {
-                    handle_XGKICK();
-                    XGKICK_cycles -= 2;
-                }
-                else
-                {
-                    XGKICK_cycles = 0;
-                    break;
-                }
-            }
+            transfer_XGKICK();
         }
     }
 
@@ -432,19 +421,7 @@ void VectorUnit::run()
     {
         gif->request_PATH(1, true);
         XGKICK_cycles += cycles_to_run;
-        while (XGKICK_cycles >= 2)
-        {
-            if (gif->path_active(1, true))
-            {
-                handle_XGKICK();
-                XGKICK_cycles -= 2;
-            }
-            else
-            {
-                XGKICK_cycles = 0;
-                break;
-            }
-        }
+        transfer_XGKICK();
     }
 
     if (!running && (cycle_count < eecpu->get_cycle_count()))
@@ -534,17 +511,18 @@ void VectorUnit::update_XGKick()
         {
             if (gif->path_active(1, true))
             {
-                if (XGKICK_stall)
-                {
-                    stalled_cycles += 2;
-                }
-                else if (running)
+                bool stalled = XGKICK_stall;
+                if (!stalled && running)
                 {
                     XGKICK_cycles = 0;
                     break;
                 }
-                XGKICK_cycles -= 2;
-                handle_XGKICK();
+
+                //A burst never crosses the end of a packet, so it is either entirely stalled or not at all
+                int cycles = handle_XGKICK(XGKICK_cycles / 2) * 2;
+                XGKICK_cycles -= cycles;
+                if (stalled)
+                    stalled_cycles += cycles;
             }
             else
             {
@@ -595,11 +573,51 @@ void VectorUnit::run_jit()
     }
 }
 
-void VectorUnit::handle_XGKICK()
+/**
+ * Runs the current program until it stops, letting the VU run ahead of the EE in small slices.
+ * Only meant for tools such as the VU benchmark, where the rest of the system isn't running.
+ * The returned cycle count can overshoot the program's real length by up to one slice.
+ **/
+uint64_t VectorUnit::run_standalone(bool jit, uint64_t max_cycles)
+{
+    const int slice = 32;
+    uint64_t start = cycle_count;
+    while (running && cycle_count - start < max_cycles)
+    {
+        eecpu->set_cycle_count(cycle_count + slice);
+        if (jit)
+            run_jit();
+        else
+            run();
+    }
+    return cycle_count - start;
+}
+
+//Spends the XGKICK cycles built up so far, at a rate of one quadword every two cycles
+void VectorUnit::transfer_XGKICK()
+{
+    while (XGKICK_cycles >= 2)
+    {
+        if (gif->path_active(1, true))
+            XGKICK_cycles -= handle_XGKICK(XGKICK_cycles / 2) * 2;
+        else
+        {
+            XGKICK_cycles = 0;
+            break;
+        }
+    }
+}
+
+//Hands up to max_quads quadwords of the current packet to the GIF as a single burst.
+//Returns how many were sent, which is less if the packet ends or the GIF stalls.
+int VectorUnit::handle_XGKICK(int max_quads)
 {
-    uint128_t quad = read_mem<uint128_t>(GIF_addr);
-    GIF_addr += 16;
-    if (gif->send_PATH1(quad))
+    //The GIF reads directly out of VU memory, so a burst can't wrap around
+    int quads_to_wrap = (mem_mask + 1 - GIF_addr) / 16;
+    bool end_of_packet;
+    int sent = gif->send_PATH1((uint128_t*)&data_mem.m[GIF_addr], std::min(max_quads, quads_to_wrap), end_of_packet);
+    GIF_addr = (GIF_addr + sent * 16) & mem_mask;
+    if (end_of_packet)
     {
         //printf("[VU1] XGKICK transfer ended!\n");
         if (XGKICK_stall)
@@ -615,6 +633,7 @@ void VectorUnit::handle_XGKICK()
             transferring_GIF = false;
         }
     }
+    return sent;
 }
 
 //VU0 can access VU1 registers through the addresses (anded with 0x7FFF) 0x4000-0x4400
@@ -862,8 +881,9 @@ void VectorUnit::disasm_micromem()
     //Check for branch targets and also see if the microprogram is the same as the one previously disassembled
     uint32_t crc = crc_microprogram();
 
-    //Set the current program crc to the VU JIT
+    //Set the current program crc to the VU JIT and interpreter
     VU_JIT::set_current_program(crc, this);
+    VU_Interpreter::set_current_program(crc, *this);
 
     clear_dirty();
 
@@ -957,7 +977,9 @@ void VectorUnit::start_program(uint32_t addr, uint32_t cycle_delay)
     //Enable this if disabling micromem disasm
     if (is_dirty())
     {
-        VU_JIT::set_current_program(crc_microprogram(), this);
+        uint32_t crc = crc_microprogram();
+        VU_JIT::set_current_program(crc, this);
+        VU_Interpreter::set_current_program(crc, *this);
         clear_dirty();
     }
 
@@ -200,8 +200,10 @@ class VectorUnit
         void run();
         void correct_jit_pipeline(int cycles);
         void run_jit();
+        uint64_t run_standalone(bool jit, uint64_t max_cycles);
         void update_XGKick();
-        void handle_XGKICK();
+        void transfer_XGKICK();
+        int handle_XGKICK(int max_quads);
         void start_program(uint32_t addr, uint32_t cycle_delay);
         void end_execution();
         void stop();
@@ -229,6 +231,7 @@ class VectorUnit
         std::function<void(VectorUnit&)> run_func;
 
         bool is_running();
+        bool is_idle();
         bool stopped_by_tbit();
         bool is_dirty();
         void clear_dirty();
@@ -385,8 +388,8 @@ class VectorUnit
         void xitop(uint32_t instr);
         void xtop(uint32_t instr);
 
-        void load_state(std::ifstream& state);
-        void save_state(std::ofstream& state);
+        void load_state(std::istream& state);
+        void save_state(std::ostream& state);
 
         //Friends needed for JIT convenience
         friend class VU_JIT64;
@@ -451,6 +454,12 @@ inline bool VectorUnit::is_running()
     return running || (eecpu->get_cycle_count() < cycle_count);
 }
 
+//True when run() would do nothing besides catching the cycle count up
+inline bool VectorUnit::is_idle()
+{
+    return !running && !transferring_GIF;
+}
+
 inline bool VectorUnit::stopped_by_tbit()
 {
     return tbit_stop;
@@ -1,5 +1,7 @@
 #include <cstdio>
 #include <cstdlib>
+#include <memory>
+#include <unordered_map>
 #include "vu_interpreter.hpp"
 #include "../errors.hpp"
 
@@ -21,6 +23,58 @@ namespace VU_Interpreter
 typedef void(VectorUnit::*vu_op)(uint32_t);
 vu_op upper_op, lower_op;
 
+enum DecodedFlags
+{
+    DECODED_WAITQ = 1 << 0,
+    DECODED_WAITP = 1 << 1,
+    DECODED_LOI = 1 << 2,
+    DECODED_SWAP = 1 << 3, //Upper op writes a register the lower op reads or writes
+    DECODED_HAZARD = 1 << 4 //Reads a register that can stall on the FMAC or ILW pipelines
+};
+
+/**
+ * Decoding an instruction pair is two large switches and a dozen or so stores into DecodedRegs,
+ * all of which depend only on the instruction words. Each pair is decoded the first time it is executed,
+ * and the result is kept in a per-microprogram table indexed by PC.
+ * The raw words are kept alongside so that a write to micro memory simply causes a redecode.
+ **/
+struct DecodedInstr
+{
+    uint32_t upper_instr, lower_instr;
+    vu_op upper_op, lower_op;
+    DecodedRegs regs;
+    uint8_t flags;
+};
+
+struct DecodedProgram
+{
+    DecodedInstr instrs[0x4000 / 8];
+};
+
+//Keyed by the same microprogram CRC the JIT uses, so swapping between programs doesn't lose their decodes
+constexpr static size_t MAX_DECODED_PROGRAMS = 64;
+std::unordered_map<uint32_t, std::unique_ptr<DecodedProgram>> decoded_programs[2];
+DecodedProgram* current_program[2];
+
+void reset(VectorUnit &vu)
+{
+    decoded_programs[vu.get_id()].clear();
+    set_current_program(0, vu);
+}
+
+void set_current_program(uint32_t crc, VectorUnit &vu)
+{
+    auto& programs = decoded_programs[vu.get_id()];
+    auto it = programs.find(crc);
+    if (it == programs.end())
+    {
+        if (programs.size() >= MAX_DECODED_PROGRAMS)
+            programs.clear();
+        it = programs.emplace(crc, std::unique_ptr<DecodedProgram>(new DecodedProgram())).first;
+    }
+    current_program[vu.get_id()] = it->second.get();
+}
+
 void call_upper(VectorUnit &vu, uint32_t instr)
 {
     (vu.*upper_op)(instr);
@@ -31,39 +85,38 @@ void call_lower(VectorUnit &vu, uint32_t instr)
     (vu.*lower_op)(instr);
 }
 
-void interpret(VectorUnit &vu, uint32_t upper_instr, uint32_t lower_instr)
+static void decode(VectorUnit &vu, uint32_t upper_instr, uint32_t lower_instr, DecodedInstr &decoded)
 {
+    //The pipelines still need the previous instruction's registers until this one executes
+    DecodedRegs prev_regs = vu.decoder;
+    vu.decoder.reset();
+
+    decoded.upper_instr = upper_instr;
+    decoded.lower_instr = lower_instr;
+    decoded.flags = 0;
+
     //WaitQ, DIV, RSQRT, SQRT
     if (((lower_instr & 0x800007FC) == 0x800003BC))
-    {
-        vu.waitq(0);
-    }
+        decoded.flags |= DECODED_WAITQ;
 
     if ((lower_instr & (1 << 31)) && ((lower_instr >> 2) & 0x1CF) == 0x1CF)
-    {
-        vu.waitp(0);
-    }
-
-    vu.decoder.reset();
+        decoded.flags |= DECODED_WAITP;
 
     //Get upper op
     upper(vu, upper_instr);
+    decoded.upper_op = upper_op;
 
     //Get lower op
-    if (!(upper_instr & (1 << 31)))
-        lower(vu, lower_instr);
-
-    // check for stalls before execution
-    vu.check_for_FMAC_stall();
-    
-    //LOI - upper op always executes first
     if (upper_instr & (1 << 31))
     {
-        (vu.*upper_op)(upper_instr);
-        vu.set_I(lower_instr);
+        decoded.flags |= DECODED_LOI;
+        decoded.lower_op = nullptr;
     }
     else
     {
+        lower(vu, lower_instr);
+        decoded.lower_op = lower_op;
+
         //If the upper op is writing to a reg the lower op is reading from, the lower op executes first
         //Also used to handle if upper and lower write to the same register, upper gets priority
         int write = vu.decoder.vf_write[0];
@@ -71,23 +124,61 @@ void interpret(VectorUnit &vu, uint32_t upper_instr, uint32_t lower_instr)
         int read0 = vu.decoder.vf_read0[1];
         int read1 = vu.decoder.vf_read1[1];
         if (write && ((write == read0 || write == read1) || (write == write1)))
-        {
-            vu.backup_vf(false, write);
+            decoded.flags |= DECODED_SWAP;
+    }
+
+    DecodedRegs& regs = vu.decoder;
+    if (regs.vf_read0[0] || regs.vf_read0[1] || regs.vf_read1[0] || regs.vf_read1[1] ||
+            regs.vi_read0 || regs.vi_read1)
+        decoded.flags |= DECODED_HAZARD;
+
+    decoded.regs = vu.decoder;
+    vu.decoder = prev_regs;
+}
+
+void interpret(VectorUnit &vu, uint16_t PC, uint32_t upper_instr, uint32_t lower_instr)
+{
+    DecodedInstr& instr = current_program[vu.get_id()]->instrs[(PC & 0x3FFF) / 8];
+    if (!instr.upper_op || instr.upper_instr != upper_instr || instr.lower_instr != lower_instr)
+        decode(vu, upper_instr, lower_instr, instr);
+
+    if (instr.flags & DECODED_WAITQ)
+        vu.waitq(0);
+
+    if (instr.flags & DECODED_WAITP)
+        vu.waitp(0);
+
+    vu.decoder = instr.regs;
+
+    // check for stalls before execution
+    if (instr.flags & DECODED_HAZARD)
+        vu.check_for_FMAC_stall();
+    
+    //LOI - upper op always executes first
+    if (instr.flags & DECODED_LOI)
+    {
+        (vu.*instr.upper_op)(upper_instr);
+        vu.set_I(lower_instr);
+    }
+    else if (instr.flags & DECODED_SWAP)
+    {
+        int write = instr.regs.vf_write[0];
+
+        vu.backup_vf(false, write);
 
-            (vu.*upper_op)(upper_instr);
+        (vu.*instr.upper_op)(upper_instr);
 
-            vu.backup_vf(true, write);
-            vu.restore_vf(false, write);
+        vu.backup_vf(true, write);
+        vu.restore_vf(false, write);
 
-            (vu.*lower_op)(lower_instr);
+        (vu.*instr.lower_op)(lower_instr);
 
-            vu.restore_vf(true, write);
-        }
-        else
-        {
-            (vu.*upper_op)(upper_instr);
-            (vu.*lower_op)(lower_instr);
-        }
+        vu.restore_vf(true, write);
+    }
+    else
+    {
+        (vu.*instr.upper_op)(upper_instr);
+        (vu.*instr.lower_op)(lower_instr);
     }
 
     if (upper_instr & (1 << 29) && vu.get_id() == 0)
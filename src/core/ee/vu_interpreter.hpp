@@ -4,7 +4,9 @@
 
 namespace VU_Interpreter
 {
-    void interpret(VectorUnit& vu, uint32_t upper_instr, uint32_t lower_instr);
+    void reset(VectorUnit& vu);
+    void set_current_program(uint32_t crc, VectorUnit& vu);
+    void interpret(VectorUnit& vu, uint16_t PC, uint32_t upper_instr, uint32_t lower_instr);
 
     void call_upper(VectorUnit& vu, uint32_t instr);
     void call_lower(VectorUnit& vu, uint32_t instr);
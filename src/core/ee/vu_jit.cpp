@@ -28,4 +28,9 @@ void set_current_program(uint32_t crc, VectorUnit *vu)
     jit64[vu->get_id()].set_current_program(crc);
 }
 
+void get_cache_usage(VectorUnit *vu, size_t& block_count, size_t& code_size)
+{
+    jit64[vu->get_id()].get_cache_usage(block_count, code_size);
+}
+
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #ifndef VU_JIT_HPP
 #define VU_JIT_HPP
+#include <cstddef>
 #include <cstdint>
 
 class VectorUnit;
@@ -10,6 +11,7 @@ namespace VU_JIT
 uint16_t run(VectorUnit* vu);
 void reset(VectorUnit *vu);
 void set_current_program(uint32_t crc, VectorUnit *vu);
+void get_cache_usage(VectorUnit *vu, size_t& block_count, size_t& code_size);
 
 };
 
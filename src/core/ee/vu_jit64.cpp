@@ -4,6 +4,7 @@
 #include "vu_jit64.hpp"
 #include "vu_interpreter.hpp"
 #include "../gif.hpp"
+#include "../jitcommon/hostcpu.hpp"
 
 #include "../errors.hpp"
 
@@ -34,6 +35,7 @@
 VU_JIT64::VU_JIT64() : jit_block("VU"), emitter(&jit_block)
 {
     prologue_block = nullptr;
+    use_avx2 = HostCPU::has_avx2();
     for (int i = 0; i < 4; i++)
     {
         ftoi_table[0].f[i] = pow(2, 0);
@@ -139,19 +141,7 @@ void vu_update_xgkick(VectorUnit& vu, int cycles)
         return;
     }
 
-    while (vu.XGKICK_cycles >= 2)
-    {
-        if (vu.gif->path_active(1, true))
-        {
-            vu.handle_XGKICK();
-            vu.XGKICK_cycles -= 2;
-        }
-        else
-        {
-            vu.XGKICK_cycles = 0;
-            break;
-        }
-    }
+    vu.transfer_XGKICK();
 }
 
 void interpreter_upper(VectorUnit& vu, uint32_t instr)
@@ -214,6 +204,12 @@ void VU_JIT64::set_current_program(uint32_t crc)
     current_program = crc;
 }
 
+void VU_JIT64::get_cache_usage(size_t& block_count, size_t& code_size)
+{
+    block_count = jit_heap.get_block_count();
+    code_size = jit_heap.get_used_size();
+}
+
 uint64_t VU_JIT64::get_vf_addr(VectorUnit &vu, int index)
 {
     if (index < 32)
@@ -2973,40 +2969,70 @@ void VU_JIT64::emit_instruction(VectorUnit &vu, IR::Instruction &instr)
             min_vectors(vu, instr);
             break;
         case IR::Opcode::VAddVectors:
-            add_vectors(vu, instr);
+            if (use_avx2)
+                add_vectors_AVX(vu, instr);
+            else
+                add_vectors(vu, instr);
             break;
         case IR::Opcode::VAddVectorByScalar:
-            add_vector_by_scalar(vu, instr);
+            if (use_avx2)
+                add_vector_by_scalar_AVX(vu, instr);
+            else
+                add_vector_by_scalar(vu, instr);
             break;
         case IR::Opcode::VSubVectors:
-            sub_vectors(vu, instr);
+            if (use_avx2)
+                sub_vectors_AVX(vu, instr);
+            else
+                sub_vectors(vu, instr);
             break;
         case IR::Opcode::VSubVectorByScalar:
-            sub_vector_by_scalar(vu, instr);
+            if (use_avx2)
+                sub_vector_by_scalar_AVX(vu, instr);
+            else
+                sub_vector_by_scalar(vu, instr);
             break;
         case IR::Opcode::VMulVectors:
-            mul_vectors(vu, instr);
+            if (use_avx2)
+                mul_vectors_AVX(vu, instr);
+            else
+                mul_vectors(vu, instr);
             break;
         case IR::Opcode::VMulVectorByScalar:
-            mul_vector_by_scalar(vu, instr);
+            if (use_avx2)
+                mul_vector_by_scalar_AVX(vu, instr);
+            else
+                mul_vector_by_scalar(vu, instr);
             break;
         case IR::Opcode::VMaddVectors:
-            madd_vectors(vu, instr);
+            if (use_avx2)
+                madd_vectors_AVX(vu, instr);
+            else
+                madd_vectors(vu, instr);
             break;
         case IR::Opcode::VMaddAccAndVectors:
             madd_acc_and_vectors(vu, instr);
             break;
         case IR::Opcode::VMaddVectorByScalar:
-            madd_vector_by_scalar(vu, instr);
+            if (use_avx2)
+                madd_vector_by_scalar_AVX(vu, instr);
+            else
+                madd_vector_by_scalar(vu, instr);
             break;
         case IR::Opcode::VMaddAccByScalar:
             madd_acc_by_scalar(vu, instr);
             break;
         case IR::Opcode::VMsubVectors:
-            msub_vectors(vu, instr);
+            if (use_avx2)
+                msub_vectors_AVX(vu, instr);
+            else
+                msub_vectors(vu, instr);
             break;
         case IR::Opcode::VMsubVectorByScalar:
-            msub_vector_by_scalar(vu, instr);
+            if (use_avx2)
+                msub_vector_by_scalar_AVX(vu, instr);
+            else
+                msub_vector_by_scalar(vu, instr);
             break;
         case IR::Opcode::VMsubAccByScalar:
             msub_acc_by_scalar(vu, instr);
@@ -3311,13 +3337,41 @@ void VU_JIT64::call_abi_func(uint64_t addr)
         sp_offset += 8;
 #ifdef _WIN32
     //x64 Windows requires a 32-byte "shadow region" to store the four argument registers, even if not all are used
-    sp_offset += 32;
+    const int shadow_size = 32;
+    const int volatile_xmm = 6;
+#else
+    const int shadow_size = 0;
+    const int volatile_xmm = 16;
 #endif
+    sp_offset += shadow_size;
+
+    //The callee is free to clobber the volatile XMM registers, so any that hold VU registers are kept above the
+    //shadow region
+    int xmm_saved = 0;
+    for (int i = 0; i < volatile_xmm; i++)
+    {
+        if (xmm_regs[i].used)
+            xmm_saved++;
+    }
+    sp_offset += xmm_saved * 16;
+
     emitter.MOV64_OI(addr, REG_64::RAX);
 
     if (sp_offset)
         emitter.SUB64_REG_IMM(sp_offset, REG_64::RSP);
+    int slot = 0;
+    for (int i = 0; i < volatile_xmm; i++)
+    {
+        if (xmm_regs[i].used)
+            emitter.MOVAPS_TO_MEM((REG_64)i, REG_64::RSP, shadow_size + 16 * slot++);
+    }
     emitter.CALL_INDIR(REG_64::RAX);
+    slot = 0;
+    for (int i = 0; i < volatile_xmm; i++)
+    {
+        if (xmm_regs[i].used)
+            emitter.MOVAPS_FROM_MEM(REG_64::RSP, (REG_64)i, shadow_size + 16 * slot++);
+    }
     if (sp_offset)
         emitter.ADD64_REG_IMM(sp_offset, REG_64::RSP);
 
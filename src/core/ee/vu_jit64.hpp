@@ -60,6 +60,9 @@ class VU_JIT64
         uint32_t prev_pc;
         bool should_update_mac;
 
+        //Emit the AVX2 versions of the FMAC ops, decided once from the host CPU
+        bool use_avx2;
+
         bool vu_branch;
         bool end_of_program;
         uint16_t vu_branch_dest, vu_branch_fail_dest;
@@ -131,6 +134,19 @@ class VU_JIT64
         void opmula(VectorUnit& vu, IR::Instruction& instr);
         void opmsub(VectorUnit& vu, IR::Instruction& instr);
 
+        void clamp_vfreg_AVX(uint8_t field, REG_64 xmm_reg);
+        void broadcast_scalar_AVX(REG_64 bc_reg, uint8_t bc, REG_64 dest);
+        void add_vectors_AVX(VectorUnit& vu, IR::Instruction& instr);
+        void add_vector_by_scalar_AVX(VectorUnit& vu, IR::Instruction& instr);
+        void sub_vectors_AVX(VectorUnit& vu, IR::Instruction& instr);
+        void sub_vector_by_scalar_AVX(VectorUnit& vu, IR::Instruction& instr);
+        void mul_vectors_AVX(VectorUnit& vu, IR::Instruction& instr);
+        void mul_vector_by_scalar_AVX(VectorUnit& vu, IR::Instruction& instr);
+        void madd_vectors_AVX(VectorUnit& vu, IR::Instruction& instr);
+        void madd_vector_by_scalar_AVX(VectorUnit& vu, IR::Instruction& instr);
+        void msub_vectors_AVX(VectorUnit& vu, IR::Instruction& instr);
+        void msub_vector_by_scalar_AVX(VectorUnit& vu, IR::Instruction& instr);
+
         void clip(VectorUnit& vu, IR::Instruction& instr);
         void div(VectorUnit& vu, IR::Instruction& instr);
         void rsqrt(VectorUnit& vu, IR::Instruction& instr);
@@ -205,6 +221,7 @@ class VU_JIT64
 
         void reset(bool clear_cache = true);
         void set_current_program(uint32_t crc);
+        void get_cache_usage(size_t& block_count, size_t& code_size);
         uint16_t run(VectorUnit& vu);
 
         friend uint8_t* exec_block_vu(VU_JIT64& jit, VectorUnit& vu);
@@ -0,0 +1,312 @@
+#include "vu_jit64.hpp"
+
+/**
+ * AVX2 versions of the FMAC arithmetic ops, used when the host supports them.
+ * The three-operand VEX forms let results land directly in the destination or a temp
+ * without first copying a source, and BC/I/Q operands are broadcast straight out of their register.
+ * Multiply-add is deliberately kept as a separate multiply and add: a fused FMA skips the
+ * intermediate rounding of the product and would no longer match the VU.
+ */
+
+uint8_t convert_field(uint8_t value);
+
+void VU_JIT64::clamp_vfreg_AVX(uint8_t field, REG_64 xmm_reg)
+{
+    if (field == 0xF || !needs_clamping(xmm_reg, field))
+    {
+        clamp_vfreg(field, xmm_reg);
+        return;
+    }
+
+    emitter.load_addr((uint64_t)&max_flt_constant, REG_64::RAX);
+    emitter.load_addr((uint64_t)&min_flt_constant, REG_64::R15);
+
+    REG_64 temp_reg = REG_64::XMM1;
+    if (xmm_reg == temp_reg)
+        temp_reg = REG_64::XMM0;
+
+    emitter.VPMINSD_XMM_FROM_MEM(REG_64::RAX, xmm_reg, temp_reg);
+    emitter.PMINUD_XMM_FROM_MEM(REG_64::R15, temp_reg);
+
+    emitter.BLENDPS(field, temp_reg, xmm_reg);
+    set_clamping(xmm_reg, false, field);
+}
+
+void VU_JIT64::broadcast_scalar_AVX(REG_64 bc_reg, uint8_t bc, REG_64 dest)
+{
+    if (bc == 0)
+        emitter.VBROADCASTSS(bc_reg, dest);
+    else
+        emitter.VPERMILPS(bc * 0x55, bc_reg, dest);
+}
+
+void VU_JIT64::add_vectors_AVX(VectorUnit &vu, IR::Instruction &instr)
+{
+    uint8_t field = convert_field(instr.get_field());
+
+    REG_64 op1 = alloc_sse_reg(vu, (int)instr.get_source(), REG_STATE::READ);
+    REG_64 op2 = alloc_sse_reg(vu, (int)instr.get_source2(), REG_STATE::READ);
+    REG_64 dest = alloc_sse_reg(vu, instr.get_dest(), (field == 0xF) ? REG_STATE::WRITE : REG_STATE::READ_WRITE);
+    REG_64 temp = (field != 0xF || !instr.get_dest()) ? REG_64::XMM0 : dest;
+
+    clamp_vfreg_AVX(field, op1);
+    clamp_vfreg_AVX(field, op2);
+
+    emitter.VADDPS(op1, op2, temp);
+    set_clamping(temp, true, field);
+    clamp_vfreg_AVX(field, temp);
+
+    set_clamping(dest, false, field);
+    if (instr.get_dest() && dest != temp)
+        emitter.BLENDPS(field, temp, dest);
+
+    if (should_update_mac)
+        update_mac_flags(vu, temp, field);
+}
+
+void VU_JIT64::add_vector_by_scalar_AVX(VectorUnit &vu, IR::Instruction &instr)
+{
+    uint8_t field = convert_field(instr.get_field());
+    REG_64 source = alloc_sse_reg(vu, (int)instr.get_source(), REG_STATE::READ);
+    REG_64 bc_reg = alloc_sse_reg(vu, (int)instr.get_source2(), REG_STATE::READ);
+    REG_64 dest = alloc_sse_reg(vu, instr.get_dest(), (field == 0xF) ? REG_STATE::WRITE : REG_STATE::READ_WRITE);
+    REG_64 scalar = REG_64::XMM1;
+    REG_64 temp = (field != 0xF || !instr.get_dest()) ? REG_64::XMM0 : dest;
+
+    clamp_vfreg_AVX(field, source);
+
+    broadcast_scalar_AVX(bc_reg, instr.get_bc(), scalar);
+    set_clamping(scalar, true, field);
+    clamp_vfreg_AVX(field, scalar);
+
+    emitter.VADDPS(scalar, source, temp);
+    set_clamping(temp, true, field);
+    clamp_vfreg_AVX(field, temp);
+
+    set_clamping(dest, false, field);
+    if (instr.get_dest() && dest != temp)
+        emitter.BLENDPS(field, temp, dest);
+
+    if (should_update_mac)
+        update_mac_flags(vu, temp, field);
+}
+
+void VU_JIT64::sub_vectors_AVX(VectorUnit &vu, IR::Instruction &instr)
+{
+    uint8_t field = convert_field(instr.get_field());
+
+    REG_64 op1 = alloc_sse_reg(vu, (int)instr.get_source(), REG_STATE::READ);
+    REG_64 op2 = alloc_sse_reg(vu, (int)instr.get_source2(), REG_STATE::READ);
+    REG_64 dest = alloc_sse_reg(vu, instr.get_dest(), (field == 0xF) ? REG_STATE::WRITE : REG_STATE::READ_WRITE);
+    REG_64 temp = (field != 0xF || !instr.get_dest()) ? REG_64::XMM0 : dest;
+
+    clamp_vfreg_AVX(field, op1);
+    clamp_vfreg_AVX(field, op2);
+
+    emitter.VSUBPS(op1, op2, temp);
+    set_clamping(temp, true, field);
+    clamp_vfreg_AVX(field, temp);
+
+    set_clamping(dest, false, field);
+    if (instr.get_dest() && dest != temp)
+        emitter.BLENDPS(field, temp, dest);
+
+    if (should_update_mac)
+        update_mac_flags(vu, temp, field);
+}
+
+void VU_JIT64::sub_vector_by_scalar_AVX(VectorUnit &vu, IR::Instruction &instr)
+{
+    uint8_t field = convert_field(instr.get_field());
+    REG_64 source = alloc_sse_reg(vu, (int)instr.get_source(), REG_STATE::READ);
+    REG_64 bc_reg = alloc_sse_reg(vu, (int)instr.get_source2(), REG_STATE::READ);
+    REG_64 dest = alloc_sse_reg(vu, instr.get_dest(), (field == 0xF) ? REG_STATE::WRITE : REG_STATE::READ_WRITE);
+    REG_64 scalar = REG_64::XMM1;
+    REG_64 temp = (field != 0xF || !instr.get_dest()) ? REG_64::XMM0 : dest;
+
+    clamp_vfreg_AVX(field, source);
+
+    broadcast_scalar_AVX(bc_reg, instr.get_bc(), scalar);
+    set_clamping(scalar, true, field);
+    clamp_vfreg_AVX(field, scalar);
+
+    emitter.VSUBPS(source, scalar, temp);
+    set_clamping(temp, true, field);
+    clamp_vfreg_AVX(field, temp);
+
+    set_clamping(dest, false, field);
+    if (instr.get_dest() && dest != temp)
+        emitter.BLENDPS(field, temp, dest);
+
+    if (should_update_mac)
+        update_mac_flags(vu, temp, field);
+}
+
+void VU_JIT64::mul_vectors_AVX(VectorUnit &vu, IR::Instruction &instr)
+{
+    uint8_t field = convert_field(instr.get_field());
+
+    REG_64 op1 = alloc_sse_reg(vu, (int)instr.get_source(), REG_STATE::READ);
+    REG_64 op2 = alloc_sse_reg(vu, (int)instr.get_source2(), REG_STATE::READ);
+    REG_64 dest = alloc_sse_reg(vu, instr.get_dest(), (field == 0xF) ? REG_STATE::WRITE : REG_STATE::READ_WRITE);
+    REG_64 temp = (field != 0xF || !instr.get_dest()) ? REG_64::XMM0 : dest;
+
+    clamp_vfreg_AVX(field, op1);
+    clamp_vfreg_AVX(field, op2);
+
+    emitter.VMULPS(op1, op2, temp);
+    set_clamping(temp, true, field);
+    clamp_vfreg_AVX(field, temp);
+
+    set_clamping(dest, false, field);
+    if (instr.get_dest() && dest != temp)
+        emitter.BLENDPS(field, temp, dest);
+
+    if (should_update_mac)
+        update_mac_flags(vu, temp, field);
+}
+
+void VU_JIT64::mul_vector_by_scalar_AVX(VectorUnit &vu, IR::Instruction &instr)
+{
+    uint8_t field = convert_field(instr.get_field());
+    REG_64 source = alloc_sse_reg(vu, (int)instr.get_source(), REG_STATE::READ);
+    REG_64 bc_reg = alloc_sse_reg(vu, (int)instr.get_source2(), REG_STATE::READ);
+    REG_64 dest = alloc_sse_reg(vu, instr.get_dest(), (field == 0xF) ? REG_STATE::WRITE : REG_STATE::READ_WRITE);
+    REG_64 scalar = REG_64::XMM1;
+    REG_64 temp = (field != 0xF || !instr.get_dest()) ? REG_64::XMM0 : dest;
+
+    clamp_vfreg_AVX(field, source);
+
+    broadcast_scalar_AVX(bc_reg, instr.get_bc(), scalar);
+    set_clamping(scalar, true, field);
+    clamp_vfreg_AVX(field, scalar);
+
+    emitter.VMULPS(scalar, source, temp);
+    set_clamping(temp, true, field);
+    clamp_vfreg_AVX(field, temp);
+
+    set_clamping(dest, false, field);
+    if (instr.get_dest() && dest != temp)
+        emitter.BLENDPS(field, temp, dest);
+
+    if (should_update_mac)
+        update_mac_flags(vu, temp, field);
+}
+
+void VU_JIT64::madd_vectors_AVX(VectorUnit &vu, IR::Instruction &instr)
+{
+    uint8_t field = convert_field(instr.get_field());
+
+    REG_64 op1 = alloc_sse_reg(vu, (int)instr.get_source(), REG_STATE::READ);
+    REG_64 op2 = alloc_sse_reg(vu, (int)instr.get_source2(), REG_STATE::READ);
+    REG_64 acc = alloc_sse_reg(vu, VU_SpecialReg::ACC, REG_STATE::READ);
+    REG_64 dest = alloc_sse_reg(vu, instr.get_dest(), (field == 0xF) ? REG_STATE::WRITE : REG_STATE::READ_WRITE);
+    REG_64 temp = (field != 0xF || !instr.get_dest()) ? REG_64::XMM0 : dest;
+
+    clamp_vfreg_AVX(field, op1);
+    clamp_vfreg_AVX(field, op2);
+    clamp_vfreg_AVX(field, acc);
+
+    emitter.VMULPS(op1, op2, temp);
+    emitter.VADDPS(temp, acc, temp);
+    set_clamping(temp, true, field);
+    clamp_vfreg_AVX(field, temp);
+
+    set_clamping(dest, false, field);
+    if (instr.get_dest() && dest != temp)
+        emitter.BLENDPS(field, temp, dest);
+
+    if (should_update_mac)
+        update_mac_flags(vu, temp, field);
+}
+
+void VU_JIT64::madd_vector_by_scalar_AVX(VectorUnit &vu, IR::Instruction &instr)
+{
+    uint8_t field = convert_field(instr.get_field());
+    REG_64 source = alloc_sse_reg(vu, (int)instr.get_source(), REG_STATE::READ);
+    REG_64 bc_reg = alloc_sse_reg(vu, (int)instr.get_source2(), REG_STATE::READ);
+    REG_64 dest = alloc_sse_reg(vu, instr.get_dest(), (field == 0xF) ? REG_STATE::WRITE : REG_STATE::READ_WRITE);
+    REG_64 acc = alloc_sse_reg(vu, VU_SpecialReg::ACC, REG_STATE::READ);
+    REG_64 scalar = REG_64::XMM1;
+    REG_64 temp = (field != 0xF || !instr.get_dest()) ? REG_64::XMM0 : dest;
+
+    clamp_vfreg_AVX(field, source);
+    clamp_vfreg_AVX(field, acc);
+
+    broadcast_scalar_AVX(bc_reg, instr.get_bc(), scalar);
+    set_clamping(scalar, true, field);
+    clamp_vfreg_AVX(field, scalar);
+
+    emitter.VMULPS(scalar, source, temp);
+    emitter.VADDPS(temp, acc, temp);
+    set_clamping(temp, true, field);
+    clamp_vfreg_AVX(field, temp);
+
+    set_clamping(dest, false, field);
+    if (instr.get_dest() && dest != temp)
+        emitter.BLENDPS(field, temp, dest);
+
+    if (should_update_mac)
+        update_mac_flags(vu, temp, field);
+}
+
+void VU_JIT64::msub_vectors_AVX(VectorUnit &vu, IR::Instruction &instr)
+{
+    uint8_t field = convert_field(instr.get_field());
+
+    REG_64 op1 = alloc_sse_reg(vu, (int)instr.get_source(), REG_STATE::READ);
+    REG_64 op2 = alloc_sse_reg(vu, (int)instr.get_source2(), REG_STATE::READ);
+    REG_64 acc = alloc_sse_reg(vu, VU_SpecialReg::ACC, REG_STATE::READ);
+    REG_64 dest = alloc_sse_reg(vu, instr.get_dest(), (field == 0xF) ? REG_STATE::WRITE : REG_STATE::READ_WRITE);
+    REG_64 product = REG_64::XMM0;
+    REG_64 temp = (field != 0xF || !instr.get_dest()) ? REG_64::XMM1 : dest;
+
+    clamp_vfreg_AVX(field, op1);
+    clamp_vfreg_AVX(field, op2);
+    clamp_vfreg_AVX(field, acc);
+
+    emitter.VMULPS(op1, op2, product);
+    emitter.VSUBPS(acc, product, temp);
+    set_clamping(temp, true, field);
+    clamp_vfreg_AVX(field, temp);
+
+    set_clamping(dest, false, field);
+    if (instr.get_dest() && dest != temp)
+        emitter.BLENDPS(field, temp, dest);
+
+    if (should_update_mac)
+        update_mac_flags(vu, temp, field);
+}
+
+void VU_JIT64::msub_vector_by_scalar_AVX(VectorUnit &vu, IR::Instruction &instr)
+{
+    uint8_t field = convert_field(instr.get_field());
+    REG_64 source = alloc_sse_reg(vu, (int)instr.get_source(), REG_STATE::READ);
+    REG_64 bc_reg = alloc_sse_reg(vu, (int)instr.get_source2(), REG_STATE::READ);
+    REG_64 dest = alloc_sse_reg(vu, instr.get_dest(), (field == 0xF) ? REG_STATE::WRITE : REG_STATE::READ_WRITE);
+    REG_64 acc = alloc_sse_reg(vu, VU_SpecialReg::ACC, REG_STATE::READ);
+    REG_64 scalar = REG_64::XMM1;
+    REG_64 product = REG_64::XMM0;
+
+    //The broadcast scalar is dead once the product is formed, so XMM1 is free again for the result
+    REG_64 temp = (field != 0xF || !instr.get_dest()) ? REG_64::XMM1 : dest;
+
+    clamp_vfreg_AVX(field, source);
+    clamp_vfreg_AVX(field, acc);
+
+    broadcast_scalar_AVX(bc_reg, instr.get_bc(), scalar);
+    set_clamping(scalar, true, field);
+    clamp_vfreg_AVX(field, scalar);
+
+    emitter.VMULPS(scalar, source, product);
+    emitter.VSUBPS(acc, product, temp);
+    set_clamping(temp, true, field);
+    clamp_vfreg_AVX(field, temp);
+
+    set_clamping(dest, false, field);
+    if (instr.get_dest() && dest != temp)
+        emitter.BLENDPS(field, temp, dest);
+
+    if (should_update_mac)
+        update_mac_flags(vu, temp, field);
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstring>
 #include "vu_jittrans.hpp"
 #include "vu_interpreter.hpp"
@@ -28,7 +29,7 @@ IR::Block VU_JitTranslator::translate(VectorUnit &vu, uint8_t* instr_mem, uint32
     cycles_since_xgkick_update = 0;
 
     interpreter_pass(vu, instr_mem, prev_pc);
-    flag_pass(vu);
+    flag_pass(vu, instr_mem);
 
     cur_PC = vu.get_PC();
 
@@ -408,13 +409,19 @@ int VU_JitTranslator::is_flag_instruction(uint32_t lower_instr)
 
         switch (op)
         {
+            //FCEQ/FCSET/FCAND/FCOR/FCGET
             case 0x10:
             case 0x11:
             case 0x12:
             case 0x13:
             case 0x1C:
                 return FlagInstr_Clip;
+            //FSEQ/FSAND/FSOR
+            case 0x14:
             case 0x16:
+            case 0x17:
+                return FlagInstr_Status;
+            //FMEQ/FMAND/FMOR
             case 0x18:
             case 0x1A:
             case 0x1B:
@@ -426,6 +433,20 @@ int VU_JitTranslator::is_flag_instruction(uint32_t lower_instr)
     return FlagInstr_None;
 }
 
+//Cycles until a status write made by this instruction lands, which only counts down while the MAC pipeline advances
+int VU_JitTranslator::status_write_delay(uint32_t upper_instr, uint32_t lower_instr)
+{
+    if (upper_instr & (1 << 31))
+        return 0;
+
+    //FSSET
+    if (!(lower_instr & (1 << 31)) && ((lower_instr >> 25) & 0x7F) == 0x15)
+        return 4;
+
+    //FDIV/FSQRT/FRSQRT
+    return fdiv_pipe_cycles(lower_instr);
+}
+
 void VU_JitTranslator::update_pipeline(VectorUnit &vu, int cycles)
 {
     for (int i = 0; i < cycles; i++)
@@ -847,85 +868,186 @@ void VU_JitTranslator::interpreter_pass(VectorUnit &vu, uint8_t *instr_mem, uint
 }
 
 /**
- * Determine when MAC, clip, and status flags need to be updated.
+ * Marks what is needed for a flag read placed just before block_pcs[pos] to see the right instance.
+ * The flags visible to a read are the ones which entered the pipeline 4 cycles earlier, so the pipeline has to
+ * advance over those cycles, and the last FMAC before them has to calculate its flags.
+ * Anything which falls off the start of the block is left to the predecessor (see exit_reads_flags).
  */
-void VU_JitTranslator::flag_pass(VectorUnit &vu)
+void VU_JitTranslator::mark_live_flags(const std::vector<uint16_t>& block_pcs, int pos, int cycles, bool needs_result)
 {
-    uint16_t start_pc = vu.get_PC();
-    bool clip_instruction_found = false;
-    bool mac_instruction_found = false;
-    bool final_mac_instance_found = false;
-    bool needs_update = false;
-    int mac_cycles = 0;
-    int clip_cycles = 0;
-
-    //Start from the end of the block
-    uint16_t i = end_PC;
-    while (i >= start_pc && i <= end_PC)
+    int i = pos - 1;
+    while (cycles > 0 && i >= 0)
     {
-        //Update any instructions succeeded by a flag instruction to get the correct instance
-        if (instr_info[i].flag_instruction)
-        {
-            if (instr_info[i].flag_instruction == FlagInstr_Clip)
-            {
-                clip_instruction_found = true;
-                clip_cycles = 5;
-            }
-            if (instr_info[i].flag_instruction == FlagInstr_Mac)
-            {
-                mac_instruction_found = true;
-                mac_cycles = 5;
-            }
-        }
+        instr_info[block_pcs[i]].advance_mac_pipeline = true;
+        cycles -= instr_info[block_pcs[i]].stall_amount + 1;
+        i--;
+    }
 
-        //Update the flags at the end of the block ready for the next block in case of flag read instruction
-        if (i >= (end_PC - 32) || final_mac_instance_found == false)
-        {
-            needs_update = true;
-        }
+    if (cycles > 0 || !needs_result)
+        return;
 
-        //Update the flags at the beginning of a block also, I'm scared of subroutines checking flags
-        if (i <= (start_pc + 32))
+    for (; i >= 0; i--)
+    {
+        if (instr_info[block_pcs[i]].has_mac_result)
         {
-            needs_update = true;
+            instr_info[block_pcs[i]].update_mac_pipeline = true;
+            return;
         }
+    }
+}
 
-        //Always update the pipe for flag instances
-        if (mac_instruction_found)
-        {
-            needs_update = true;
-            mac_cycles -= instr_info[i].stall_amount;
-            if (mac_cycles <= 0 && instr_info[i].has_mac_result) //Need to check if timed position is a NOP
-                mac_instruction_found = false;
-        }
+/**
+ * Checks if code entered at PC can read a flag instance from before it was entered.
+ * This is the case for any flag read before one of its own FMAC results has had time to reach the flags.
+ * Anything that makes the code past that point unknown (branches, E/M/T-bit, XGKICK exits) is treated as a read.
+ */
+bool VU_JitTranslator::successor_reads_flags(VectorUnit &vu, uint8_t *instr_mem, uint16_t PC)
+{
+    int last_result = -1;
+    for (int i = 0; i < 16; i++)
+    {
+        if (last_result >= 0 && i - last_result >= 4)
+            return false;
+
+        PC &= vu.mem_mask;
+        uint32_t upper = *(uint32_t*)&instr_mem[PC + 4];
+        uint32_t lower = *(uint32_t*)&instr_mem[PC];
+
+        //E-bit, M-bit, D-bit and T-bit
+        if (upper & (0xF << 27))
+            return true;
 
-        if (clip_instruction_found)
+        if (!(upper & (1 << 31)))
         {
-            needs_update = true;
-            clip_cycles -= instr_info[i].stall_amount;
-            if (clip_cycles <= 0) //TODO When CLIP is implemented, make sure we get all the CLIP instructions
-                clip_instruction_found = false;
+            switch (is_flag_instruction(lower))
+            {
+                case FlagInstr_Mac:
+                case FlagInstr_Status:
+                    return true;
+                case FlagInstr_Clip:
+                    //Clip flags are always calculated, only the pipeline advance can come from us
+                    if (i < 4)
+                        return true;
+                    break;
+                default:
+                    break;
+            }
+
+            //Branches
+            if ((lower & 0xC0000000) == 0x40000000)
+                return true;
+
+            //XGKICK
+            if ((lower & (1 << 31)) && (lower & 0x7FF) == 0x6FC)
+                return true;
         }
 
-        //Always update for clip instructions also, probably not needed but just in case
-        if (instr_info[i].has_clip_result)
+        if (updates_mac_flags(upper))
+            last_result = i;
+
+        PC += 8;
+    }
+    return true;
+}
+
+//Checks if whatever runs after this block can read flag instances from inside it
+bool VU_JitTranslator::exit_reads_flags(VectorUnit &vu, uint8_t *instr_mem)
+{
+    VU_InstrInfo& last = instr_info[end_PC];
+
+    //Interlocks let the EE read the flags
+    if (last.is_mbit)
+        return true;
+
+    if (!last.branch_delay_slot)
+        return successor_reads_flags(vu, instr_mem, end_PC + 8);
+
+    //Branch in the delay slot, we can't know where we end up
+    if (last.is_branch)
+        return true;
+
+    uint16_t branch_PC = (end_PC - 8) & vu.mem_mask;
+    uint32_t lower = *(uint32_t*)&instr_mem[branch_PC];
+    switch ((lower >> 25) & 0x7F)
+    {
+        //B/BAL
+        case 0x20:
+        case 0x21:
+            return successor_reads_flags(vu, instr_mem, branch_offset(lower, branch_PC));
+        //IBEQ/IBNE/IBLTZ/IBGTZ/IBLEZ/IBGEZ
+        case 0x28:
+        case 0x29:
+        case 0x2C:
+        case 0x2D:
+        case 0x2E:
+        case 0x2F:
+            return successor_reads_flags(vu, instr_mem, branch_offset(lower, branch_PC)) ||
+                   successor_reads_flags(vu, instr_mem, end_PC + 8);
+        //JR/JALR
+        default:
+            return true;
+    }
+}
+
+/**
+ * Determine when MAC, clip, and status flags need to be updated.
+ * This is a backwards liveness pass: only FMAC results and pipeline advances which a flag read in this block,
+ * a flag read in a known successor, or the state at the end of the program can observe are kept.
+ */
+void VU_JitTranslator::flag_pass(VectorUnit &vu, uint8_t *instr_mem)
+{
+    std::vector<uint16_t> block_pcs;
+    uint16_t PC = vu.get_PC() & vu.mem_mask;
+    while (true)
+    {
+        block_pcs.push_back(PC);
+        if (PC == end_PC)
+            break;
+        PC = (PC + 8) & vu.mem_mask;
+    }
+    int block_size = (int)block_pcs.size();
+
+    //Status writes from FSSET and the FDIV unit are only applied by advancing the pipeline
+    int status_cycles = 0;
+    for (int i = 0; i < block_size; i++)
+    {
+        VU_InstrInfo& info = instr_info[block_pcs[i]];
+        if (status_cycles > 0)
         {
-            needs_update = true;
+            info.advance_mac_pipeline = true;
+            status_cycles -= info.stall_amount + 1;
         }
 
-        if (needs_update)
+        uint32_t upper = *(uint32_t*)&instr_mem[block_pcs[i] + 4];
+        uint32_t lower = *(uint32_t*)&instr_mem[block_pcs[i]];
+        status_cycles = std::max(status_cycles, status_write_delay(upper, lower));
+    }
+
+    //Flag reads inside the block
+    for (int i = block_size - 1; i >= 0; i--)
+    {
+        VU_InstrInfo& info = instr_info[block_pcs[i]];
+        if (info.flag_instruction == FlagInstr_Clip)
+            mark_live_flags(block_pcs, i + 1, 4, false);
+        else if (info.flag_instruction != FlagInstr_None)
+            mark_live_flags(block_pcs, i + 1, 4, true);
+
+        //XGKICK may stall and exit the block right after this instruction
+        uint32_t upper = *(uint32_t*)&instr_mem[block_pcs[i] + 4];
+        uint32_t lower = *(uint32_t*)&instr_mem[block_pcs[i]];
+        if (i != block_size - 1 && !(upper & (1 << 31)) && (lower & (1 << 31)) && (lower & 0x7FF) == 0x6FC)
         {
-            instr_info[i].advance_mac_pipeline = true;
-            if (instr_info[i].has_mac_result)
-            {
-                final_mac_instance_found = true;
-                instr_info[i].update_mac_pipeline = true;
-            }
-            needs_update = false;
+            if (successor_reads_flags(vu, instr_mem, block_pcs[i] + 8))
+                mark_live_flags(block_pcs, i + 1, 3, true);
         }
-
-        i -= 8;
     }
+
+    //The end of the program leaves the last FMAC result in the flags, as the pipeline is flushed on E-bit
+    VU_InstrInfo& last = instr_info[end_PC];
+    if (last.ebit_delay_slot || last.tbit_end)
+        mark_live_flags(block_pcs, block_size, 0, true);
+    else if (exit_reads_flags(vu, instr_mem))
+        mark_live_flags(block_pcs, block_size, 3, true);
 }
 
 void VU_JitTranslator::fallback_interpreter(IR::Instruction &instr, uint32_t instr_word, bool is_upper)
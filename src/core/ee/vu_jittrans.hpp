@@ -20,6 +20,7 @@ enum VU_FlagInstrType
 {
     FlagInstr_None,
     FlagInstr_Mac,
+    FlagInstr_Status,
     FlagInstr_Clip
 };
 
@@ -76,6 +77,7 @@ class VU_JitTranslator
         int fdiv_pipe_cycles(uint32_t lower_instr);
         int efu_pipe_cycles(uint32_t lower_instr);
         int is_flag_instruction(uint32_t lower_instr);
+        int status_write_delay(uint32_t upper_instr, uint32_t lower_instr);
         bool updates_mac_flags(uint32_t upper_instr);
         bool updates_mac_flags_special(uint32_t upper_instr);
 
@@ -84,7 +86,10 @@ class VU_JitTranslator
         void analyze_FMAC_stalls(VectorUnit &vu, uint16_t PC);
         void populate_vu_state(VectorUnit &vu, int q_pipe_delay, int p_pipe_delay, uint16_t PC);
         void interpreter_pass(VectorUnit& vu, uint8_t *instr_mem, uint32_t prev_pc);
-        void flag_pass(VectorUnit& vu);
+        void flag_pass(VectorUnit& vu, uint8_t *instr_mem);
+        void mark_live_flags(const std::vector<uint16_t>& block_pcs, int pos, int cycles, bool needs_result);
+        bool successor_reads_flags(VectorUnit& vu, uint8_t *instr_mem, uint16_t PC);
+        bool exit_reads_flags(VectorUnit& vu, uint8_t *instr_mem);
 
         void fallback_interpreter(IR::Instruction& instr, uint32_t instr_word, bool is_upper);
         void update_xgkick(std::vector<IR::Instruction>& instrs);
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cfenv>
 #include <cstring>
 #include <cstdio>
@@ -8,6 +9,8 @@
 
 #include "ee/vu_jit.hpp"
 #include "ee/ee_jit.hpp"
+#include "iop/iop_jit.hpp"
+#include "iop/iop_predecode.hpp"
 
 /* Notes of timings from PS2*/
 /*
@@ -36,6 +39,12 @@ EE Cycles Per Frame between 5926400 & 5926912
 #define HBLANK_CYCLES 18742
 #define GS_VBLANK_DELAY 65622 //CSR FIELD swap/vblank happens ~65622 cycles after the INTC VBLANK_START event
 
+//The SPU2 outputs at 48000 Hz
+#define SPU_SAMPLE_CYCLES (768 * 8)
+//Samples are rendered in blocks, and only when something looks at the SPUs before the block is over.
+//IRQA hits only reach the IOP once their sample is rendered, so a block ends on the sample with the next one
+#define SPU_BLOCK_SAMPLES 128
+
 //These constants are used for the fast boot hack for .isos
 #define EELOAD_START 0x82000
 #define EELOAD_SIZE 0x20000
@@ -71,15 +80,31 @@ Emulator::Emulator() :
     ELF_file = nullptr;
     ELF_size = 0;
     gsdump_single_frame = false;
+    save_failed = false;
+    rewind_interval = 0;
+    rewind_countdown = 0;
+    rewind_interval_setting = 0;
+    rewind_budget_setting = 0;
+    rewind_settings_changed = false;
+    rewind_clear_requested = false;
+    rewind_requested = false;
+    rewind_steps = 0;
+    rewind_count = 0;
     ee_log.open("ee_log.txt", std::ios::out);
     set_ee_mode(CPU_MODE::DONT_CARE);
     set_vu0_mode(CPU_MODE::DONT_CARE);
     set_vu1_mode(CPU_MODE::DONT_CARE);
+    set_iop_mode(CPU_MODE::DONT_CARE);
+    set_max_idle_run_cycles(256);
     spu.gaussianConstructTable();
+    spu.set_sync_func([this] { sync_sound(); });
+    spu2.set_sync_func([this] { sync_sound(); });
+    spu2.set_audio_output(&audio_output);
 }
 
 Emulator::~Emulator()
 {
+    finish_save_state();
     if (ee_log.is_open())
         ee_log.close();
     delete[] RDRAM;
@@ -95,10 +120,21 @@ void Emulator::run()
     VBLANK_sent = false;
     const int originalRounding = fegetround();
     fesetround(FE_TOWARDZERO);
+    if (save_failed)
+    {
+        save_failed = false;
+        Errors::non_fatal("Failed to save state");
+    }
     if (save_requested)
         save_state(save_state_path.c_str());
     if (load_requested)
         load_state(save_state_path.c_str());
+    if (rewind_settings_changed || rewind_clear_requested)
+        update_rewind_settings();
+    if (rewind_requested)
+        rewind_state();
+    else if (rewind_interval && --rewind_countdown <= 0)
+        capture_rewind_state();
     if (gsdump_requested)
     {
         gsdump_requested = false;
@@ -128,24 +164,38 @@ void Emulator::run()
     
     while (!frame_ended)
     {
-        int ee_cycles = scheduler.calculate_run_cycles();
+        //Nothing needs to stay in lockstep with the EE while everything else is idle, so let it run ahead
+        int max_cycles = Scheduler::DEFAULT_RUN_CYCLES;
+        if (max_idle_run_cycles > max_cycles && only_ee_active())
+            max_cycles = max_idle_run_cycles;
+
+        int ee_cycles = scheduler.calculate_run_cycles(max_cycles);
         int bus_cycles = scheduler.get_bus_run_cycles();
         int iop_cycles = scheduler.get_iop_run_cycles();
         scheduler.update_cycle_counts();
 
         cpu.run(ee_cycles);
-        iop_dma.run(iop_cycles);
+        if (iop_dma.is_active())
+            iop_dma.run(iop_cycles);
         iop.run(iop_cycles);
+        if (spu.take_state_changed() | spu2.take_state_changed())
+            update_sound_sample_event();
 
-        dmac.run(bus_cycles);
+        if (dmac.is_active())
+            dmac.run(bus_cycles);
         ipu.run();
-        vif0.update(bus_cycles);
-        vif1.update(bus_cycles);
-        gif.run(bus_cycles);
+        if (!vif0.is_idle())
+            vif0.update(bus_cycles);
+        if (!vif1.is_idle())
+            vif1.update(bus_cycles);
+        if (!gif.is_idle())
+            gif.run(bus_cycles);
         
         //VU's run at EE speed, however both maintain their own speed
+        //VU0 always runs as its pipelines are also used by COP2
         vu0.run_func(vu0);
-        vu1.run_func(vu1);
+        if (!vu1.is_idle())
+            vu1.run_func(vu1);
 
         scheduler.process_events();
     }
@@ -153,6 +203,19 @@ void Emulator::run()
 }
 
 void Emulator::reset()
+{
+    reset_hardware(false);
+
+    //Nothing translated for the previous run can be trusted
+    VU_JIT::reset(&vu0);
+    VU_JIT::reset(&vu1);
+    EE_JIT::reset(true);
+    IOP_JIT::reset(&iop);
+    IOP_Predecode::reset();
+}
+
+//Rewinding keeps the WAV dumps going and leaves IOP RAM as it is, so that it can be compared against the snapshot
+void Emulator::reset_hardware(bool rewinding)
 {
     save_requested = false;
     load_requested = false;
@@ -193,16 +256,13 @@ void Emulator::reset()
     pad.reset();
     sif.reset();
     sio2.reset();
-    spu.reset(SPU_RAM);
-    spu2.reset(SPU_RAM);
+    spu.reset(SPU_RAM, rewinding);
+    spu2.reset(SPU_RAM, rewinding);
     timers.reset();
     vif0.reset();
     vif1.reset();
     vu0.reset();
     vu1.reset();
-    VU_JIT::reset(&vu0);
-    VU_JIT::reset(&vu1);
-    EE_JIT::reset(true);
 
     MCH_DRD = 0;
     MCH_RICM = 0;
@@ -211,7 +271,8 @@ void Emulator::reset()
     clear_cop2_interlock();
 
     // HLE method to zero out IOP memory
-    memset(IOP_RAM, 0, 0x00200000);
+    if (!rewinding)
+        memset(IOP_RAM, 0, 0x00200000);
 
     iop_scratchpad_start = 0x1F800000;
 
@@ -222,6 +283,7 @@ void Emulator::reset()
     gs_vblank_event_id = scheduler.register_function([this](uint64_t param) { GS_vblank_event(); });
 
     scheduler.add_event(hblank_event_id, HBLANK_CYCLES);
+    sound_sample_cycles = 0;
     start_sound_sample_event();
 }
 
@@ -273,18 +335,56 @@ void Emulator::cdvd_event()
     cdvd.handle_N_command();
 }
 
+int64_t Emulator::get_sound_block_end()
+{
+    int block_size = SPU_BLOCK_SAMPLES;
+    block_size = spu.samples_until_irq(block_size);
+    block_size = spu2.samples_until_irq(block_size);
+    return sound_sample_cycles + block_size * SPU_SAMPLE_CYCLES;
+}
+
 void Emulator::start_sound_sample_event()
 {
-    scheduler.add_event(spu_event_id, 768 * 8);
+    sound_event_cycles = get_sound_block_end();
+    sound_event_id = scheduler.add_event(spu_event_id, sound_event_cycles - scheduler.get_ee_cycles());
+}
+
+//Writes to the SPUs can bring the next IRQA hit closer, in which case the block ends earlier
+void Emulator::update_sound_sample_event()
+{
+    sync_sound();
+    int64_t block_end = get_sound_block_end();
+    if (block_end < sound_event_cycles)
+    {
+        sound_event_cycles = block_end;
+        scheduler.set_event_time(sound_event_id, sound_event_cycles);
+    }
 }
 
 void Emulator::gen_sound_sample()
 {
-    spu.gen_sample();
-    spu2.gen_sample();
+    sync_sound();
     start_sound_sample_event();
 }
 
+void Emulator::sync_sound()
+{
+    int64_t samples = (scheduler.get_ee_cycles() - sound_sample_cycles) / SPU_SAMPLE_CYCLES;
+    if (samples <= 0)
+        return;
+
+    sound_sample_cycles += samples * SPU_SAMPLE_CYCLES;
+
+    //Core 1 mixes in the output of core 0, so core 0 goes first for every block
+    while (samples > 0)
+    {
+        int block_size = std::min(samples, (int64_t)SPU::MAX_BLOCK_SAMPLES);
+        spu.gen_samples(block_size);
+        spu2.gen_samples(block_size);
+        samples -= block_size;
+    }
+}
+
 void Emulator::press_button(PAD_BUTTON button)
 {
     pad.press_button(button);
@@ -362,6 +462,21 @@ void Emulator::set_skip_BIOS_hack(SKIP_HACK type)
     skip_BIOS_hack = type;
 }
 
+/**
+ * Sets how far the EE may run ahead in one slice while the IOP is halted and every other unit is idle.
+ * Anything at or below Scheduler::DEFAULT_RUN_CYCLES always runs in lockstep slices, which is the most accurate.
+ **/
+void Emulator::set_max_idle_run_cycles(int cycles)
+{
+    max_idle_run_cycles = cycles;
+}
+
+bool Emulator::only_ee_active()
+{
+    return iop.is_idle() && !iop_dma.is_active() && !dmac.is_active() && !ipu.is_busy() &&
+           vif0.is_idle() && vif1.is_idle() && gif.is_idle() && !vu0.is_running() && vu1.is_idle();
+}
+
 void Emulator::set_ee_mode(CPU_MODE mode)
 {
     switch (mode)
@@ -410,6 +525,24 @@ void Emulator::set_vu1_mode(CPU_MODE mode)
     VU_JIT::reset(&vu1);
 }
 
+void Emulator::set_iop_mode(CPU_MODE mode)
+{
+    //The IOP JIT is still experimental, so it has to be asked for.
+    //Otherwise the predecoded interpreter is used, which falls back to plain interpretation for disassembly.
+    switch (mode)
+    {
+        case CPU_MODE::JIT:
+            iop.set_run_func(&IOP::run_jit);
+            break;
+        case CPU_MODE::INTERPRETER:
+        default:
+            iop.set_run_func(&IOP::run_predecoded);
+            break;
+    }
+
+    IOP_JIT::reset(&iop);
+}
+
 void Emulator::load_BIOS(const uint8_t *BIOS_file)
 {
     if (!BIOS)
@@ -426,6 +559,7 @@ void Emulator::load_ELF(const uint8_t *ELF, uint32_t size)
         return;
     }
     printf("Valid elf\n");
+    rewind_clear_requested = true;
     delete[] ELF_file;
     ELF_file = new uint8_t[size];
     ELF_size = size;
@@ -434,6 +568,7 @@ void Emulator::load_ELF(const uint8_t *ELF, uint32_t size)
 
 bool Emulator::load_CDVD(const char *name, CDVD_CONTAINER type)
 {
+    rewind_clear_requested = true;
     return cdvd.load_disc(name, type);
 }
 
@@ -449,6 +584,11 @@ std::string Emulator::get_serial()
     return cdvd.get_serial();
 }
 
+VectorUnit& Emulator::get_vu(int id)
+{
+    return (id) ? vu1 : vu0;
+}
+
 void Emulator::execute_ELF()
 {
     if (!ELF_file)
@@ -760,6 +900,7 @@ void Emulator::write8(uint32_t address, uint8_t value)
     if (address >= 0x1C000000 && address < 0x1C200000)
     {
         IOP_RAM[address & 0x1FFFFF] = value;
+        IOP_JIT::invalidate(address & 0x1FFFFF, sizeof(value));
         return;
     }
     if (address >= 0x11000000 && address < 0x11004000)
@@ -802,6 +943,7 @@ void Emulator::write16(uint32_t address, uint16_t value)
     if (address >= 0x1C000000 && address < 0x1C200000)
     {
         *(uint16_t*)&IOP_RAM[address & 0x1FFFFF] = value;
+        IOP_JIT::invalidate(address & 0x1FFFFF, sizeof(value));
         return;
     }
     if (address >= 0x11000000 && address < 0x11004000)
@@ -837,6 +979,7 @@ void Emulator::write32(uint32_t address, uint32_t value)
     if (address >= 0x1C000000 && address < 0x1C200000)
     {
         *(uint32_t*)&IOP_RAM[address & 0x1FFFFF] = value;
+        IOP_JIT::invalidate(address & 0x1FFFFF, sizeof(value));
         return;
     }
     if (address >= 0x10000000 && address < 0x10002000)
@@ -970,6 +1113,7 @@ void Emulator::write64(uint32_t address, uint64_t value)
     if (address >= 0x1C000000 && address < 0x1C200000)
     {
         *(uint64_t*)&IOP_RAM[address & 0x1FFFFF] = value;
+        IOP_JIT::invalidate(address & 0x1FFFFF, sizeof(value));
         return;
     }
     if (address >= 0x10000000 && address < 0x10002000)
@@ -1328,6 +1472,7 @@ void Emulator::iop_write8(uint32_t address, uint8_t value)
     {
         //printf("[IOP] Write to $%08X of $%02X\n", address, value);
         IOP_RAM[address] = value;
+        IOP_JIT::invalidate(address, sizeof(value));
         return;
     }
     switch (address)
@@ -1383,6 +1528,7 @@ void Emulator::iop_write16(uint32_t address, uint16_t value)
     {
         //printf("[IOP] Write16 to $%08X of $%08X\n", address, value);
         *(uint16_t*)&IOP_RAM[address] = value;
+        IOP_JIT::invalidate(address, sizeof(value));
         return;
     }
     if ((address >= 0x1F900000 && address < 0x1F900400) || (address >= 0x1F900760 && address < 0x1F900788))
@@ -1511,6 +1657,7 @@ void Emulator::iop_write32(uint32_t address, uint32_t value)
     {
         //printf("[IOP] Write to $%08X of $%08X\n", address, value);
         *(uint32_t*)&IOP_RAM[address] = value;
+        IOP_JIT::invalidate(address, sizeof(value));
         return;
     }
     //SIO2 send buffers
@@ -1825,6 +1972,23 @@ void Emulator::set_wav_output(bool state)
     spu2.wav_output = state;
 }
 
+void Emulator::start_audio_output(std::unique_ptr<AudioSink> sink)
+{
+    audio_output.start(std::move(sink));
+}
+
+void Emulator::stop_audio_output()
+{
+    audio_output.stop();
+}
+
+//Waits until the audio output has room for another frame's worth of samples.
+//Returns false when there is no audio output, in which case the caller has to pace frames some other way.
+bool Emulator::wait_for_audio_output()
+{
+    return audio_output.wait_for_space();
+}
+
 void Emulator::request_gsdump_toggle()
 {
     gsdump_requested = true;
@@ -2,6 +2,7 @@
 #define EMULATOR_HPP
 #include <fstream>
 #include <functional>
+#include <thread>
 
 #include "ee/dmac.hpp"
 #include "ee/emotion.hpp"
@@ -22,10 +23,13 @@
 #include "iop/spu/spu.hpp"
 #include "iop/firewire.hpp"
 
+#include "audio/audio_output.hpp"
+
 #include "int128.hpp"
 #include "gs.hpp"
 #include "gif.hpp"
 #include "sif.hpp"
+#include "rewind.hpp"
 #include "scheduler.hpp"
 
 enum SKIP_HACK
@@ -47,6 +51,39 @@ class Emulator
     private:
         std::atomic_bool save_requested, load_requested, gsdump_requested, gsdump_single_frame, gsdump_running;
         std::string save_state_path;
+
+        //Compresses and writes the last snapshot taken by save_state
+        std::thread save_thread;
+        std::atomic_bool save_failed;
+        void finish_save_state();
+
+        void load_stream_state(std::ifstream& file, uint32_t rev);
+
+        void reset_hardware(bool rewinding);
+
+        //Every section of a state in order. section() hands out the stream for a section,
+        //and block() stores a large block of memory. rev is the revision the sections were saved with.
+        //rewinding loads over the running state without starting sound dumps or code translation over
+        void load_sections(const std::function<std::istream&(const char*)>& section,
+                           const std::function<void(const char*, void*, uint64_t)>& block, uint32_t rev,
+                           bool rewinding = false);
+        void save_sections(const std::function<std::ostream&(const char*)>& section,
+                           const std::function<void(const char*, const void*, uint64_t)>& block);
+
+        //The history and the settings in use are only touched by the emulation thread.
+        //Other threads leave their changes in the atomics below, which run() picks up at the start of a frame
+        RewindBuffer rewind_buffer;
+        int rewind_interval, rewind_countdown;
+        std::atomic_int rewind_interval_setting;
+        std::atomic<uint64_t> rewind_budget_setting;
+        std::atomic_bool rewind_settings_changed, rewind_clear_requested;
+        std::atomic_bool rewind_requested;
+        std::atomic_int rewind_steps;
+        std::atomic_int rewind_count;
+        void update_rewind_settings();
+        void clear_rewind_history();
+        void capture_rewind_state();
+        void rewind_state();
         int frames;
         Cop0 cp0;
         Cop1 fpu;
@@ -67,6 +104,7 @@ class Emulator
         Scheduler scheduler;
         SIO2 sio2;
         SPU spu, spu2;
+        AudioOutput audio_output;
         SubsystemInterface sif;
         VectorInterface vif0, vif1;
         VectorUnit vu0, vu1;
@@ -101,10 +139,22 @@ class Emulator
         uint8_t* ELF_file;
         uint32_t ELF_size;
 
+        //EE cycle at which the last rendered SPU sample was due
+        int64_t sound_sample_cycles;
+        //The one pending sound event, and the EE cycle it's scheduled for
+        uint64_t sound_event_id;
+        int64_t sound_event_cycles;
+
         void iop_IRQ_check(uint32_t new_stat, uint32_t new_mask);
+        int64_t get_sound_block_end();
         void start_sound_sample_event();
+        void update_sound_sample_event();
+        void sync_sound();
 
         bool frame_ended;
+
+        int max_idle_run_cycles;
+        bool only_ee_active();
     public:
         Emulator();
         ~Emulator();
@@ -117,14 +167,17 @@ class Emulator
         bool skip_BIOS();
         void fast_boot();
         void set_skip_BIOS_hack(SKIP_HACK type);
+        void set_max_idle_run_cycles(int cycles);
         void set_ee_mode(CPU_MODE mode);
         void set_vu0_mode(CPU_MODE mode);
         void set_vu1_mode(CPU_MODE mode);
+        void set_iop_mode(CPU_MODE mode);
         void load_BIOS(const uint8_t* BIOS);
         void load_ELF(const uint8_t* ELF, uint32_t size);
         bool load_CDVD(const char* name, CDVD_CONTAINER type);
         void load_memcard(int port, const char* name);
         std::string get_serial();
+        VectorUnit& get_vu(int id);
         void execute_ELF();
         uint32_t* get_framebuffer();
         void get_resolution(int& w, int& h);
@@ -145,6 +198,14 @@ class Emulator
         void load_state(const char* file_name);
         void save_state(const char* file_name);
 
+        //Captures a state into memory every interval frames, 0 turns rewinding off.
+        //The oldest captures are dropped once the history takes more than budget bytes,
+        //and budgets too small to keep any history are raised to RewindBuffer's minimum.
+        //These are safe to call from any thread, they take effect at the start of the next frame
+        void set_rewind(int interval, uint64_t budget);
+        void request_rewind(int steps);
+        int get_rewind_count();
+
         bool interlock_cop2_check(bool isCOP2);
         void clear_cop2_interlock();
         bool check_cop2_interlock();
@@ -177,6 +238,9 @@ class Emulator
         GraphicsSynthesizer& get_gs();//used for gs dumps
 
         void set_wav_output(bool state);
+        void start_audio_output(std::unique_ptr<AudioSink> sink);
+        void stop_audio_output();
+        bool wait_for_audio_output();
 };
 
 #endif // EMULATOR_HPP
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstdio>
 #include "ee/dmac.hpp"
 #include "gif.hpp"
@@ -87,217 +88,39 @@ void GraphicsInterface::write_CTRL(uint32_t value)
     gif_temporary_stop = value & 0x2;
 }
 
-void GraphicsInterface::process_PACKED(uint128_t data)
-{
-    uint64_t data1 = data._u64[0];
-    uint64_t data2 = data._u64[1];
-    //printf("[GIF] PACKED: $%08X_%08X_%08X_%08X\n", data._u32[3], data._u32[2], data._u32[1], data._u32[0]);
-    uint64_t reg_offset = (path[active_path].current_tag.reg_count - path[active_path].current_tag.regs_left) << 2;
-    uint8_t reg = (path[active_path].current_tag.regs >> reg_offset) & 0xF;
-    switch (reg)
-    {
-        case 0x0:
-            //PRIM
-            gs->write64(0, data1);
-            break;
-        case 0x1:
-            //RGBAQ - set RGBA
-            //Q is taken from the ST command
-        {
-            uint8_t r = data1 & 0xFF;
-            uint8_t g = (data1 >> 32) & 0xFF;
-            uint8_t b = data2 & 0xFF;
-            uint8_t a = (data2 >> 32) & 0xFF;
-            gs->set_RGBA(r, g, b, a, internal_Q);
-        }
-            break;
-        case 0x2:
-        {
-            //ST - set ST coordinates and Q
-            uint32_t s = data1 & 0xFFFFFF00;
-            uint32_t t = (data1 >> 32) & 0xFFFFFF00;
-            uint32_t q = data2 & 0xFFFFFF00;
-
-            if ((s & 0x7F800000) == 0x7F800000)
-                s = (s & 0x80000000) | 0x7F7FFFFF;
-
-            if ((t & 0x7F800000) == 0x7F800000)
-                t = (t & 0x80000000) | 0x7F7FFFFF;
-
-            if ((q & 0x7F800000) == 0x7F800000)
-                q = (q & 0x80000000) | 0x7F7FFFFF;
-            internal_Q = *(float*)&q;
-            gs->set_ST(s, t);
-        }
-            break;
-        case 0x3:
-            //UV - set UV coordinates
-        {
-            uint16_t u = data1 & 0x3FFF;
-            uint16_t v = (data1 >> 32) & 0x3FFF;
-            gs->set_UV(u, v);
-        }
-            break;
-        case 0x4:
-            //XYZF2 - set XYZ and fog coefficient. Optionally disable drawing kick through bit 111
-        {
-            uint32_t x = data1 & 0xFFFF;
-            uint32_t y = (data1 >> 32) & 0xFFFF;
-            uint32_t z = (data2 >> 4) & 0xFFFFFF;
-            bool disable_drawing = (data2 >> (111 - 64)) & 0x1;
-            uint8_t fog = (data2 >> (100 - 64)) & 0xFF;
-            gs->set_XYZF(x, y, z, fog, !disable_drawing);
-        }
-            break;
-        case 0x5:
-        //XYZ2 - set XYZ. Optionally disable drawing kick through bit 111
-        {
-            uint32_t x = data1 & 0xFFFF;
-            uint32_t y = (data1 >> 32) & 0xFFFF;
-            uint32_t z = data2 & 0xFFFFFFFF;
-            bool disable_drawing = (data2 >> (111 - 64)) & 0x1;
-            gs->set_XYZ(x, y, z, !disable_drawing);
-        }
-            break;
-        case 0xA:
-        {
-            //FOG
-            uint64_t value = data2 << 20;
-            gs->write64(0xA, value);
-        }
-            break;
-        case 0xE:
-        {
-            //A+D: output data to address
-            uint32_t addr = data2 & 0xFF;
-            if(addr != 0x7F)
-                gs->write64(addr, data1);
-        }
-            break;
-        case 0xF:
-            //NOP
-            break;
-        default:
-            gs->write64(reg, data1);
-            break;
-    }
-}
-
-void GraphicsInterface::process_REGLIST(uint128_t data)
-{
-    //printf("[GIF] Reglist: $%08X_%08X_%08X_%08X\n", data._u32[3], data._u32[2], data._u32[1], data._u32[0]);
-    for (int i = 0; i < 2; i++)
-    {
-        uint64_t reg_offset = (path[active_path].current_tag.reg_count - path[active_path].current_tag.regs_left) << 2;
-        uint8_t reg = (path[active_path].current_tag.regs >> reg_offset) & 0xF;
-
-        //A+D is a NOP in REGLIST mode
-        if(reg != 0xE)
-            gs->write64(reg, data._u64[i]);
-
-        path[active_path].current_tag.regs_left--;
-        if (!path[active_path].current_tag.regs_left)
-        {
-            path[active_path].current_tag.regs_left = path[active_path].current_tag.reg_count;
-            path[active_path].current_tag.data_left--;
-
-            //If NREGS * NLOOP is odd, discard the last 64 bits of data
-            if (!path[active_path].current_tag.data_left && i == 0)
-                return;
-        }
-    }
-}
-
 void GraphicsInterface::feed_GIF(uint128_t data)
 {
     //printf("[GIF] Data: $%08X_%08X_%08X_%08X\n", data._u32[3], data._u32[2], data._u32[1], data._u32[0]);
-    uint64_t data1 = data._u64[0];
-    uint64_t data2 = data._u64[1];
+    GIFtag& tag = path[active_path].current_tag;
+    bool new_tag = !tag.data_left;
     outputting_path = true;
-    if (!path[active_path].current_tag.data_left)
+
+    unpack_GIF_quad(tag, internal_Q, data, *gs);
+
+    if (new_tag)
     {
-        //Read new GIFtag
-        path[active_path].current_tag.NLOOP = data1 & 0x7FFF;
-        path[active_path].current_tag.end_of_packet = data1 & (1 << 15);
-        path[active_path].current_tag.output_PRIM = (data1 >> 46) & 0x1;
-        path[active_path].current_tag.PRIM = (data1 >> 47) & 0x7FF;
-        path[active_path].current_tag.format = (data1 >> 58) & 0x3;
-        path[active_path].current_tag.reg_count = data1 >> 60;
-        if (!path[active_path].current_tag.reg_count)
-            path[active_path].current_tag.reg_count = 16;
-        path[active_path].current_tag.regs = data2;
-        path[active_path].current_tag.regs_left = path[active_path].current_tag.reg_count;
-        path[active_path].current_tag.data_left = path[active_path].current_tag.NLOOP;
-
-        path_status[active_path] = path[active_path].current_tag.format;
-        
-       
-        //Q is initialized to 1.0 upon reading a GIFtag
-        internal_Q = 1.0f;
-
-        //Ignore zeroed out packets
-        /*if (data1)
-        {
-            printf("[GIF] PATH%d New primitive!\n", active_path);
-            printf("NLOOP: $%04X\n", path[active_path].current_tag.NLOOP);
-            printf("EOP: %d\n", path[active_path].current_tag.end_of_packet);
-            printf("Output PRIM: %d PRIM: $%04X\n", path[active_path].current_tag.output_PRIM, path[active_path].current_tag.PRIM);
-            printf("Format: %d\n", path[active_path].current_tag.format);
-            printf("Reg count: %d\n", path[active_path].current_tag.reg_count);
-            printf("Regs: $%08X_$%08X\n", path[active_path].current_tag.regs >> 32, path[active_path].current_tag.regs & 0xFFFFFFFF);
-        }*/
+        path_status[active_path] = tag.format;
 
         //NOP GIFTags ignore all fields except EOP
-        if (path[active_path].current_tag.data_left != 0)
-        {
+        if (tag.data_left)
             gs->set_CSR_FIFO(0x2); //FIFO Full
-
-            if (path[active_path].current_tag.output_PRIM && path[active_path].current_tag.format == 0)
-            {
-                gs->write64(0, path[active_path].current_tag.PRIM);
-            }
-        }
     }
-    else
-    {
-        switch (path[active_path].current_tag.format)
-        {
-            case 0:
-                process_PACKED(data);
-                path[active_path].current_tag.regs_left--;
-                if (!path[active_path].current_tag.regs_left)
-                {
-                    path[active_path].current_tag.regs_left = path[active_path].current_tag.reg_count;
-                    path[active_path].current_tag.data_left--;
-                }
-                break;
-            case 1:
-                process_REGLIST(data);
-                break;
-            case 2:
-            case 3:
-                gs->write64(0x54, data1);
-                gs->write64(0x54, data2);
-                path[active_path].current_tag.data_left--;
-                break;
-            default:
-                printf("[GS] Unrecognized GIFtag format %d\n", path[active_path].current_tag.format);
-                break;
-        }
-    }
-    if (!path[active_path].current_tag.data_left && path[active_path].current_tag.end_of_packet)
+    if (!tag.data_left && tag.end_of_packet)
+        end_packet();
+}
+
+void GraphicsInterface::end_packet()
+{
+    path_status[active_path] = 4;
+    //Finish asserts after all host->local transfers have finished
+    if (path_queue == 0)
     {
-        path_status[active_path] = 4;
-        //Finish asserts after all host->local transfers have finished
-        if (path_queue == 0)
-        {
-            gs->assert_FINISH();
-            gs->set_CSR_FIFO(0x1); //FIFO Empty
-            outputting_path = false;
-        }
-        gs->wake_gs_thread();
-        deactivate_PATH(active_path);
+        gs->assert_FINISH();
+        gs->set_CSR_FIFO(0x1); //FIFO Empty
+        outputting_path = false;
     }
+    gs->wake_gs_thread();
+    deactivate_PATH(active_path);
 }
 
 void GraphicsInterface::run(int cycles)
@@ -314,6 +137,12 @@ void GraphicsInterface::run(int cycles)
     }
 }
 
+//run() has nothing to do once the FIFO is empty, unless PATH3 still holds the bus and may have to be masked off
+bool GraphicsInterface::is_idle()
+{
+    return fifo_empty() && path3_done();
+}
+
 bool GraphicsInterface::set_path3_vifmask(int value)
 {
     //printf("GIF PATH3Mask VIF set to %d\n", value);
@@ -447,12 +276,104 @@ bool GraphicsInterface::send_PATH(int index, uint128_t quad)
     return true;
 }
 
-//Returns true if an EOP transfer has ended - this terminates the XGKICK command
-bool GraphicsInterface::send_PATH1(uint128_t quad)
+static bool packed_has_AD(const GIFtag& tag)
 {
-    //printf("[GIF] Send PATH1 $%08X_%08X_%08X_%08X\n", quad._u32[3], quad._u32[2], quad._u32[1], quad._u32[0]);
-    feed_GIF(quad);
-    return !path[1].current_tag.data_left && path[1].current_tag.end_of_packet;
+    for (int i = 0; i < tag.reg_count; i++)
+    {
+        if (((tag.regs >> (i << 2)) & 0xF) == 0xE)
+            return true;
+    }
+    return false;
+}
+
+//Skips over registers of a PACKED or REGLIST GIFtag without unpacking them
+static void skip_regs(GIFtag& tag, uint32_t count)
+{
+    uint32_t regs_remaining = (tag.data_left - 1) * tag.reg_count + tag.regs_left;
+    regs_remaining -= std::min(count, regs_remaining);
+    if (!regs_remaining)
+    {
+        tag.data_left = 0;
+        tag.regs_left = tag.reg_count;
+        return;
+    }
+    tag.data_left = (regs_remaining + tag.reg_count - 1) / tag.reg_count;
+    tag.regs_left = regs_remaining - (tag.data_left - 1) * tag.reg_count;
+}
+
+/**
+PATH1 (XGKICK) packets are handed over straight from VU1 memory. The GIFtags are still walked here so that
+arbitration, SIGNAL stalls and EOP behave exactly as they do through feed_GIF, but the data itself is
+copied into the GS thread's queue in one go and unpacked over there.
+Returns the number of quadwords consumed. end_of_packet is set if this terminates the XGKICK command.
+**/
+int GraphicsInterface::send_PATH1(const uint128_t* data, int quad_count, bool& end_of_packet)
+{
+    GIFtag& tag = path[1].current_tag;
+    bool new_packet = !tag.data_left;
+    int sent = 0;
+
+    end_of_packet = false;
+    outputting_path = true;
+    while (sent < quad_count && !end_of_packet && !gs->stalled())
+    {
+        int quads_left = quad_count - sent;
+        if (!tag.data_left)
+        {
+            tag.read(data[sent]);
+            path_status[1] = tag.format;
+            sent++;
+
+            //NOP GIFTags ignore all fields except EOP
+            if (tag.data_left)
+                gs->set_CSR_FIFO(0x2); //FIFO Full
+        }
+        else if (tag.format == 0 && packed_has_AD(tag))
+        {
+            //A+D may write SIGNAL/FINISH/LABEL, which have to be seen on this side as soon as they happen
+            while (sent < quad_count && tag.data_left && !gs->stalled())
+            {
+                if (tag.current_reg() == 0xE)
+                {
+                    uint32_t addr = data[sent]._u64[1] & 0xFF;
+                    if (addr != 0x7F)
+                        gs->preprocess_write64(addr, data[sent]._u64[0]);
+                }
+                skip_regs(tag, 1);
+                sent++;
+            }
+        }
+        else if (tag.format == 0)
+        {
+            uint32_t regs_remaining = (tag.data_left - 1) * tag.reg_count + tag.regs_left;
+            uint32_t quads = std::min((uint32_t)quads_left, regs_remaining);
+            skip_regs(tag, quads);
+            sent += quads;
+        }
+        else if (tag.format == 1)
+        {
+            //Two registers per quadword, with the last 64 bits discarded if NREGS * NLOOP is odd
+            uint32_t regs_remaining = (tag.data_left - 1) * tag.reg_count + tag.regs_left;
+            uint32_t quads = std::min((uint32_t)quads_left, (regs_remaining + 1) / 2);
+            skip_regs(tag, quads * 2);
+            sent += quads;
+        }
+        else
+        {
+            uint32_t quads = std::min((uint32_t)quads_left, tag.data_left);
+            tag.data_left -= quads;
+            sent += quads;
+        }
+
+        end_of_packet = !tag.data_left && tag.end_of_packet;
+    }
+
+    if (sent)
+        gs->send_packet(data, sent, new_packet);
+
+    if (end_of_packet)
+        end_packet();
+    return sent;
 }
 
 void GraphicsInterface::send_PATH2(uint32_t data[])
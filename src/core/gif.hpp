@@ -9,20 +9,6 @@
 
 class DMAC;
 
-struct GIFtag
-{
-    uint16_t NLOOP;
-    bool end_of_packet;
-    bool output_PRIM;
-    uint16_t PRIM;
-    uint8_t format;
-    uint8_t reg_count;
-    uint64_t regs;
-
-    uint8_t regs_left;
-    uint32_t data_left;
-};
-
 struct GIFPath
 {
     GIFtag current_tag;
@@ -51,15 +37,15 @@ class GraphicsInterface
 
         float internal_Q;
 
-        void process_PACKED(uint128_t quad);
-        void process_REGLIST(uint128_t quad);
         void feed_GIF(uint128_t quad);
+        void end_packet();
 
         void flush_path3_fifo();
     public:
         GraphicsInterface(GraphicsSynthesizer* gs, DMAC* dmac);
         void reset();
         void run(int cycles);
+        bool is_idle();
 
         bool fifo_full();
         bool fifo_empty();
@@ -84,7 +70,7 @@ class GraphicsInterface
 
         bool send_PATH(int index, uint128_t quad);
 
-        bool send_PATH1(uint128_t quad);
+        int send_PATH1(const uint128_t* data, int quad_count, bool& end_of_packet);
         void send_PATH2(uint32_t data[4]);
         void send_PATH3(uint128_t quad);
         void send_PATH3_FIFO(uint128_t quad);
@@ -92,8 +78,8 @@ class GraphicsInterface
 
         void intermittent_check();
 
-        void load_state(std::ifstream& state);
-        void save_state(std::ofstream& state);
+        void load_state(std::istream& state);
+        void save_state(std::ostream& state);
 };
 
 inline int GraphicsInterface::get_active_path()
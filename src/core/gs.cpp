@@ -226,7 +226,12 @@ void GraphicsSynthesizer::write64(uint32_t addr, uint64_t value)
     payload.write64_payload = { addr, value };
     
     gs_thread.send_message({ GSCommand::write64_t, payload });
+    preprocess_write64(addr, value);
+}
 
+//Handles the EE side of a register write whose data reaches the GS thread some other way, such as a bulk GIF packet
+void GraphicsSynthesizer::preprocess_write64(uint32_t addr, uint64_t value)
+{
     //Check for interrupt pre-processing
     reg.write64(addr, value);
 
@@ -339,10 +344,10 @@ void GraphicsSynthesizer::set_XYZF(uint32_t x, uint32_t y, uint32_t z, uint8_t f
     gs_thread.send_message({ GSCommand::set_xyzf_t, payload });
 }
 
-void GraphicsSynthesizer::load_state(std::ifstream &state)
+void GraphicsSynthesizer::load_state(std::istream &state, bool has_packet_state)
 {
     GSMessagePayload payload;
-    payload.load_state_payload = {&state};
+    payload.load_state_payload = {&state, has_packet_state};
     gs_thread.send_message({ GSCommand::load_state_t, payload });
     gs_thread.wake_thread();
     GSReturnMessage data;
@@ -351,7 +356,29 @@ void GraphicsSynthesizer::load_state(std::ifstream &state)
     state.read((char*)&reg, sizeof(reg));
 }
 
-void GraphicsSynthesizer::save_state(std::ofstream &state)
+bool GraphicsSynthesizer::load_dump(std::istream &dump)
+{
+    std::streampos start = dump.tellg();
+    GSDumpHeader header;
+    dump.read((char*)&header, sizeof(header));
+    bool has_header = dump && header.magic == GSDumpHeader::MAGIC;
+    if (has_header && header.version > GSDumpHeader::VERSION)
+    {
+        printf("[GS] GS dump version %u is newer than this build supports\n", header.version);
+        return false;
+    }
+
+    //Old dumps start with the state right away
+    if (!has_header)
+    {
+        dump.clear();
+        dump.seekg(start);
+    }
+    load_state(dump, has_header);
+    return (bool)dump;
+}
+
+void GraphicsSynthesizer::save_state(std::ostream &state)
 {
     GSMessagePayload payload;
     payload.save_state_payload = {&state};
@@ -378,11 +405,21 @@ void GraphicsSynthesizer::send_message(GSMessage message)
     gs_thread.send_message(message);
 }
 
+void GraphicsSynthesizer::send_packet(const uint128_t* data, uint32_t quad_count, bool new_packet)
+{
+    gs_thread.send_packet(data, quad_count, new_packet);
+}
+
 void GraphicsSynthesizer::wake_gs_thread()
 {
     gs_thread.wake_thread();
 }
 
+void GraphicsSynthesizer::get_draw_stats(uint64_t &prims, uint64_t &pixels)
+{
+    gs_thread.get_draw_stats(prims, pixels);
+}
+
 void GraphicsSynthesizer::request_gs_download()
 {
     GSMessagePayload payload;
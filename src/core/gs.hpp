@@ -56,6 +56,7 @@ class GraphicsSynthesizer
         void write32_privileged(uint32_t addr, uint32_t value);
         void write64_privileged(uint32_t addr, uint64_t value);
         void write64(uint32_t addr, uint64_t value);
+        void preprocess_write64(uint32_t addr, uint64_t value);
 
         void set_RGBA(uint8_t r, uint8_t g, uint8_t b, uint8_t a, float q);
         void set_ST(uint32_t s, uint32_t t);
@@ -63,14 +64,20 @@ class GraphicsSynthesizer
         void set_XYZ(uint32_t x, uint32_t y, uint32_t z, bool drawing_kick);
         void set_XYZF(uint32_t x, uint32_t y, uint32_t z, uint8_t fog, bool drawing_kick);
 
-        void load_state(std::ifstream& state);
-        void save_state(std::ofstream& state);
+        void load_state(std::istream& state, bool has_packet_state = true);
+
+        //Loads the state at the start of a .gsd dump, leaving the stream at the first message
+        bool load_dump(std::istream& dump);
+        void save_state(std::ostream& state);
         void send_dump_request();
 
         void send_message(GSMessage message);
+        void send_packet(const uint128_t* data, uint32_t quad_count, bool new_packet);
         void wake_gs_thread();
 
         void request_gs_download();
         std::tuple<uint128_t, bool>read_gs_download();
+
+        void get_draw_stats(uint64_t& prims, uint64_t& pixels);
 };
 #endif // GS_HPP
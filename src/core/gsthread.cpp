@@ -206,6 +206,16 @@ void GraphicsSynthesizerThread::send_message(GSMessage message)
     send_data = true;
 }
 
+void GraphicsSynthesizerThread::send_packet(const uint128_t* data, uint32_t quad_count, bool new_packet)
+{
+    //The packet data is copied once into its own queue, then a single message tells the GS thread how much to consume
+    packet_queue->push(data, quad_count);
+
+    GSMessagePayload payload;
+    payload.gif_packet_payload = { quad_count, new_packet };
+    send_message({ GSCommand::gif_packet_t, payload });
+}
+
 void GraphicsSynthesizerThread::wake_thread()
 {
     printf("[GS] Waking GS Thread\n");
@@ -226,6 +236,12 @@ void GraphicsSynthesizerThread::exit()
     }
 }
 
+void GraphicsSynthesizerThread::get_draw_stats(uint64_t &prims, uint64_t &pixels)
+{
+    prims = prims_drawn;
+    pixels = pixels_drawn;
+}
+
 void GraphicsSynthesizerThread::event_loop()
 {
     printf("[GS_t] Starting GS Thread\n");
@@ -241,7 +257,8 @@ void GraphicsSynthesizerThread::event_loop()
 
             if (message_queue->pop(data))
             {
-                if (gsdump_recording)
+                //Packet data lives outside of the message queue, so it gets recorded quad by quad below
+                if (gsdump_recording && data.type != gif_packet_t)
                     gsdump_file.write((char*)&data, sizeof(data));
 
                 switch (data.type)
@@ -360,7 +377,8 @@ void GraphicsSynthesizerThread::event_loop()
                         return;
                     case load_state_t:
                     {
-                        load_state(data.payload.load_state_payload.state);
+                        load_state(data.payload.load_state_payload.state,
+                                   data.payload.load_state_payload.has_packet_state);
                         GSReturnMessagePayload return_payload;
                         return_payload.no_payload = { 0 };
                         return_queue->push({ GSReturn::load_state_done_t,return_payload });
@@ -389,6 +407,8 @@ void GraphicsSynthesizerThread::event_loop()
                             if (!gsdump_file.is_open())
                                 Errors::die("gs dump file failed to open");
                             gsdump_recording = true;
+                            GSDumpHeader header = { GSDumpHeader::MAGIC, GSDumpHeader::VERSION };
+                            gsdump_file.write((char*)&header, sizeof(header));
                             save_state(&gsdump_file);
                             gsdump_file.write((char*)&reg, sizeof(reg));
                         }
@@ -418,6 +438,49 @@ void GraphicsSynthesizerThread::event_loop()
                         notifier.notify_one();
                         break;
                     }
+                    case gif_packet_t:
+                    {
+                        auto p = data.payload.gif_packet_payload;
+                        if (p.new_packet)
+                        {
+                            packet_tag.data_left = 0;
+
+                            //The quads are recorded one by one below, this marks where the packet starts
+                            if (gsdump_recording)
+                            {
+                                GSMessage marker;
+                                marker.type = gif_packet_t;
+                                marker.payload.gif_packet_payload = { 0, true };
+                                gsdump_file.write((char*)&marker, sizeof(marker));
+                            }
+                        }
+
+                        for (uint32_t i = 0; i < p.quad_count; i++)
+                        {
+                            uint128_t quad;
+                            if (!packet_queue->pop(quad))
+                                Errors::die("[GS_t] GIF packet queue underflow");
+
+                            if (gsdump_recording)
+                            {
+                                GSMessage quad_message;
+                                quad_message.type = gif_packet_quad_t;
+                                quad_message.payload.gif_packet_quad_payload = { quad._u64[0], quad._u64[1] };
+                                gsdump_file.write((char*)&quad_message, sizeof(quad_message));
+                            }
+                            feed_packet(quad);
+                        }
+                        break;
+                    }
+                    case gif_packet_quad_t:
+                    {
+                        auto p = data.payload.gif_packet_quad_payload;
+                        uint128_t quad;
+                        quad._u64[0] = p.lo;
+                        quad._u64[1] = p.hi;
+                        feed_packet(quad);
+                        break;
+                    }
                     default:
                         Errors::die("corrupted command sent to GS thread");
                 }
@@ -451,6 +514,8 @@ void GraphicsSynthesizerThread::reset()
         local_mem = new uint8_t[1024 * 1024 * 4];
 
     pixels_transferred = 0;
+    prims_drawn = 0;
+    pixels_drawn = 0;
     num_vertices = 0;
     frame_count = 0;
 
@@ -460,6 +525,8 @@ void GraphicsSynthesizerThread::reset()
     reg.reset(false);
     context1.reset();
     context2.reset();
+    packet_tag.data_left = 0;
+    packet_Q = 1.0f;
     PSMCT24_color = 0;
     PSMCT24_unpacked_count = 0;
     current_ctx = &context1;
@@ -482,6 +549,7 @@ void GraphicsSynthesizerThread::reset()
 
     message_queue = std::make_unique<gs_fifo>();
     return_queue = std::make_unique<gs_return_fifo>();
+    packet_queue = std::make_unique<gs_packet_fifo>();
     thread = std::thread(&GraphicsSynthesizerThread::event_loop, this);
 }
 
@@ -1179,6 +1247,15 @@ void GraphicsSynthesizerThread::set_XYZF(uint32_t x, uint32_t y, uint32_t z, uin
     vertex_kick(drawing_kick);
 }
 
+/**
+GIF packets forwarded in bulk (currently PATH1 / XGKICK) are unpacked here instead of on the EE thread.
+The GIF still walks the GIFtags on its side for arbitration.
+**/
+void GraphicsSynthesizerThread::feed_packet(uint128_t data)
+{
+    unpack_GIF_quad(packet_tag, packet_Q, data, *this);
+}
+
 uint32_t GraphicsSynthesizerThread::blockid_PSMCT32(uint32_t block, uint32_t width, uint32_t x, uint32_t y)
 {
     return block + ((y & ~0x1F) * (width / 64)) + ((x >> 1) & ~0x1F) + blockTable32[(y >> 3) & 0x3][(x >> 3) & 0x7];
@@ -1472,6 +1549,8 @@ void GraphicsSynthesizerThread::render_primitive()
     if (current_ctx->scissor.empty())
         return;
 
+    prims_drawn++;
+
 #ifdef GS_JIT
     jit_draw_pixel_func = get_jitted_draw_pixel(draw_pixel_state);
     //No need to recompile tex_lookup if texture mapping is disabled. TEX0 can contain bad data
@@ -2013,6 +2092,7 @@ void GraphicsSynthesizerThread::render_point()
     tex_info.tex_width = current_ctx->tex0.tex_width;
     tex_info.tex_height = current_ctx->tex0.tex_height;
 
+    pixels_drawn++;
     if (current_PRMODE->texture_mapping)
     {
         int32_t u, v;
@@ -2091,6 +2171,9 @@ void GraphicsSynthesizerThread::render_line()
 
     printf("Coords: (%d, %d, %d) (%d, %d, %d)\n", v1.x >> 4, v1.y >> 4, v1.z, v2.x >> 4, v2.y >> 4, v2.z);
 
+    if (max_x > min_x)
+        pixels_drawn += (max_x - min_x) >> 4;
+
     for (int32_t x = min_x; x < max_x; x += 0x10)
     {
         int32_t y = interpolate(x, v1.y, v1.x, v2.y, v2.x);
@@ -2488,6 +2571,8 @@ void GraphicsSynthesizerThread::render_half_triangle(float x0, float x1, int y0,
         int xStart = x0l;
 
         if(xStop == xStart) continue;               // skip rows of zero length
+        if(xStop > xStart)
+            pixels_drawn += xStop - xStart;
 
         vtx += (x_step * (x0l - init.x));           // interpolate to point (x0l, y)
 
@@ -2722,6 +2807,8 @@ void GraphicsSynthesizerThread::render_triangle()
                             tex_info.vtx_color.q = q / divider;
                             tex_info.fog = fog / divider;
 
+                            //Coverage is only known here, so this rasterizer counts pixels one at a time
+                            pixels_drawn++;
                             if (tmp_tex)
                             {
                                 int32_t u, v;
@@ -2829,6 +2916,9 @@ void GraphicsSynthesizerThread::render_sprite()
     bool tmp_tex = current_PRMODE->texture_mapping;
     bool tmp_st = !current_PRMODE->use_UV;//allow for loop unswitching
 
+    if (max_x > min_x && max_y > min_y)
+        pixels_drawn += (uint64_t)((max_x - min_x) >> 4) * ((max_y - min_y) >> 4);
+
     for (int32_t y = min_y; y < max_y; y += 0x10)
     {
         float pix_s = pix_s_init;
@@ -5403,7 +5493,7 @@ void GraphicsSynthesizerThread::recompile_convert_16bit_tex(REG_64 color, REG_64
     emitter_tex.MOV32_REG(temp2, color);
 }
 
-void GraphicsSynthesizerThread::load_state(ifstream *state)
+void GraphicsSynthesizerThread::load_state(istream *state, bool has_packet_state)
 {
     state->read((char*)local_mem, 1024 * 1024 * 4);
     state->read((char*)&IMR, sizeof(IMR));
@@ -5458,9 +5548,16 @@ void GraphicsSynthesizerThread::load_state(ifstream *state)
     state->read((char*)&current_vtx, sizeof(current_vtx));
     state->read((char*)&vtx_queue, sizeof(vtx_queue));
     state->read((char*)&num_vertices, sizeof(num_vertices));
+
+    //States from before GIF packets were forwarded can't be in the middle of one
+    if (has_packet_state)
+    {
+        state->read((char*)&packet_tag, sizeof(packet_tag));
+        state->read((char*)&packet_Q, sizeof(packet_Q));
+    }
 }
 
-void GraphicsSynthesizerThread::save_state(ofstream *state)
+void GraphicsSynthesizerThread::save_state(ostream *state)
 {
     state->write((char*)local_mem, 1024 * 1024 * 4);
     state->write((char*)&IMR, sizeof(IMR));
@@ -5512,4 +5609,7 @@ void GraphicsSynthesizerThread::save_state(ofstream *state)
     state->write((char*)&current_vtx, sizeof(current_vtx));
     state->write((char*)&vtx_queue, sizeof(vtx_queue));
     state->write((char*)&num_vertices, sizeof(num_vertices));
+
+    state->write((char*)&packet_tag, sizeof(packet_tag));
+    state->write((char*)&packet_Q, sizeof(packet_Q));
 }
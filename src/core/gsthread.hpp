@@ -35,7 +35,7 @@ enum GSCommand:uint8_t
     write64_t, write64_privileged_t, write32_privileged_t,
     set_rgba_t, set_st_t, set_uv_t, set_xyz_t, set_xyzf_t, set_crt_t,
     render_crt_t, assert_finish_t, assert_hblank_t, assert_vsync_t, swap_field_t, memdump_t, die_t,
-    save_state_t, load_state_t, gsdump_t, request_local_host_tx,
+    save_state_t, load_state_t, gsdump_t, request_local_host_tx, gif_packet_t, gif_packet_quad_t,
 };
 
 union GSMessagePayload 
@@ -96,11 +96,21 @@ union GSMessagePayload
     } download_payload;
     struct
     {
-        std::ofstream* state;
+        uint32_t quad_count;
+        bool new_packet;
+    } gif_packet_payload;
+    struct
+    {
+        uint64_t lo, hi;
+    } gif_packet_quad_payload;
+    struct
+    {
+        std::ostream* state;
     } save_state_payload;
     struct
     {
-        std::ifstream* state;
+        std::istream* state;
+        bool has_packet_state;
     } load_state_payload;
     struct 
     {
@@ -114,6 +124,17 @@ struct GSMessage
     GSMessagePayload payload;
 };
 
+//.gsd dumps start with this, followed by the GS state and every message the GS thread received while recording.
+//Dumps from before version 1 have no header and no GIF packet state, nor markers where forwarded packets start.
+struct GSDumpHeader
+{
+    constexpr static uint32_t MAGIC = 0x50445347; //"GSDP"
+    constexpr static uint32_t VERSION = 1;
+
+    uint32_t magic;
+    uint32_t version;
+};
+
 //Commands sent from the GS thread to the main thread.
 enum GSReturn :uint8_t
 {
@@ -154,6 +175,178 @@ struct GSReturnMessage
 
 typedef CircularFifo<GSMessage, 1024 * 1024 * 16> gs_fifo;
 typedef CircularFifo<GSReturnMessage, 1024> gs_return_fifo;
+//Raw GIF packet data forwarded in bulk, referenced by gif_packet_t messages
+typedef CircularFifo<uint128_t, 1024 * 1024> gs_packet_fifo;
+
+struct GIFtag
+{
+    uint16_t NLOOP;
+    bool end_of_packet;
+    bool output_PRIM;
+    uint16_t PRIM;
+    uint8_t format;
+    uint8_t reg_count;
+    uint64_t regs;
+
+    uint8_t regs_left;
+    uint32_t data_left;
+
+    void read(uint128_t tag)
+    {
+        uint64_t data1 = tag._u64[0];
+        NLOOP = data1 & 0x7FFF;
+        end_of_packet = data1 & (1 << 15);
+        output_PRIM = (data1 >> 46) & 0x1;
+        PRIM = (data1 >> 47) & 0x7FF;
+        format = (data1 >> 58) & 0x3;
+        reg_count = data1 >> 60;
+        if (!reg_count)
+            reg_count = 16;
+        regs = tag._u64[1];
+        regs_left = reg_count;
+        data_left = NLOOP;
+    }
+
+    uint8_t current_reg()
+    {
+        return (regs >> ((reg_count - regs_left) << 2)) & 0xF;
+    }
+};
+
+/**
+Unpacks one quadword of a GIF packet: a GIFtag when the last one is done, its data otherwise.
+Both GraphicsInterface (through GraphicsSynthesizer) and the GS thread unpack packets with this, so that they can't
+drift apart. gs needs write64, set_RGBA, set_ST, set_UV, set_XYZ and set_XYZF. Q is the internal Q register,
+set by ST and used by RGBAQ.
+**/
+template <typename GS>
+void unpack_GIF_quad(GIFtag& tag, float& Q, uint128_t data, GS& gs)
+{
+    uint64_t data1 = data._u64[0];
+    uint64_t data2 = data._u64[1];
+    if (!tag.data_left)
+    {
+        tag.read(data);
+
+        //Q is initialized to 1.0 upon reading a GIFtag
+        Q = 1.0f;
+
+        //NOP GIFTags ignore all fields except EOP
+        if (tag.data_left && tag.output_PRIM && tag.format == 0)
+            gs.write64(0, tag.PRIM);
+        return;
+    }
+
+    switch (tag.format)
+    {
+        case 0:
+        {
+            uint8_t reg = tag.current_reg();
+            switch (reg)
+            {
+                case 0x0:
+                    //PRIM
+                    gs.write64(0, data1);
+                    break;
+                case 0x1:
+                    //RGBAQ - Q is taken from the ST command
+                    gs.set_RGBA(data1 & 0xFF, (data1 >> 32) & 0xFF, data2 & 0xFF, (data2 >> 32) & 0xFF, Q);
+                    break;
+                case 0x2:
+                {
+                    //ST - set ST coordinates and Q
+                    uint32_t s = data1 & 0xFFFFFF00;
+                    uint32_t t = (data1 >> 32) & 0xFFFFFF00;
+                    uint32_t q = data2 & 0xFFFFFF00;
+
+                    if ((s & 0x7F800000) == 0x7F800000)
+                        s = (s & 0x80000000) | 0x7F7FFFFF;
+
+                    if ((t & 0x7F800000) == 0x7F800000)
+                        t = (t & 0x80000000) | 0x7F7FFFFF;
+
+                    if ((q & 0x7F800000) == 0x7F800000)
+                        q = (q & 0x80000000) | 0x7F7FFFFF;
+                    Q = *(float*)&q;
+                    gs.set_ST(s, t);
+                }
+                    break;
+                case 0x3:
+                    //UV
+                    gs.set_UV(data1 & 0x3FFF, (data1 >> 32) & 0x3FFF);
+                    break;
+                case 0x4:
+                {
+                    //XYZF2 - drawing kick can be disabled through bit 111
+                    bool disable_drawing = (data2 >> (111 - 64)) & 0x1;
+                    uint8_t fog = (data2 >> (100 - 64)) & 0xFF;
+                    gs.set_XYZF(data1 & 0xFFFF, (data1 >> 32) & 0xFFFF, (data2 >> 4) & 0xFFFFFF, fog, !disable_drawing);
+                }
+                    break;
+                case 0x5:
+                {
+                    //XYZ2 - drawing kick can be disabled through bit 111
+                    bool disable_drawing = (data2 >> (111 - 64)) & 0x1;
+                    gs.set_XYZ(data1 & 0xFFFF, (data1 >> 32) & 0xFFFF, data2 & 0xFFFFFFFF, !disable_drawing);
+                }
+                    break;
+                case 0xA:
+                    //FOG
+                    gs.write64(0xA, data2 << 20);
+                    break;
+                case 0xE:
+                {
+                    //A+D
+                    uint32_t addr = data2 & 0xFF;
+                    if (addr != 0x7F)
+                        gs.write64(addr, data1);
+                }
+                    break;
+                case 0xF:
+                    //NOP
+                    break;
+                default:
+                    gs.write64(reg, data1);
+                    break;
+            }
+
+            tag.regs_left--;
+            if (!tag.regs_left)
+            {
+                tag.regs_left = tag.reg_count;
+                tag.data_left--;
+            }
+        }
+            break;
+        case 1:
+            for (int i = 0; i < 2; i++)
+            {
+                uint8_t reg = tag.current_reg();
+
+                //A+D is a NOP in REGLIST mode
+                if (reg != 0xE)
+                    gs.write64(reg, data._u64[i]);
+
+                tag.regs_left--;
+                if (!tag.regs_left)
+                {
+                    tag.regs_left = tag.reg_count;
+                    tag.data_left--;
+
+                    //If NREGS * NLOOP is odd, discard the last 64 bits of data
+                    if (!tag.data_left)
+                        break;
+                }
+            }
+            break;
+        default:
+            //IMAGE
+            gs.write64(0x54, data1);
+            gs.write64(0x54, data2);
+            tag.data_left--;
+            break;
+    }
+}
 
 struct PRMODE_REG
 {
@@ -363,6 +556,7 @@ class GraphicsSynthesizerThread
 
         std::unique_ptr<gs_fifo> message_queue{ nullptr };
         std::unique_ptr<gs_return_fifo> return_queue{ nullptr };
+        std::unique_ptr<gs_packet_fifo> packet_queue{ nullptr };
 
         bool frame_complete;
         int frame_count;
@@ -420,12 +614,20 @@ class GraphicsSynthesizerThread
         uint8_t BUSDIR;
         int pixels_transferred;
 
+        //Totals since the last reset, for benchmarking
+        uint64_t prims_drawn;
+        uint64_t pixels_drawn;
+
         //Used for unpacking PSMCT24
         uint32_t PSMCT24_color;
         int PSMCT24_unpacked_count;
 
         GS_REGISTERS reg;
 
+        //GIF packets sent in bulk are unpacked on this thread
+        GIFtag packet_tag;
+        float packet_Q;
+
         Vertex current_vtx;
         Vertex vtx_queue[3];
         unsigned int num_vertices;
@@ -531,17 +733,26 @@ class GraphicsSynthesizerThread
         void set_XYZ(uint32_t x, uint32_t y, uint32_t z, bool drawing_kick);
         void set_XYZF(uint32_t x, uint32_t y, uint32_t z, uint8_t fog, bool drawing_kick);
 
-        void load_state(std::ifstream* state);
-        void save_state(std::ofstream* state);
+        void feed_packet(uint128_t data);
+
+        template <typename GS>
+        friend void unpack_GIF_quad(GIFtag& tag, float& Q, uint128_t data, GS& gs);
+
+        void load_state(std::istream* state, bool has_packet_state);
+        void save_state(std::ostream* state);
     public:
         GraphicsSynthesizerThread();
         ~GraphicsSynthesizerThread();
         
         // safe to access from emu thread
         void send_message(GSMessage message);
+        void send_packet(const uint128_t* data, uint32_t quad_count, bool new_packet);
         void wake_thread();
         void wait_for_return(GSReturn type, GSReturnMessage &data);
         void reset();
         void exit();
+
+        //Only consistent while the GS thread is idle, e.g. right after waiting on a return message
+        void get_draw_stats(uint64_t& prims, uint64_t& pixels);
 };
 #endif // GSTHREAD_HPP
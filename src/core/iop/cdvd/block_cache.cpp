@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <cstring>
+#include "block_cache.hpp"
+
+Block_Cache::Block_Cache(size_t max_blocks, uint64_t prefetch_blocks) :
+    max_blocks(std::max(max_blocks, (size_t)1)), prefetch_blocks(prefetch_blocks),
+    block_size(0), buffer_size(0), block_count(0), last_block(~0ULL), stopping(false), hits(0), misses(0)
+{
+
+}
+
+Block_Cache::~Block_Cache()
+{
+    stop();
+}
+
+void Block_Cache::start(size_t block_size, uint64_t block_count, unsigned worker_count, Loader loader,
+                        size_t buffer_size)
+{
+    stop();
+
+    this->loader = loader;
+    this->block_size = block_size;
+    this->buffer_size = std::max(block_size, buffer_size);
+    this->block_count = block_count;
+    last_block = ~0ULL;
+    hits = 0;
+    misses = 0;
+
+    for (unsigned i = 0; i < worker_count; i++)
+        workers.emplace_back(&Block_Cache::worker_thread, this, i);
+}
+
+void Block_Cache::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        stopping = true;
+    }
+    work_cv.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+    workers.clear();
+    stopping = false;
+
+    queue.clear();
+    cache.clear();
+    cache_map.clear();
+}
+
+void Block_Cache::access(uint64_t first, uint64_t last)
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+
+    bool sequential = first == last_block || first == last_block + 1;
+    if (!sequential)
+        cancel_queue();
+    last_block = last;
+
+    for (uint64_t i = first + 1; i <= last; i++)
+        queue_block(i);
+    if (sequential)
+    {
+        for (uint64_t i = last + 1; i <= last + prefetch_blocks; i++)
+            queue_block(i);
+    }
+}
+
+size_t Block_Cache::copy(uint64_t block, size_t offset, uint8_t* dst, size_t bytes)
+{
+    std::unique_lock<std::mutex> lock(cache_mutex);
+    CachedBlock* entry = get_block(lock, block);
+    if (!entry || offset >= entry->size)
+        return 0;
+
+    bytes = std::min(bytes, entry->size - offset);
+    memcpy(dst, entry->data.data() + offset, bytes);
+    return bytes;
+}
+
+size_t Block_Cache::read(uint64_t offset, uint8_t* dst, size_t bytes)
+{
+    if (!bytes)
+        return 0;
+
+    access(offset / block_size, (offset + bytes - 1) / block_size);
+
+    size_t total = 0;
+    while (total < bytes)
+    {
+        uint64_t pos = offset + total;
+        size_t count = copy(pos / block_size, pos % block_size, dst + total, bytes - total);
+
+        //The loader came up short
+        if (!count)
+            break;
+        total += count;
+    }
+    return total;
+}
+
+unsigned Block_Cache::get_worker_count()
+{
+    return (unsigned)workers.size();
+}
+
+uint64_t Block_Cache::get_hits()
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return hits;
+}
+
+uint64_t Block_Cache::get_misses()
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return misses;
+}
+
+//Returns the loaded block, loading it on this thread unless a worker is already on it.
+//The cache lock may be released in between, but is held again on return
+Block_Cache::CachedBlock* Block_Cache::get_block(std::unique_lock<std::mutex>& lock, uint64_t block)
+{
+    if (block >= block_count)
+        return nullptr;
+
+    bool hit = true;
+    while (true)
+    {
+        auto it = cache_map.find(block);
+        if (it == cache_map.end())
+        {
+            cache.push_front({block, BlockState::QUEUED, 0, std::vector<uint8_t>(buffer_size)});
+            it = cache_map.emplace(block, cache.begin()).first;
+        }
+
+        auto entry = it->second;
+        if (entry->state == BlockState::READY)
+        {
+            if (hit)
+                hits++;
+            else
+                misses++;
+            cache.splice(cache.begin(), cache, entry);
+            return &*entry;
+        }
+
+        hit = false;
+        if (entry->state == BlockState::LOADING)
+        {
+            done_cv.wait(lock);
+            continue;
+        }
+
+        //Still queued, so no worker has picked it up yet
+        entry->state = BlockState::LOADING;
+        lock.unlock();
+        size_t size = loader((unsigned)workers.size(), block, entry->data.data());
+        lock.lock();
+        done_cv.notify_all();
+
+        misses++;
+        if (!size)
+        {
+            cache_map.erase(block);
+            cache.erase(entry);
+            return nullptr;
+        }
+
+        entry->size = size;
+        entry->state = BlockState::READY;
+        cache.splice(cache.begin(), cache, entry);
+        trim_cache();
+        return &*entry;
+    }
+}
+
+//Must be called with cache_mutex held
+void Block_Cache::queue_block(uint64_t block)
+{
+    if (workers.empty() || block >= block_count || cache_map.count(block))
+        return;
+
+    cache.push_front({block, BlockState::QUEUED, 0, std::vector<uint8_t>(buffer_size)});
+    cache_map.emplace(block, cache.begin());
+    queue.push_back(block);
+    work_cv.notify_one();
+}
+
+//Must be called with cache_mutex held
+void Block_Cache::cancel_queue()
+{
+    for (uint64_t block : queue)
+    {
+        auto it = cache_map.find(block);
+        if (it != cache_map.end() && it->second->state == BlockState::QUEUED)
+        {
+            cache.erase(it->second);
+            cache_map.erase(it);
+        }
+    }
+    queue.clear();
+}
+
+//Evicts the least recently used blocks. The front block, which was just handed out, always stays
+void Block_Cache::trim_cache()
+{
+    auto it = cache.end();
+    while (cache.size() > max_blocks)
+    {
+        --it;
+        if (it == cache.begin())
+            break;
+        if (it->state != BlockState::READY)
+            continue;
+
+        cache_map.erase(it->index);
+        it = cache.erase(it);
+    }
+}
+
+void Block_Cache::worker_thread(unsigned worker)
+{
+    std::unique_lock<std::mutex> lock(cache_mutex);
+    while (true)
+    {
+        work_cv.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (stopping)
+            break;
+
+        uint64_t block = queue.front();
+        queue.pop_front();
+
+        auto it = cache_map.find(block);
+        if (it == cache_map.end() || it->second->state != BlockState::QUEUED)
+            continue;
+
+        auto entry = it->second;
+        entry->state = BlockState::LOADING;
+        lock.unlock();
+        size_t size = loader(worker, block, entry->data.data());
+        lock.lock();
+        done_cv.notify_all();
+
+        if (size)
+        {
+            entry->size = size;
+            entry->state = BlockState::READY;
+            trim_cache();
+        }
+        else
+        {
+            cache_map.erase(block);
+            cache.erase(entry);
+        }
+    }
+}
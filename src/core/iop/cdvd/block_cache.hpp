@@ -0,0 +1,89 @@
+#ifndef BLOCK_CACHE_HPP
+#define BLOCK_CACHE_HPP
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//An LRU cache of equally sized blocks of a disc image, shared by the containers that have to read or decode
+//their data in bigger pieces than a sector. Blocks come from a loader the container supplies.
+//Once reads turn out to be sequential, a pool of worker threads loads the blocks ahead of them,
+//so the emulation thread doesn't have to wait on disk I/O or decompression.
+class Block_Cache
+{
+    public:
+        //Fills out, which holds buffer_size bytes, with a block, and returns how many bytes of it are valid.
+        //Returning 0 means the block couldn't be loaded.
+        //worker tells the calling thread apart, it is below get_worker_count() for the pool and equal to it for reads.
+        typedef std::function<size_t(unsigned worker, uint64_t block, uint8_t* out)> Loader;
+    private:
+        enum class BlockState
+        {
+            QUEUED,
+            LOADING,
+            READY
+        };
+
+        struct CachedBlock
+        {
+            uint64_t index;
+            BlockState state;
+            size_t size;
+            std::vector<uint8_t> data;
+        };
+
+        size_t max_blocks;
+        uint64_t prefetch_blocks;
+
+        Loader loader;
+        size_t block_size;
+        size_t buffer_size;
+        uint64_t block_count;
+
+        //Guards everything below. Blocks that are queued or being loaded are never evicted.
+        std::mutex cache_mutex;
+        std::condition_variable work_cv, done_cv;
+        std::list<CachedBlock> cache;
+        std::unordered_map<uint64_t, std::list<CachedBlock>::iterator> cache_map;
+        std::deque<uint64_t> queue;
+        uint64_t last_block;
+        bool stopping;
+        uint64_t hits, misses;
+
+        std::vector<std::thread> workers;
+
+        CachedBlock* get_block(std::unique_lock<std::mutex>& lock, uint64_t block);
+        void queue_block(uint64_t block);
+        void cancel_queue();
+        void trim_cache();
+        void worker_thread(unsigned worker);
+    public:
+        Block_Cache(size_t max_blocks, uint64_t prefetch_blocks);
+        ~Block_Cache();
+
+        //Blocks are block_size bytes apart, but loaders that need room to work in can ask for bigger buffers
+        void start(size_t block_size, uint64_t block_count, unsigned worker_count, Loader loader,
+                   size_t buffer_size = 0);
+        void stop();
+
+        //Tells the cache that blocks first to last are about to be read.
+        //Reading on from the last access keeps the workers ahead of the reads, anything else cancels what's queued.
+        void access(uint64_t first, uint64_t last);
+
+        //Copies up to bytes from offset into a block, loading it on this thread unless a worker already is
+        size_t copy(uint64_t block, size_t offset, uint8_t* dst, size_t bytes);
+
+        //Treats the blocks as one stream of data
+        size_t read(uint64_t offset, uint8_t* dst, size_t bytes);
+
+        unsigned get_worker_count();
+        uint64_t get_hits();
+        uint64_t get_misses();
+};
+
+#endif // BLOCK_CACHE_HPP
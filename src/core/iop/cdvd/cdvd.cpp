@@ -6,6 +6,8 @@
 #include "cso_reader.hpp"
 #include "iso_reader.hpp"
 #include "chd_reader.hpp"
+#include "mmap_reader.hpp"
+#include "readahead_reader.hpp"
 
 #include "../iop_dma.hpp"
 #include "../iop_intc.hpp"
@@ -259,10 +261,20 @@ void CDVD_Drive::handle_N_command()
 bool CDVD_Drive::load_disc(const char *name, CDVD_CONTAINER a_container)
 {
     //container = a_container;
+    //ISO and BIN images are memory-mapped where the platform allows it.
+    //Should mapping fail, they're streamed through a sector cache with read-ahead instead.
+    //CSO and CHD cache and prefetch by themselves, so they aren't wrapped.
+    std::unique_ptr<CDVD_Container> fallback;
+    filesystem.close();
     switch (a_container)
     {
         case CDVD_CONTAINER::ISO:
-            container = std::unique_ptr<CDVD_Container>(new ISO_Reader());
+#ifndef _WIN32
+            container = std::unique_ptr<CDVD_Container>(new MMap_Reader());
+            fallback = std::unique_ptr<CDVD_Container>(new ReadAhead_Reader(new ISO_Reader()));
+#else
+            container = std::unique_ptr<CDVD_Container>(new ReadAhead_Reader(new ISO_Reader()));
+#endif
             break;
         case CDVD_CONTAINER::CISO:
             container = std::unique_ptr<CDVD_Container>(new CSO_Reader());
@@ -271,13 +283,20 @@ bool CDVD_Drive::load_disc(const char *name, CDVD_CONTAINER a_container)
             container = std::unique_ptr<CDVD_Container>(new CHD_Reader());
             break;
         case CDVD_CONTAINER::BIN_CUE:
+#ifndef _WIN32
+            container = std::unique_ptr<CDVD_Container>(new MMap_Reader(0x930, 0x18));
+            fallback = std::unique_ptr<CDVD_Container>(new BinCueReader());
+#else
             container = std::unique_ptr<CDVD_Container>(new BinCueReader());
+#endif
             break;
         default:
             container = nullptr;
             return false;
     }
-    if (!container->open(name)) // No Filename, No disc.
+    if (!container->open(name) && fallback)
+        container = std::move(fallback);
+    if (!container->is_open() && !container->open(name)) // No Filename, No disc.
     {
         printf("No Disk Inserted \n");
         disc_type = CDVD_DISC_NONE;
@@ -311,6 +330,7 @@ bool CDVD_Drive::load_disc(const char *name, CDVD_CONTAINER a_container)
     printf("[CDVD] Root dir len: %d\n", *(uint16_t*)&pvd_sector[156]);
     printf("[CDVD] Extent loc: $%08lX\n", root_location * LBA);
     printf("[CDVD] Extent len: $%08lX\n", root_len);
+    filesystem.open(container.get(), root_location, root_len);
 
     // Detecting disc type by abitrary variables
     // 650MB (681574400 bytes) is the maximum disc size for CD's
@@ -375,50 +395,31 @@ bool CDVD_Drive::load_disc(const char *name, CDVD_CONTAINER a_container)
     return true;
 }
 
+bool CDVD_Drive::find_file(const string& path, ISO_FileEntry& entry)
+{
+    return filesystem.find(path, entry);
+}
+
 uint8_t* CDVD_Drive::read_file(string name, uint32_t& file_size)
 {
-    uint8_t* root_extent = new uint8_t[root_len];
-    container->seek(root_location, std::ios::beg);
-    container->read(root_extent, root_len);
-    uint32_t bytes = 0;
-    uint64_t file_location = 0;
-    uint8_t* file;
+    ISO_FileEntry entry;
     file_size = 0;
     printf("[CDVD] Finding %s...\n", name.c_str());
-    while (bytes < root_len)
+    if (!filesystem.find(name, entry) || entry.is_dir)
+        return nullptr;
+
+    printf("[CDVD] Match found!\n");
+    printf("[CDVD] Location: $%08X\n", entry.lba);
+    printf("[CDVD] Size: $%08X\n", entry.size);
+
+    uint8_t* file = new uint8_t[entry.size];
+    if (!filesystem.read(entry, file))
     {
-        uint64_t directory_len = root_extent[bytes + 32];
-        if (name.length() == directory_len)
-        {
-            bool match = true;
-            for (unsigned int i = 0; i < directory_len; i++)
-            {
-                if (name[i] != root_extent[bytes + 33 + i])
-                {
-                    match = false;
-                    break;
-                }
-            }
-            if (match)
-            {
-                printf("[CDVD] Match found!\n");
-                file_location = *(uint32_t*)&root_extent[bytes + 2];
-                file_size = *(uint32_t*)&root_extent[bytes + 10];
-                printf("[CDVD] Location: $%08lX\n", file_location);
-                printf("[CDVD] Size: $%08X\n", file_size);
-
-                file = new uint8_t[file_size];
-                container->seek(file_location, std::ios::beg);
-                container->read(file, file_size);
-                delete[] root_extent;
-                return file;
-            }
-        }
-        //Increment bytes by size of directory record
-        bytes += root_extent[bytes];
+        delete[] file;
+        return nullptr;
     }
-    delete[] root_extent;
-    return nullptr;
+    file_size = entry.size;
+    return file;
 }
 
 uint8_t CDVD_Drive::read_N_command()
@@ -863,6 +864,7 @@ void CDVD_Drive::start_seek()
         Errors::print_warning("[CDVD] Invalid sector read $%08X (max size: $%08X)", seek_to, block_count);
 
     container->seek(seek_to, std::ios::beg);
+    container->prefetch(seek_to, sectors_left);
 
     add_event(cycles_to_seek);
 }
@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <string.h>
 #include "cdvd_container.hpp"
+#include "iso_filesystem.hpp"
 
 class IOP_INTC;
 class IOP_DMA;
@@ -86,6 +87,7 @@ class CDVD_Drive
         uint16_t LBA;
         uint64_t root_location;
         uint64_t root_len;
+        ISO_Filesystem filesystem;
 
         uint64_t current_sector;
         uint64_t sector_pos;
@@ -149,6 +151,7 @@ class CDVD_Drive
         int bytes_left();
 
         uint32_t read_to_RAM(uint8_t* RAM, uint32_t bytes);
+        bool find_file(const std::string& path, ISO_FileEntry& entry);
         uint8_t* read_file(std::string name, uint32_t& file_size);
         bool load_disc(const char* name, CDVD_CONTAINER container);
 
@@ -170,8 +173,8 @@ class CDVD_Drive
         void write_ISTAT(uint8_t value);
         void write_mecha_decode(uint8_t value);
 
-        void load_state(std::ifstream& state);
-        void save_state(std::ofstream& state);
+        void load_state(std::istream& state);
+        void save_state(std::ostream& state);
 };
 
 #endif // CDVD_HPP
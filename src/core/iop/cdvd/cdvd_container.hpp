@@ -5,11 +5,16 @@
 class CDVD_Container
 {
     public:
+        virtual ~CDVD_Container() {}
+
         virtual bool open(std::string name) = 0;
         virtual void close() = 0;
         virtual size_t read(uint8_t* buff, size_t bytes) = 0;
         virtual void seek(size_t pos, std::ios::seekdir whence) = 0;
 
+        //Tells the container that count sectors starting at pos are about to be read
+        virtual void prefetch(size_t pos, size_t count) {}
+
         virtual bool is_open() = 0;
         virtual size_t get_size() = 0;
 };
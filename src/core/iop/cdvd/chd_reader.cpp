@@ -1,9 +1,17 @@
 #include "chd_reader.hpp"
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 
+CHD_Reader::~CHD_Reader()
+{
+    close();
+}
+
 bool CHD_Reader::open(std::string name)
 {
+    close();
+
     chd_error err = chd_open(name.c_str(), CHD_OPEN_READ, nullptr, &m_file);
     if (err != CHDERR_NONE)
     {
@@ -13,18 +21,20 @@ bool CHD_Reader::open(std::string name)
 
     m_header = chd_get_header(m_file);
     m_size = m_header->logicalbytes;
-    m_buf = std::make_unique<uint8_t[]>(m_header->hunkbytes);
+    m_virtptr = 0;
 
     find_offset();
 
+    m_cache.start(m_header->hunkbytes, m_header->totalhunks, 1,
+                  [this] (unsigned, uint64_t index, uint8_t* out) { return load_hunk(index, out); });
+
     // read first hunk in advance
-    err = chd_read(m_file, 0, m_buf.get());
-    if (err != CHDERR_NONE)
+    uint8_t first;
+    if (!m_cache.copy(0, 0, &first, 1))
     {
-        fprintf(stderr, "chd: chd_read: %s\n", chd_error_string(err));
+        close();
         return false;
     }
-
     return true;
 }
 
@@ -68,7 +78,12 @@ void CHD_Reader::find_offset()
 
 void CHD_Reader::close()
 {
+    if (!m_file)
+        return;
+
+    m_cache.stop();
     chd_close(m_file);
+    m_file = nullptr;
 }
 
 size_t CHD_Reader::read(uint8_t* buff, size_t bytes)
@@ -82,20 +97,9 @@ size_t CHD_Reader::read(uint8_t* buff, size_t bytes)
     uint64_t end_hunk = end / m_header->hunkbytes;
     uint64_t total_read = 0;
 
+    m_cache.access(start_hunk, end_hunk);
     for (uint32_t i = (uint32_t)start_hunk; i <= end_hunk; i++)
     {
-        if (i != m_current_hunk)
-        {
-            chd_error err = chd_read(m_file, i, m_buf.get());
-            if (err != CHDERR_NONE)
-            {
-                fprintf(stderr, "chd: read: %s\n", chd_error_string(err));
-                return total_read;
-            }
-
-            m_current_hunk = i;
-        }
-
         const uint64_t local_ofs = start - (uint64_t)start_hunk * m_header->hunkbytes;
         uint64_t readlen = m_header->hunkbytes;
 
@@ -106,7 +110,8 @@ size_t CHD_Reader::read(uint8_t* buff, size_t bytes)
 
         assert(readlen <= bytes);
 
-        memcpy(buff, m_buf.get() + local_ofs + m_sector_offset, readlen);
+        if (m_cache.copy(i, local_ofs + m_sector_offset, buff, readlen) != readlen)
+            return total_read;
         total_read += readlen;
 
         //m_virtptr += readlen;
@@ -152,3 +157,25 @@ size_t CHD_Reader::get_size()
 {
     return m_size;
 }
+
+uint64_t CHD_Reader::get_cache_hits()
+{
+    return m_cache.get_hits();
+}
+
+uint64_t CHD_Reader::get_cache_misses()
+{
+    return m_cache.get_misses();
+}
+
+size_t CHD_Reader::load_hunk(uint64_t index, uint8_t* out)
+{
+    std::lock_guard<std::mutex> lock(m_file_mutex);
+    chd_error err = chd_read(m_file, (uint32_t)index, out);
+    if (err != CHDERR_NONE)
+    {
+        fprintf(stderr, "chd: read: %s\n", chd_error_string(err));
+        return 0;
+    }
+    return m_header->hunkbytes;
+}
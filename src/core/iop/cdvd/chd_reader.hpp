@@ -1,13 +1,16 @@
 #ifndef __CHD_H_
 #define __CHD_H_
 
-#include <memory>
+#include <mutex>
 #include <libchdr/chd.h>
+#include "block_cache.hpp"
 #include "cdvd_container.hpp"
 
 class CHD_Reader : public CDVD_Container
 {
     public:
+        ~CHD_Reader();
+
         bool open(std::string name);
         void close();
         size_t read(uint8_t* buff, size_t bytes);
@@ -16,17 +19,28 @@ class CHD_Reader : public CDVD_Container
         bool is_open();
         size_t get_size();
 
+        uint64_t get_cache_hits();
+        uint64_t get_cache_misses();
+
     private:
+        constexpr static size_t CACHE_HUNKS = 64;
+        constexpr static uint32_t PREFETCH_HUNKS = 8;
+
         chd_file *m_file {nullptr};
         const chd_header *m_header {nullptr};
 
         uint32_t m_sector_offset {0};
         uint64_t m_virtptr {0};
         size_t m_size {0};
-        uint32_t m_current_hunk {0};
-        std::unique_ptr<uint8_t[]> m_buf;
+
+        //libchdr isn't thread-safe, so the prefetch thread and reads take turns on the file
+        std::mutex m_file_mutex;
+
+        //Decompressed hunks
+        Block_Cache m_cache {CACHE_HUNKS, PREFETCH_HUNKS};
 
         void find_offset();
+        size_t load_hunk(uint64_t index, uint8_t* out);
 };
 
 
@@ -8,8 +8,10 @@ Based off reference by unknownbrackets:
 
 #include "cso_reader.hpp"
 #include <zlib.h>
+#include <algorithm>
 #include <cstring>
 #include <cassert>
+#include <thread>
 
 constexpr uint32_t FOURCC(const char chars[4])
 {
@@ -43,11 +45,14 @@ struct CSO_Header
 #define IDX_COMPRESS_BIT (0x80000000)
 
 
-CSO_Reader::CSO_Reader() :
+CSO_Reader::CSO_Reader(size_t cache_blocks) :
     m_size(0), m_shift(0), m_blocksize(0), m_version(0), m_virtptr(0),
     m_indices(nullptr),
-    m_framesize(0), m_curframe(0xFFFFFFFF),
-    m_frame(nullptr), m_readbuf(nullptr) {}
+    m_framesize(0),
+    m_cache(cache_blocks, PREFETCH_BLOCKS)
+{
+
+}
 
 CSO_Reader::~CSO_Reader()
 {
@@ -108,106 +113,85 @@ uint64_t CSO_Reader::tell()
     return m_virtptr;
 }
 
-bool CSO_Reader::read_block_internal(uint32_t block)
+bool CSO_Reader::init_decoder(Decoder& decoder)
+{
+    decoder.z.zalloc = Z_NULL;
+    decoder.z.zfree = Z_NULL;
+    decoder.z.opaque = Z_NULL;
+    decoder.z.next_in = Z_NULL;
+    decoder.z.avail_in = 0;
+    if (inflateInit2(&decoder.z, -15) != Z_OK)
+    {
+        fprintf(stderr, "Unable to initialize inflate: %s\n", (decoder.z.msg) ? decoder.z.msg : "?");
+        return false;
+    }
+    return true;
+}
+
+// decodes a block into out, which holds m_framesize bytes. may run on any thread
+bool CSO_Reader::decode_block(Decoder& decoder, uint32_t block, uint8_t* out)
 {
-    // if this block was decoded last time we don't need to do it again
-    if (block == m_curframe)
-        return true;
-    
     uint32_t index = m_indices[block];
     uint64_t ofs = (uint64_t)(index & ~IDX_COMPRESS_BIT) << m_shift;
     uint64_t len = ((uint64_t)(m_indices[block + 1] & ~IDX_COMPRESS_BIT) << m_shift) - ofs;
-    
-    if (index & IDX_COMPRESS_BIT) // if uncompressed
+    bool compressed = !(index & IDX_COMPRESS_BIT);
+
+    if (compressed && decoder.readbuf.size() < len)
+        decoder.readbuf.resize(m_framesize);
+
     {
+        std::lock_guard<std::mutex> lock(m_file_mutex);
+        m_file.clear();
         m_file.seekg(ofs, std::ios::beg);
-        m_file.read((char*)m_frame, len);
+        m_file.read((char*)(compressed ? decoder.readbuf.data() : out), len);
         if ((uint64_t)m_file.gcount() != len)
         {
-            fprintf(stderr, "read error reading (uncompressed) block %d\n", block);
-            m_curframe = 0xFFFFFFFF;
+            fprintf(stderr, "read error reading (%s) block %d\n", compressed ? "compressed" : "uncompressed", block);
             return false;
         }
     }
-    else // compressed
-    {
-        m_file.seekg(ofs, std::ios::beg);
-        m_file.read((char*)m_readbuf, len);
-        if ((uint64_t)m_file.gcount() != len)
-        {
-            fprintf(stderr, "read error reading (compressed) block %d\n", block);
-            return false;
-        }
 
-        z_stream z;
-        z.zalloc = Z_NULL;
-        z.zfree = Z_NULL;
-        z.opaque = Z_NULL;
-        if (inflateInit2(&z, -15) != Z_OK)
-        {
-            fprintf(stderr, "Unable to initialize inflate: %s\n", (z.msg) ? z.msg : "?");
-            return false;
-        }
-
-        z.next_in = m_readbuf;
-        z.avail_in = len;
-        z.next_out = m_frame;
-        z.avail_out = m_framesize;
-
-        auto res = inflate(&z, Z_FINISH);
-        if (res != Z_STREAM_END)
-        {
-            fprintf(stderr, "zlib error on block %d: %d, %s\n", block, res, (z.msg) ? z.msg: "?");
-            m_curframe = 0xFFFFFFFF;
-            return false;
-
-        }
+    if (!compressed)
+        return true;
 
-        size_t read = z.total_out;
+    // the inflate context is reused from block to block
+    z_stream& z = decoder.z;
+    inflateReset(&z);
+    z.next_in = decoder.readbuf.data();
+    z.avail_in = len;
+    z.next_out = out;
+    z.avail_out = m_framesize;
 
-        if (read < m_blocksize)
-        {
-            fprintf(stderr, "compressed sector %d decoded to less than the blocksize\n", block);
-            m_curframe = 0xFFFFFFFF;
-            return false;
-        }
+    auto res = inflate(&z, Z_FINISH);
+    if (res != Z_STREAM_END)
+    {
+        fprintf(stderr, "zlib error on block %d: %d, %s\n", block, res, (z.msg) ? z.msg: "?");
+        return false;
+    }
 
-        inflateEnd(&z);
+    if (z.total_out < m_blocksize)
+    {
+        fprintf(stderr, "compressed sector %d decoded to less than the blocksize\n", block);
+        return false;
     }
-    
-    m_curframe = block;
+
     return true;
 }
 
+void CSO_Reader::free_decoders()
+{
+    for (Decoder& decoder : m_decoders)
+        inflateEnd(&decoder.z);
+    m_decoders.clear();
+}
+
 size_t CSO_Reader::read(uint8_t* dst, size_t size)
 {
     assert(size);
     assert(m_virtptr + size <= m_size);
     
-    const uint64_t start = m_virtptr;
-    const uint64_t end = start + size;
-    const auto start_block = (uint32_t)(start / m_blocksize);
-    const auto end_block = (uint32_t)(end / m_blocksize);
-    
-    uint64_t total_read = 0;
-    for (uint32_t i = start_block; i <= end_block; ++i)
-    {
-        if (!read_block_internal(i))
-            return total_read;
-        
-        const uint64_t local_ofs = start - (uint64_t)start_block * m_blocksize;
-        uint64_t readlen = m_blocksize;
-        if (i == start_block)
-            readlen -= local_ofs;
-        if (i == end_block)
-            readlen -= m_blocksize - (end - (uint64_t)end_block * m_blocksize);
-
-        memcpy(dst, m_frame + local_ofs, readlen);
-        total_read += readlen;
-        m_virtptr += readlen;
-        dst += readlen;
-    }
-    
+    size_t total_read = m_cache.read(m_virtptr, dst, size);
+    m_virtptr += total_read;
     return total_read;
 }
 
@@ -312,19 +296,34 @@ bool CSO_Reader::open(std::string name)
     m_shift = header.index_shift;
     m_blocksize = header.block_len;
     m_framesize = framesize;
-    m_frame = new uint8_t[m_framesize];
-    m_readbuf = new uint8_t[m_framesize];
+
+    // leave a core for the emulator. with none to spare, blocks are only decoded on demand
+    unsigned workers = std::min(std::max(std::thread::hardware_concurrency(), 1u) - 1, MAX_WORKERS);
+    // zlib keeps a pointer to each stream, so they mustn't move once initialized
+    m_decoders.resize(workers + 1);
+    for (unsigned i = 0; i < m_decoders.size(); ++i)
+    {
+        if (!init_decoder(m_decoders[i]))
+        {
+            m_decoders.resize(i);
+            close();
+            return false;
+        }
+    }
+
+    auto loader = [this] (unsigned worker, uint64_t block, uint8_t* out)
+    {
+        return decode_block(m_decoders[worker], (uint32_t)block, out) ? (size_t)m_blocksize : 0;
+    };
+    m_cache.start(m_blocksize, (m_size + m_blocksize - 1) / m_blocksize, workers, loader, m_framesize);
     
     return true;
 }
 
 void CSO_Reader::close()
 {
-    delete[] m_readbuf;
-    m_readbuf = nullptr;
-
-    delete[] m_frame;
-    m_frame = nullptr;
+    m_cache.stop();
+    free_decoders();
     
     delete[] m_indices;
     m_indices = nullptr;
@@ -338,5 +337,4 @@ void CSO_Reader::close()
     m_shift = 0;
     m_blocksize = 0;
     m_framesize = 0;
-    m_curframe = 0xFFFFFFFF;
 }
@@ -3,12 +3,29 @@
 
 #include <fstream>
 #include <cstdint>
+#include <mutex>
+#include <vector>
+#include <zlib.h>
+#include "block_cache.hpp"
 #include "cdvd_container.hpp"
 
 class CSO_Reader : public CDVD_Container
 {
+    public:
+        constexpr static size_t DEFAULT_CACHE_BLOCKS = 1024;
     protected:
+        constexpr static uint32_t PREFETCH_BLOCKS = 32;
+        constexpr static unsigned MAX_WORKERS = 3;
+
+        //Each thread that decodes blocks keeps its own inflate context and read buffer
+        struct Decoder
+        {
+            z_stream z;
+            std::vector<uint8_t> readbuf;
+        };
+
         std::ifstream m_file;
+        std::mutex m_file_mutex;
         size_t m_size;
         uint32_t m_shift;
         uint32_t m_blocksize;
@@ -18,13 +35,18 @@ class CSO_Reader : public CDVD_Container
         uint32_t* m_indices;
 
         uint32_t m_framesize;
-        uint32_t m_curframe;
-        uint8_t* m_frame;
-        uint8_t* m_readbuf;
 
-        bool read_block_internal(uint32_t block);
+        //One decoder for each of the cache's workers, and the last one for the thread that reads
+        std::vector<Decoder> m_decoders;
+
+        //Decompressed blocks
+        Block_Cache m_cache;
+
+        bool init_decoder(Decoder& decoder);
+        bool decode_block(Decoder& decoder, uint32_t block, uint8_t* out);
+        void free_decoders();
     public:
-        CSO_Reader();
+        CSO_Reader(size_t cache_blocks = DEFAULT_CACHE_BLOCKS);
         ~CSO_Reader();
 
         bool open(std::string name);
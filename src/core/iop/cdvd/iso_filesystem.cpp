@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <vector>
+#include "iso_filesystem.hpp"
+
+ISO_Filesystem::ISO_Filesystem() : container(nullptr), root({0, 0, true})
+{
+
+}
+
+void ISO_Filesystem::open(CDVD_Container *container, uint32_t root_lba, uint32_t root_size)
+{
+    this->container = container;
+    root = {root_lba, root_size, true};
+    directories.clear();
+}
+
+void ISO_Filesystem::close()
+{
+    container = nullptr;
+    directories.clear();
+}
+
+//Names on the disc are uppercase, and files carry a version like "SYSTEM.CNF;1".
+//Files without an extension are stored with a trailing dot ("NAME.;1").
+std::string ISO_Filesystem::normalize_name(const std::string &name)
+{
+    std::string result = name.substr(0, name.find(';'));
+    if (!result.empty() && result.back() == '.')
+        result.pop_back();
+
+    std::transform(result.begin(), result.end(), result.begin(), ::toupper);
+    return result;
+}
+
+bool ISO_Filesystem::find(const std::string &path, ISO_FileEntry &entry)
+{
+    if (!container)
+        return false;
+
+    ISO_FileEntry current = root;
+    size_t pos = 0;
+    while (pos < path.length())
+    {
+        size_t end = path.find_first_of("/\\", pos);
+        if (end == std::string::npos)
+            end = path.length();
+
+        //Leading and doubled separators don't name anything
+        if (end == pos)
+        {
+            pos++;
+            continue;
+        }
+
+        if (!current.is_dir)
+            return false;
+
+        Directory* dir = get_directory(current);
+        auto it = dir->find(normalize_name(path.substr(pos, end - pos)));
+        if (it == dir->end())
+            return false;
+
+        current = it->second;
+        pos = end + 1;
+    }
+
+    entry = current;
+    return true;
+}
+
+bool ISO_Filesystem::read(const ISO_FileEntry &entry, uint8_t *buff)
+{
+    if (!container)
+        return false;
+
+    uint8_t sector[SECTOR_SIZE];
+    for (uint32_t offset = 0; offset < entry.size; offset += SECTOR_SIZE)
+    {
+        uint32_t count = std::min(entry.size - offset, SECTOR_SIZE);
+        container->seek(entry.lba + offset / SECTOR_SIZE, std::ios::beg);
+        if (container->read(sector, SECTOR_SIZE) < count)
+            return false;
+        memcpy(buff + offset, sector, count);
+    }
+    return true;
+}
+
+ISO_Filesystem::Directory* ISO_Filesystem::get_directory(const ISO_FileEntry &dir)
+{
+    std::unique_ptr<Directory>& entries = directories[dir.lba];
+    if (!entries)
+    {
+        entries = std::make_unique<Directory>();
+        parse_directory(dir, *entries);
+    }
+    return entries.get();
+}
+
+void ISO_Filesystem::parse_directory(const ISO_FileEntry &dir, Directory &entries)
+{
+    uint32_t size = std::min(dir.size, MAX_DIRECTORY_SIZE);
+    uint8_t sector[SECTOR_SIZE];
+    for (uint32_t offset = 0; offset < size; offset += SECTOR_SIZE)
+    {
+        container->seek(dir.lba + offset / SECTOR_SIZE, std::ios::beg);
+        if (container->read(sector, SECTOR_SIZE) < SECTOR_SIZE)
+            return;
+
+        //Records never cross a sector boundary, a zero length pads out the rest of the sector
+        uint32_t pos = 0;
+        while (pos < SECTOR_SIZE)
+        {
+            uint8_t record_len = sector[pos];
+            if (record_len < 34 || pos + record_len > SECTOR_SIZE)
+                break;
+
+            uint8_t name_len = sector[pos + 32];
+            if (33 + name_len > record_len)
+                break;
+
+            //Skip the entries for the directory itself and its parent
+            const char* name = (const char*)&sector[pos + 33];
+            if (name_len > 1 || (name[0] != 0 && name[0] != 1))
+            {
+                ISO_FileEntry entry;
+                entry.lba = *(uint32_t*)&sector[pos + 2];
+                entry.size = *(uint32_t*)&sector[pos + 10];
+                entry.is_dir = sector[pos + 25] & 0x2;
+                entries[normalize_name(std::string(name, name_len))] = entry;
+            }
+
+            pos += record_len;
+        }
+    }
+}
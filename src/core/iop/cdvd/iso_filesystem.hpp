@@ -0,0 +1,51 @@
+#ifndef ISO_FILESYSTEM_HPP
+#define ISO_FILESYSTEM_HPP
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "cdvd_container.hpp"
+
+struct ISO_FileEntry
+{
+    uint32_t lba;
+    uint32_t size;
+    bool is_dir;
+};
+
+//Index of the ISO9660 directory tree on a disc.
+//Each directory extent is read and parsed once, the first time a lookup passes through it.
+class ISO_Filesystem
+{
+    private:
+        constexpr static uint32_t SECTOR_SIZE = 2048;
+
+        //Guards against corrupted directory records claiming huge extents
+        constexpr static uint32_t MAX_DIRECTORY_SIZE = 4 * 1024 * 1024;
+
+        typedef std::unordered_map<std::string, ISO_FileEntry> Directory;
+
+        CDVD_Container* container;
+        ISO_FileEntry root;
+
+        //Parsed directories by the LBA of their extent
+        std::unordered_map<uint32_t, std::unique_ptr<Directory>> directories;
+
+        static std::string normalize_name(const std::string& name);
+        Directory* get_directory(const ISO_FileEntry& dir);
+        void parse_directory(const ISO_FileEntry& dir, Directory& entries);
+    public:
+        ISO_Filesystem();
+
+        void open(CDVD_Container* container, uint32_t root_lba, uint32_t root_size);
+        void close();
+
+        //Paths are relative to the root of the disc. Either slash works as a separator, and
+        //names match regardless of case and of the ";1" version suffix.
+        bool find(const std::string& path, ISO_FileEntry& entry);
+
+        //Reads a whole file one sector at a time, so that it works the same on every container
+        bool read(const ISO_FileEntry& entry, uint8_t* buff);
+};
+
+#endif // ISO_FILESYSTEM_HPP
@@ -0,0 +1,188 @@
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include "mmap_reader.hpp"
+
+MMap_Reader::MMap_Reader(size_t sector_size, size_t data_offset) :
+    sector_size(sector_size), data_offset(data_offset), data(nullptr), size(0), pos(0), page_size(4096),
+    fd(-1), advise_end(0), request_end(0), cache(MAX_CHUNKS, READ_AHEAD_CHUNKS)
+{
+
+}
+
+MMap_Reader::~MMap_Reader()
+{
+    close();
+}
+
+bool MMap_Reader::is_raw()
+{
+    return sector_size != USER_DATA_SIZE;
+}
+
+bool MMap_Reader::open(std::string name)
+{
+    close();
+
+    fd = ::open(name.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !st.st_size)
+    {
+        close();
+        return false;
+    }
+    size = st.st_size;
+
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+    data = (const uint8_t*)mapping;
+    madvise(mapping, size, MADV_SEQUENTIAL);
+
+    page_size = sysconf(_SC_PAGESIZE);
+    pos = 0;
+    advise_end = 0;
+    request_end = 0;
+
+    cache.start(CHUNK_SIZE, (size + CHUNK_SIZE - 1) / CHUNK_SIZE, 1,
+                [this] (unsigned, uint64_t index, uint8_t* out) { return load_chunk(index, out); });
+    return true;
+}
+
+void MMap_Reader::close()
+{
+    cache.stop();
+    if (data)
+        munmap((void*)data, size);
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+    data = nullptr;
+    size = 0;
+    pos = 0;
+}
+
+//Raw sectors are read one at a time like BinCueReader does, plain images are a stream of user data
+size_t MMap_Reader::read(uint8_t* buff, size_t bytes)
+{
+    uint64_t start = pos + data_offset;
+    if (!data || start >= size)
+        return 0;
+
+    size_t count = (size_t)std::min((uint64_t)bytes, size - start);
+    advise(start + count);
+
+    //The pages are checked right before the copy, as the OS may drop them again at any time
+    if (is_resident(start, count))
+        memcpy(buff, data + start, count);
+    else
+        count = cache.read(start, buff, count);
+
+    pos += is_raw() ? sector_size : count;
+    return count;
+}
+
+void MMap_Reader::seek(size_t ofs, std::ios::seekdir whence)
+{
+    uint64_t offset = (uint64_t)ofs * sector_size;
+    if (whence == std::ios::beg)
+        pos = offset;
+    else if (whence == std::ios::cur)
+        pos += offset;
+    else if (whence == std::ios::end)
+        pos = size - offset;
+}
+
+void MMap_Reader::prefetch(size_t ofs, size_t count)
+{
+    uint64_t start = (uint64_t)ofs * sector_size;
+    if (!data || !count || start >= size)
+        return;
+
+    advise_end = start & ~(page_size - 1);
+    request_end = std::min(start + (uint64_t)count * sector_size, size);
+    advise(start);
+}
+
+//Keeps the kernel reading up to MAX_ADVISE ahead of offset, but not past what the drive was asked for.
+//Hints go out in halves of the window, so a sequential read doesn't make a syscall every sector.
+void MMap_Reader::advise(uint64_t offset)
+{
+    uint64_t limit = std::min(request_end, offset + MAX_ADVISE);
+    if (advise_end >= limit || (advise_end > offset && advise_end - offset >= MAX_ADVISE / 2))
+        return;
+
+    uint64_t start = std::max(advise_end, offset & ~(page_size - 1));
+    if (start >= limit)
+        return;
+
+    madvise((void*)(data + start), limit - start, MADV_WILLNEED);
+    advise_end = limit;
+}
+
+size_t MMap_Reader::read_at(uint8_t *buff, uint64_t offset, size_t bytes)
+{
+    size_t total = 0;
+    while (total < bytes)
+    {
+        ssize_t count = pread(fd, buff + total, bytes - total, offset + total);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            break;
+        total += count;
+    }
+    return total;
+}
+
+size_t MMap_Reader::load_chunk(uint64_t index, uint8_t* out)
+{
+    uint64_t start = index * CHUNK_SIZE;
+    return read_at(out, start, (size_t)std::min((uint64_t)CHUNK_SIZE, size - start));
+}
+
+bool MMap_Reader::is_resident(uint64_t offset, size_t bytes)
+{
+    uint64_t start = offset & ~(page_size - 1);
+    uint64_t end = offset + bytes;
+    size_t pages = (size_t)((end - start + page_size - 1) / page_size);
+
+#ifdef __APPLE__
+    char residency[8];
+#else
+    unsigned char residency[8];
+#endif
+    if (pages > sizeof(residency) || mincore((void*)(data + start), end - start, residency) < 0)
+        return false;
+
+    for (size_t i = 0; i < pages; i++)
+    {
+        if (!(residency[i] & 1))
+            return false;
+    }
+    return true;
+}
+
+bool MMap_Reader::is_open()
+{
+    return data != nullptr;
+}
+
+size_t MMap_Reader::get_size()
+{
+    return size;
+}
+
+#endif // _WIN32
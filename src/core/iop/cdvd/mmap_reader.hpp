@@ -0,0 +1,63 @@
+#ifndef MMAP_READER_HPP
+#define MMAP_READER_HPP
+#ifndef _WIN32
+#include <cstdint>
+#include "block_cache.hpp"
+#include "cdvd_container.hpp"
+
+//Maps an uncompressed image (ISO, or the data track of a BIN) into memory. Only available where mmap is.
+//Drive seeks turn into readahead hints for the kernel, and sectors that have made it into memory are copied
+//straight out of the mapping when the drive reads them. Anything else goes through a cache of chunks read
+//from the file, so the emulation thread doesn't wait on a page fault, and a failing disk or a file that
+//was cut short shows up as a short read rather than a bus error.
+class MMap_Reader : public CDVD_Container
+{
+    private:
+        constexpr static size_t USER_DATA_SIZE = 2048;
+
+        //How much of a seek's sectors get hinted at once
+        constexpr static uint64_t MAX_ADVISE = 4 * 1024 * 1024;
+
+        constexpr static size_t CHUNK_SIZE = 64 * 1024;
+        constexpr static size_t MAX_CHUNKS = 64;
+        constexpr static uint64_t READ_AHEAD_CHUNKS = 16;
+
+        size_t sector_size;
+        size_t data_offset;
+
+        const uint8_t* data;
+        uint64_t size;
+        uint64_t pos;
+        uint64_t page_size;
+
+        int fd;
+
+        //End of the part of the image that has been hinted, and of the part the drive was asked to read
+        uint64_t advise_end;
+        uint64_t request_end;
+
+        //Parts of the image that weren't in memory when the drive got to them
+        Block_Cache cache;
+
+        bool is_raw();
+        size_t read_at(uint8_t* buff, uint64_t offset, size_t bytes);
+        size_t load_chunk(uint64_t index, uint8_t* out);
+        bool is_resident(uint64_t offset, size_t bytes);
+        void advise(uint64_t offset);
+    public:
+        //Raw images store sector_size bytes per sector, with the user data data_offset bytes in
+        MMap_Reader(size_t sector_size = USER_DATA_SIZE, size_t data_offset = 0);
+        ~MMap_Reader();
+
+        bool open(std::string name);
+        void close();
+        size_t read(uint8_t* buff, size_t bytes);
+        void seek(size_t pos, std::ios::seekdir whence);
+        void prefetch(size_t pos, size_t count);
+
+        bool is_open();
+        size_t get_size();
+};
+
+#endif // _WIN32
+#endif // MMAP_READER_HPP
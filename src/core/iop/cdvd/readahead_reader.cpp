@@ -0,0 +1,75 @@
+#include <algorithm>
+#include "readahead_reader.hpp"
+
+ReadAhead_Reader::ReadAhead_Reader(CDVD_Container* source) :
+    source(source), size(0), pos(0), cache(MAX_CHUNKS, READ_AHEAD_CHUNKS)
+{
+
+}
+
+ReadAhead_Reader::~ReadAhead_Reader()
+{
+    //The source closes itself when destroyed, only the cache's thread has to go
+    cache.stop();
+}
+
+bool ReadAhead_Reader::open(std::string name)
+{
+    cache.stop();
+
+    if (!source->open(name))
+        return false;
+
+    size = source->get_size();
+    pos = 0;
+
+    cache.start(CHUNK_SIZE, (size + CHUNK_SIZE - 1) / CHUNK_SIZE, 1,
+                [this] (unsigned, uint64_t index, uint8_t* out) { return load_chunk(index, out); });
+    return true;
+}
+
+void ReadAhead_Reader::close()
+{
+    cache.stop();
+    source->close();
+}
+
+size_t ReadAhead_Reader::read(uint8_t *buff, size_t bytes)
+{
+    if (pos >= size)
+        return 0;
+
+    size_t count = cache.read(pos, buff, (size_t)std::min((uint64_t)bytes, size - pos));
+    pos += count;
+    return count;
+}
+
+void ReadAhead_Reader::seek(size_t ofs, std::ios::seekdir whence)
+{
+    uint64_t offset = (uint64_t)ofs * SECTOR_SIZE;
+    if (whence == std::ios::beg)
+        pos = offset;
+    else if (whence == std::ios::cur)
+        pos += offset;
+    else if (whence == std::ios::end)
+        pos = size - offset;
+}
+
+bool ReadAhead_Reader::is_open()
+{
+    return source->is_open();
+}
+
+size_t ReadAhead_Reader::get_size()
+{
+    return size;
+}
+
+size_t ReadAhead_Reader::load_chunk(uint64_t index, uint8_t* out)
+{
+    uint64_t start = index * CHUNK_SIZE;
+
+    std::lock_guard<std::mutex> lock(source_mutex);
+    source->seek(start / SECTOR_SIZE, std::ios::beg);
+    return source->read(out, (size_t)std::min((uint64_t)CHUNK_SIZE, size - start));
+}
@@ -0,0 +1,43 @@
+#ifndef READAHEAD_READER_HPP
+#define READAHEAD_READER_HPP
+#include <memory>
+#include <mutex>
+#include "block_cache.hpp"
+#include "cdvd_container.hpp"
+
+//Wraps a container that is a plain stream of 2048-byte sectors (ISO) with a cache of sector chunks,
+//which are read ahead of sequential reads on a background thread.
+//Containers that already cache and prefetch by themselves (CSO, CHD) shouldn't be wrapped.
+class ReadAhead_Reader : public CDVD_Container
+{
+    private:
+        constexpr static size_t SECTOR_SIZE = 2048;
+        constexpr static size_t CHUNK_SECTORS = 16;
+        constexpr static size_t CHUNK_SIZE = SECTOR_SIZE * CHUNK_SECTORS;
+        constexpr static size_t MAX_CHUNKS = 256;
+        constexpr static uint64_t READ_AHEAD_CHUNKS = 16;
+
+        std::unique_ptr<CDVD_Container> source;
+        uint64_t size;
+        uint64_t pos;
+
+        //Guards the source container, which is used by both threads
+        std::mutex source_mutex;
+
+        Block_Cache cache;
+
+        size_t load_chunk(uint64_t index, uint8_t* out);
+    public:
+        ReadAhead_Reader(CDVD_Container* source);
+        ~ReadAhead_Reader();
+
+        bool open(std::string name);
+        void close();
+        size_t read(uint8_t* buff, size_t bytes);
+        void seek(size_t pos, std::ios::seekdir whence);
+
+        bool is_open();
+        size_t get_size();
+};
+
+#endif // READAHEAD_READER_HPP
@@ -29,8 +29,8 @@ class Firewire
         void write32(uint32_t addr, uint32_t value);
         uint32_t read32(uint32_t addr);
         /*
-        void load_state(std::ifstream& state);
-        void save_state(std::ofstream& state);
+        void load_state(std::istream& state);
+        void save_state(std::ostream& state);
         */
 };
 
@@ -4,6 +4,8 @@
 #include <cstring>
 #include "iop.hpp"
 #include "iop_interpreter.hpp"
+#include "iop_jit.hpp"
+#include "iop_predecode.hpp"
 
 #include "../emulator.hpp"
 #include "../ee/emotiondisasm.hpp"
@@ -11,7 +13,7 @@
 
 IOP::IOP(Emulator* e) : e(e)
 {
-
+    set_run_func(&IOP::run_interpreter);
 }
 
 const char* IOP::REG(int id)
@@ -42,6 +44,7 @@ void IOP::reset()
     wait_for_IRQ = false;
     muldiv_delay = 0;
     cycles_to_run = 0;
+    forget_idle_loop();
 }
 
 uint32_t IOP::translate_addr(uint32_t addr)
@@ -59,45 +62,240 @@ uint32_t IOP::translate_addr(uint32_t addr)
 
 void IOP::run(int cycles)
 {
-    if (!wait_for_IRQ)
+    if (!wait_for_IRQ && !idle_loop.active)
     {
         cycles_to_run += cycles;
-        while (cycles_to_run > 0)
+        run_func(*this);
+    }
+    else if (muldiv_delay)
+        muldiv_delay--;
+
+    if (cop0.status.IEc && (cop0.status.Im & cop0.cause.int_pending))
+        interrupt();
+}
+
+void IOP::run_interpreter()
+{
+    while (cycles_to_run > 0)
+        interpret_instr();
+}
+
+void IOP::run_jit()
+{
+    while (cycles_to_run > 0)
+    {
+        //The JIT returns in the middle of branches it can't handle, and leaves disassembly to the interpreter
+        if (will_branch || can_disassemble)
+            interpret_instr();
+        else
+            IOP_JIT::run(this);
+    }
+}
+
+//Runs only the block at PC through the JIT and leaves the cycle count as it was.
+//The tests use this to check the JIT against the interpreter.
+void IOP::run_jit_block()
+{
+    int cycles = cycles_to_run;
+    cycles_to_run = 1;
+    IOP_JIT::run(this);
+    cycles_to_run = cycles;
+}
+
+void IOP::set_run_func(std::function<void(IOP&)> func)
+{
+    run_func = func;
+}
+
+void IOP::interpret_instr()
+{
+    cycles_to_run--;
+    if (muldiv_delay > 0)
+        muldiv_delay--;
+    uint32_t instr = read_instr(PC);
+    if (can_disassemble)
+    {
+        printf("[IOP] [$%08X] $%08X - %s\n", PC, instr, EmotionDisasm::disasm_instr(instr, PC).c_str());
+        //print_state();
+    }
+    IOP_Interpreter::interpret(*this, instr);
+
+    advance_PC();
+}
+
+void IOP::run_predecoded()
+{
+    while (cycles_to_run > 0)
+    {
+        //Disassembly and code outside of RAM and the BIOS go through the regular interpreter
+        IOP_DecodedBlock* block = nullptr;
+        if (!can_disassemble)
+            block = IOP_Predecode::get_block(*this, PC);
+
+        if (!block)
+        {
+            interpret_instr();
+            continue;
+        }
+
+        //Same steps as interpret_instr, minus fetching and decoding.
+        //The block is left as soon as control flow goes elsewhere, e.g. a taken branch or an exception,
+        //or if an instruction overwrites the block.
+        uint32_t expected_PC = PC;
+        for (const IOP_DecodedOp& op : block->ops)
         {
             cycles_to_run--;
             if (muldiv_delay > 0)
                 muldiv_delay--;
-            uint32_t instr = read_instr(PC);
-            if (can_disassemble)
-            {
-                printf("[IOP] [$%08X] $%08X - %s\n", PC, instr, EmotionDisasm::disasm_instr(instr, PC).c_str());
-                //print_state();
-            }
-            IOP_Interpreter::interpret(*this, instr);
+            fetch_delay(PC);
+
+            op.func(*this, op.instruction);
+
+            advance_PC();
+            expected_PC += 4;
+
+            if (PC != expected_PC || !block->valid || cycles_to_run <= 0)
+                break;
+        }
+    }
+}
 
-            PC += 4;
+void IOP::advance_PC()
+{
+    PC += 4;
 
-            if (will_branch)
+    if (will_branch)
+    {
+        if (!branch_delay)
+        {
+            will_branch = false;
+            uint32_t loop_end = PC;
+            PC = new_PC;
+            if (PC & 0x3)
             {
-                if (!branch_delay)
-                {
-                    will_branch = false;
-                    PC = new_PC;
-                    if (PC & 0x3)
-                    {
-                        Errors::die("[IOP] Invalid PC address $%08X!\n", PC);
-                    }
-                }
-                else
-                    branch_delay--;
+                Errors::die("[IOP] Invalid PC address $%08X!\n", PC);
             }
+            follow_branch(loop_end);
         }
+        else
+            branch_delay--;
     }
-    else if (muldiv_delay)
-        muldiv_delay--;
+}
 
-    if (cop0.status.IEc && (cop0.status.Im & cop0.cause.int_pending))
-        interrupt();
+//Called whenever a short loop jumps back to its start, by the interpreters and the JIT alike
+void IOP::check_idle_loop(uint32_t loop_end)
+{
+    if (idle_loop.start != PC || idle_loop.end != loop_end)
+    {
+        idle_loop.start = PC;
+        idle_loop.end = loop_end;
+        idle_loop.side_effect_free = analyze_idle_loop();
+    }
+    else if (idle_loop.side_effect_free && !memcmp(idle_loop.gpr, gpr, sizeof(gpr)) && enter_idle_loop())
+    {
+        //The rest of the slice would only be spent spinning
+        idle_loop.active = true;
+        if (cycles_to_run > 0)
+            cycles_to_run = 0;
+        return;
+    }
+
+    if (idle_loop.side_effect_free)
+        memcpy(idle_loop.gpr, gpr, sizeof(gpr));
+}
+
+void IOP::forget_idle_loop()
+{
+    idle_loop.start = 0;
+    idle_loop.end = 0;
+    idle_loop.side_effect_free = false;
+    idle_loop.active = false;
+}
+
+//A loop may only read RAM and registers, and must not write anything but registers.
+//Branches out of the loop are fine: with the same state, they will never be taken,
+//and follow_branch starts over should an iteration leave the loop after all.
+bool IOP::analyze_idle_loop()
+{
+    using namespace IOP_Interpreter;
+
+    uint32_t written_regs = 0;
+    uint32_t base_regs = 0;
+    idle_loop.poll_count = 0;
+    for (uint32_t addr = idle_loop.start; addr < idle_loop.end; addr += 4)
+    {
+        uint32_t instr = e->iop_read32(addr & 0x1FFFFFFF);
+        Handler func = decode(instr);
+        int rs = (instr >> 21) & 0x1F;
+        int rt = (instr >> 16) & 0x1F;
+        int rd = (instr >> 11) & 0x1F;
+
+        if (func == &nop || func == &j || func == &beq || func == &bne || func == &blez || func == &bgtz ||
+            func == &bltz || func == &bgez)
+            continue;
+
+        if (func == &addi || func == &addiu || func == &slti || func == &sltiu || func == &andi || func == &ori ||
+            func == &xori || func == &lui)
+            written_regs |= 1 << rt;
+        else if (func == &sll || func == &srl || func == &sra || func == &sllv || func == &srlv || func == &srav ||
+                 func == &add || func == &addu || func == &sub || func == &subu || func == &and_cpu ||
+                 func == &or_cpu || func == &xor_cpu || func == &nor || func == &slt || func == &sltu)
+            written_regs |= 1 << rd;
+        else if (func == &lb || func == &lbu || func == &lh || func == &lhu || func == &lw)
+        {
+            if (idle_loop.poll_count == IOP_IdleLoop::MAX_POLLS)
+                return false;
+            idle_loop.poll_base[idle_loop.poll_count] = rs;
+            idle_loop.poll_offset[idle_loop.poll_count] = (int16_t)(instr & 0xFFFF);
+            idle_loop.poll_count++;
+            base_regs |= 1 << rs;
+            written_regs |= 1 << rt;
+        }
+        else
+            return false;
+    }
+
+    //Every iteration has to poll the same addresses
+    return !(written_regs & base_regs);
+}
+
+//Only RAM is polled, as every write to it goes through invalidate()
+bool IOP::enter_idle_loop()
+{
+    for (int i = 0; i < idle_loop.poll_count; i++)
+    {
+        uint32_t addr = translate_addr(gpr[idle_loop.poll_base[i]] + idle_loop.poll_offset[i]) & ~0x3;
+        if (addr >= 0x00200000)
+            return false;
+        idle_loop.poll_addr[i] = addr;
+        idle_loop.poll_value[i] = e->iop_read32(addr);
+    }
+    return true;
+}
+
+//Called for every write to IOP RAM, with the physical address.
+//Rewriting the loop's code means it has to be checked again, and writing a polled word ends the wait.
+void IOP::invalidate(uint32_t addr, uint32_t size)
+{
+    uint32_t end = addr + size;
+    if (translate_addr(idle_loop.start) < end && addr < translate_addr(idle_loop.end))
+    {
+        forget_idle_loop();
+        return;
+    }
+
+    if (!idle_loop.active)
+        return;
+
+    for (int i = 0; i < idle_loop.poll_count; i++)
+    {
+        uint32_t poll_addr = idle_loop.poll_addr[i];
+        if (poll_addr < end && addr < poll_addr + 4 && e->iop_read32(poll_addr) != idle_loop.poll_value[i])
+        {
+            idle_loop.active = false;
+            return;
+        }
+    }
 }
 
 void IOP::print_state()
@@ -156,6 +354,7 @@ void IOP::handle_exception(uint32_t addr, uint8_t cause)
     PC = addr - 4;
     branch_delay = 0;
     will_branch = false;
+    idle_loop.active = false;
 }
 
 void IOP::syscall_exception()
@@ -239,7 +438,7 @@ uint32_t IOP::read32(uint32_t addr)
     return e->iop_read32(translate_addr(addr));
 }
 
-uint32_t IOP::read_instr(uint32_t addr)
+void IOP::fetch_delay(uint32_t addr)
 {
     //Uncached RAM waitstate. In the future might be good idea to do BIOS as well
     if (addr >= 0xA0000000 || !(cache_control & (1 << 11)))
@@ -247,6 +446,11 @@ uint32_t IOP::read_instr(uint32_t addr)
         cycles_to_run -= 4;
         muldiv_delay = std::max(muldiv_delay - 4, 0);
     }
+}
+
+uint32_t IOP::read_instr(uint32_t addr)
+{
+    fetch_delay(addr);
 
     //This is supposed to be icache handling code.
     //Either due to a misunderstanding of the icache, the lack of cache emulation on the EE, or some other problems,
@@ -4,6 +4,7 @@
 #include <cstdlib>
 #include <cstdio>
 #include <fstream>
+#include <functional>
 #include "iop_cop0.hpp"
 
 class Emulator;
@@ -14,6 +15,27 @@ struct IOP_ICacheLine
     uint32_t tag;
 };
 
+//A short backwards loop the IOP may be spinning in without side effects, e.g. polling a flag in RAM.
+//Once an iteration leaves the registers untouched, every further iteration will be identical until
+//one of the polled words is written or an interrupt is taken, so the IOP can stop running it until then.
+struct IOP_IdleLoop
+{
+    constexpr static int MAX_LENGTH = 16;
+    constexpr static int MAX_POLLS = 4;
+
+    uint32_t start, end;
+    bool side_effect_free;
+    bool active;
+
+    uint32_t gpr[32];
+
+    int poll_count;
+    int poll_base[MAX_POLLS];
+    int16_t poll_offset[MAX_POLLS];
+    uint32_t poll_addr[MAX_POLLS];
+    uint32_t poll_value[MAX_POLLS];
+};
+
 class IOP
 {
     private:
@@ -36,15 +58,36 @@ class IOP
         int muldiv_delay;
         int cycles_to_run;
 
+        IOP_IdleLoop idle_loop;
+
+        std::function<void(IOP&)> run_func;
+
         uint32_t translate_addr(uint32_t addr);
+        void fetch_delay(uint32_t addr);
+        void interpret_instr();
+        void advance_PC();
+
+        void follow_branch(uint32_t block_end);
+        void check_idle_loop(uint32_t loop_end);
+        void forget_idle_loop();
+        bool analyze_idle_loop();
+        bool enter_idle_loop();
     public:
         IOP(Emulator* e);
         static const char* REG(int id);
 
         void reset();
         void run(int cycles);
+        void run_interpreter();
+        void run_predecoded();
+        void run_jit();
+        void run_jit_block();
+        void set_run_func(std::function<void(IOP&)> func);
         void halt();
         void unhalt();
+        bool is_halted();
+        bool is_idle();
+        void invalidate(uint32_t addr, uint32_t size);
         void print_state();
         void set_disassembly(bool dis);
         void set_muldiv_delay(int delay);
@@ -79,8 +122,10 @@ class IOP
         void write16(uint32_t addr, uint16_t value);
         void write32(uint32_t addr, uint32_t value);
 
-        void load_state(std::ifstream& state);
-        void save_state(std::ofstream& state);
+        void load_state(std::istream& state);
+        void save_state(std::ostream& state);
+
+        friend class IOP_JIT64;
 };
 
 inline void IOP::halt()
@@ -93,6 +138,27 @@ inline void IOP::unhalt()
     wait_for_IRQ = false;
 }
 
+inline bool IOP::is_halted()
+{
+    return wait_for_IRQ;
+}
+
+inline bool IOP::is_idle()
+{
+    return wait_for_IRQ || idle_loop.active;
+}
+
+//Called whenever execution moves on from code that ended at block_end after a taken branch.
+//A short backwards jump may close a polling loop. Going anywhere outside the loop being watched means
+//an iteration doesn't stay within the code that was checked, so it has to start over.
+inline void IOP::follow_branch(uint32_t block_end)
+{
+    if (PC < block_end && block_end - PC <= IOP_IdleLoop::MAX_LENGTH * 4)
+        check_idle_loop(block_end);
+    else if (PC < idle_loop.start || PC >= idle_loop.end)
+        forget_idle_loop();
+}
+
 inline uint32_t IOP::get_PC()
 {
     return PC;
@@ -2,6 +2,7 @@
 #include "cdvd/cdvd.hpp"
 #include "iop_dma.hpp"
 #include "iop_intc.hpp"
+#include "iop_jit.hpp"
 #include "sio2.hpp"
 #include "spu/spu.hpp"
 
@@ -67,6 +68,7 @@ void IOP_DMA::process_CDVD()
     uint32_t count = channels[IOP_CDVD].word_count * channels[IOP_CDVD].block_size * 4;
     printf("[IOP DMA] CDVD bytes: $%08X\n", count);
     uint32_t bytes_read = cdvd->read_to_RAM(RAM + channels[IOP_CDVD].addr, count);
+    IOP_JIT::invalidate(channels[IOP_CDVD].addr, bytes_read);
     if (count <= bytes_read)
     {
         transfer_end(IOP_CDVD);
@@ -103,6 +105,7 @@ void IOP_DMA::process_SPU()
             {
                 uint32_t value = spu->read_DMA();
                 *(uint32_t*)&RAM[channels[IOP_SPU].addr] = value;
+                IOP_JIT::invalidate(channels[IOP_SPU].addr, sizeof(value));
             }
             channels[IOP_SPU].size--;
             channels[IOP_SPU].addr += 4;
@@ -147,6 +150,7 @@ void IOP_DMA::process_SPU2()
             {
                 uint32_t value = spu2->read_DMA();
                 *(uint32_t*)&RAM[channels[IOP_SPU2].addr] = value;
+                IOP_JIT::invalidate(channels[IOP_SPU2].addr, sizeof(value));
             }
             channels[IOP_SPU2].size--;
             channels[IOP_SPU2].addr += 4;
@@ -225,6 +229,7 @@ void IOP_DMA::process_SIF1()
         uint32_t data = sif->read_SIF1();
 
         *(uint32_t*)&RAM[channels[IOP_SIF1].addr] = data;
+        IOP_JIT::invalidate(channels[IOP_SIF1].addr, sizeof(data));
         channels[IOP_SIF1].addr += 4;
         channels[IOP_SIF1].word_count--;
         if (!channels[IOP_SIF1].word_count && channels[IOP_SIF1].tag_end)
@@ -266,6 +271,7 @@ void IOP_DMA::process_SIO2in()
 void IOP_DMA::process_SIO2out()
 {
     int size = channels[IOP_SIO2out].word_count * channels[IOP_SIO2out].block_size * 4;
+    IOP_JIT::invalidate(channels[IOP_SIO2out].addr, size);
     while (size)
     {
         RAM[channels[IOP_SIO2out].addr] = sio2->read_serial();
@@ -108,6 +108,7 @@ class IOP_DMA
 
         void reset(uint8_t* RAM);
         void run(int cycles);
+        bool is_active();
 
         uint32_t get_DPCR();
         uint32_t get_DPCR2();
@@ -133,8 +134,13 @@ class IOP_DMA
         void set_chan_control(int index, uint32_t value);
         void set_chan_tag_addr(int index, uint32_t value);
 
-        void load_state(std::ifstream& state);
-        void save_state(std::ofstream& state);
+        void load_state(std::istream& state);
+        void save_state(std::ostream& state);
 };
 
+inline bool IOP_DMA::is_active()
+{
+    return active_channel != nullptr;
+}
+
 #endif // IOP_DMA_HPP
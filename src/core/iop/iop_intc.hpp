@@ -27,8 +27,8 @@ class IOP_INTC
         void write_istat(uint32_t value);
         void write_ictrl(uint32_t value);
 
-        void load_state(std::ifstream& state);
-        void save_state(std::ofstream& state);
+        void load_state(std::istream& state);
+        void save_state(std::ostream& state);
 };
 
 #endif // IOP_INTC_HPP
@@ -105,6 +105,166 @@ void IOP_Interpreter::interpret(IOP &cpu, uint32_t instruction)
     }
 }
 
+//Returns the handler interpret() would end up calling for this instruction.
+//Unknown opcodes map to interpret() itself, so the error is only raised if they are ever executed.
+IOP_Interpreter::Handler IOP_Interpreter::decode(uint32_t instruction)
+{
+    if (!instruction)
+        return &nop;
+    int op = instruction >> 26;
+    switch (op)
+    {
+        case 0x00:
+            switch (instruction & 0x3F)
+            {
+                case 0x00:
+                    return &sll;
+                case 0x02:
+                    return &srl;
+                case 0x03:
+                    return &sra;
+                case 0x04:
+                    return &sllv;
+                case 0x06:
+                    return &srlv;
+                case 0x07:
+                    return &srav;
+                case 0x08:
+                    return &jr;
+                case 0x09:
+                    return &jalr;
+                case 0x0C:
+                    return &syscall;
+                case 0x10:
+                    return &mfhi;
+                case 0x11:
+                    return &mthi;
+                case 0x12:
+                    return &mflo;
+                case 0x13:
+                    return &mtlo;
+                case 0x18:
+                    return &mult;
+                case 0x19:
+                    return &multu;
+                case 0x1A:
+                    return &div;
+                case 0x1B:
+                    return &divu;
+                case 0x20:
+                    return &add;
+                case 0x21:
+                    return &addu;
+                case 0x22:
+                    return &sub;
+                case 0x23:
+                    return &subu;
+                case 0x24:
+                    return &and_cpu;
+                case 0x25:
+                    return &or_cpu;
+                case 0x26:
+                    return &xor_cpu;
+                case 0x27:
+                    return &nor;
+                case 0x2A:
+                    return &slt;
+                case 0x2B:
+                    return &sltu;
+                default:
+                    return &interpret;
+            }
+        case 0x01:
+            switch ((instruction >> 16) & 0x1F)
+            {
+                case 0x00:
+                    return &bltz;
+                case 0x01:
+                    return &bgez;
+                case 0x10:
+                    return &bltzal;
+                case 0x11:
+                    return &bgezal;
+                default:
+                    return &interpret;
+            }
+        case 0x02:
+            return &j;
+        case 0x03:
+            return &jal;
+        case 0x04:
+            return &beq;
+        case 0x05:
+            return &bne;
+        case 0x06:
+            return &blez;
+        case 0x07:
+            return &bgtz;
+        case 0x08:
+            return &addi;
+        case 0x09:
+            return &addiu;
+        case 0x0A:
+            return &slti;
+        case 0x0B:
+            return &sltiu;
+        case 0x0C:
+            return &andi;
+        case 0x0D:
+            return &ori;
+        case 0x0E:
+            return &xori;
+        case 0x0F:
+            return &lui;
+        case 0x10:
+        case 0x11:
+        case 0x12:
+        case 0x13:
+            switch (((instruction >> 21) & 0x1F) | ((op & 0x3) << 8))
+            {
+                case 0x000:
+                    return &mfc;
+                case 0x004:
+                    return &mtc;
+                case 0x010:
+                    return &rfe;
+                default:
+                    return &interpret;
+            }
+        case 0x20:
+            return &lb;
+        case 0x21:
+            return &lh;
+        case 0x22:
+            return &lwl;
+        case 0x23:
+            return &lw;
+        case 0x24:
+            return &lbu;
+        case 0x25:
+            return &lhu;
+        case 0x26:
+            return &lwr;
+        case 0x28:
+            return &sb;
+        case 0x29:
+            return &sh;
+        case 0x2A:
+            return &swl;
+        case 0x2B:
+            return &sw;
+        case 0x2E:
+            return &swr;
+        default:
+            return &interpret;
+    }
+}
+
+void IOP_Interpreter::nop(IOP &cpu, uint32_t instruction)
+{
+
+}
+
 void IOP_Interpreter::j(IOP &cpu, uint32_t instruction)
 {
     uint32_t addr = (instruction & 0x3FFFFFF) << 2;
@@ -875,6 +1035,11 @@ void IOP_Interpreter::mtc(IOP &cpu, uint32_t instruction)
     cpu.mtc(cop_id, cop_reg, reg);
 }
 
+void IOP_Interpreter::rfe(IOP &cpu, uint32_t instruction)
+{
+    cpu.rfe();
+}
+
 void IOP_Interpreter::unknown_op(const char *type, uint16_t op, uint32_t instruction)
 {
     Errors::die("[IOP_Interpreter] Unrecognized %s op $%02X (instr: $%08X)", type, op, instruction);
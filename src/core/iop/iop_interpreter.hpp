@@ -4,7 +4,12 @@
 
 namespace IOP_Interpreter
 {
+    typedef void (*Handler)(IOP& cpu, uint32_t instruction);
+
     void interpret(IOP& cpu, uint32_t instruction);
+    Handler decode(uint32_t instruction);
+
+    void nop(IOP& cpu, uint32_t instruction);
 
     void j(IOP& cpu, uint32_t instruction);
     void jal(IOP& cpu, uint32_t instruction);
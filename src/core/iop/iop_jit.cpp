@@ -0,0 +1,34 @@
+#include "iop_jit.hpp"
+#include "iop_jit64.hpp"
+#include "iop.hpp"
+#include "iop_predecode.hpp"
+
+namespace IOP_JIT
+{
+
+IOP_JIT64 jit64;
+IOP* iop_core = nullptr;
+
+void run(IOP *iop)
+{
+    jit64.run(*iop);
+}
+
+void reset(IOP* iop)
+{
+    iop_core = iop;
+    jit64.reset(*iop);
+}
+
+//Called for every write to IOP RAM, with the physical address.
+//The predecoded interpreter's blocks are dropped here too, as either backend can be switched to at any time,
+//and so is any idle loop the IOP is watching.
+void invalidate(uint32_t addr, uint32_t size)
+{
+    jit64.invalidate(addr, size);
+    IOP_Predecode::invalidate(addr, size);
+    if (iop_core)
+        iop_core->invalidate(addr, size);
+}
+
+};
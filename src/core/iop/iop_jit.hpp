@@ -0,0 +1,16 @@
+#ifndef IOP_JIT_HPP
+#define IOP_JIT_HPP
+#include <cstdint>
+
+class IOP;
+
+namespace IOP_JIT
+{
+
+void run(IOP* iop);
+void reset(IOP* iop);
+void invalidate(uint32_t addr, uint32_t size);
+
+};
+
+#endif // IOP_JIT_HPP
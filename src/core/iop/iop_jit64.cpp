@@ -0,0 +1,510 @@
+#include <algorithm>
+#include <cstring>
+
+#include "iop_jit64.hpp"
+#include "iop.hpp"
+#include "iop_interpreter.hpp"
+
+#include "../errors.hpp"
+
+/**
+ * Blocks are plain functions taking the IOP object. R15 holds the IOP for the whole block, and the GPRs are
+ * accessed in memory, so no register allocation is needed and the interpreter can be called at any point.
+ * RAX and RCX are used as scratch registers.
+ *
+ * Stack frame: RBP and R15 are pushed, then 0x28 bytes are reserved. This keeps RSP 16-byte aligned for calls
+ * and provides the 32 bytes of argument spillage needed by the Microsoft ABI.
+ */
+
+#define GPR_OFFSET(reg) (offsets.gpr + (uint32_t)(reg) * 4)
+
+static uint32_t offset_in(const IOP& iop, const void* member)
+{
+    return (uint32_t)((const uint8_t*)member - (const uint8_t*)&iop);
+}
+
+IOP_JIT64::IOP_JIT64() : jit_block("IOP"), emitter(&jit_block)
+{
+    offsets = {};
+    cycles_pending = 0;
+    memset(lookup_cache, 0, sizeof(lookup_cache));
+}
+
+void IOP_JIT64::reset(IOP& iop)
+{
+    offsets.gpr = offset_in(iop, &iop.gpr);
+    offsets.PC = offset_in(iop, &iop.PC);
+    offsets.new_PC = offset_in(iop, &iop.new_PC);
+    offsets.will_branch = offset_in(iop, &iop.will_branch);
+    offsets.branch_delay = offset_in(iop, &iop.branch_delay);
+    offsets.cycles_to_run = offset_in(iop, &iop.cycles_to_run);
+    offsets.muldiv_delay = offset_in(iop, &iop.muldiv_delay);
+    flush_all_blocks();
+}
+
+void IOP_JIT64::flush_all_blocks()
+{
+    jit_heap.flush_all_blocks();
+    memset(lookup_cache, 0, sizeof(lookup_cache));
+    block_ends.clear();
+    for (uint32_t i = 0; i < (RAM_SIZE >> REGION_SHIFT); i++)
+        code_regions[i].clear();
+}
+
+void IOP_JIT64::run(IOP& iop)
+{
+    //Blocks start outside of delay slots. If a block stopped before a delay slot, the interpreter finishes the branch.
+    while (iop.cycles_to_run > 0 && !iop.will_branch)
+    {
+        uint32_t PC = iop.PC;
+        bool uncached = PC >= 0xA0000000 || !(iop.cache_control & (1 << 11));
+        uint64_t key = PC | ((uint64_t)uncached << 32);
+
+        IOPLookupEntry& entry = lookup_cache[(PC >> 2) & (LOOKUP_CACHE_SIZE - 1)];
+        if (!entry.block || entry.block->block_data != key)
+        {
+            entry.block = jit_heap.find_block(key);
+            if (!entry.block)
+                entry.block = recompile_block(iop, key);
+            entry.end_PC = block_ends[key];
+        }
+
+        uint32_t end_PC = entry.end_PC;
+        ((IOPJitBlockFunc)entry.block->code_start)(iop);
+
+        if (iop.PC & 0x3)
+            Errors::die("[IOP] Invalid PC address $%08X!\n", iop.PC);
+
+        //Blocks end on branches, so this is where the interpreter would look for idle loops
+        if (!iop.will_branch)
+            iop.follow_branch(end_PC);
+    }
+}
+
+void IOP_JIT64::invalidate(uint32_t addr, uint32_t size)
+{
+    if (addr >= RAM_SIZE || !size)
+        return;
+
+    uint32_t end = std::min(addr + size, RAM_SIZE);
+    for (uint32_t region = addr >> REGION_SHIFT; region <= (end - 1) >> REGION_SHIFT; region++)
+    {
+        std::vector<IOPCodeRange>& ranges = code_regions[region];
+        //erase_block removes the range from this list, so work from the back
+        for (size_t i = ranges.size(); i-- > 0;)
+        {
+            if (ranges[i].start < end && addr < ranges[i].end)
+                erase_block(ranges[i]);
+        }
+    }
+}
+
+void IOP_JIT64::erase_block(IOPCodeRange range)
+{
+    for (uint32_t region = range.start >> REGION_SHIFT; region <= (range.end - 1) >> REGION_SHIFT; region++)
+    {
+        std::vector<IOPCodeRange>& ranges = code_regions[region];
+        for (auto it = ranges.begin(); it != ranges.end(); ++it)
+        {
+            if (it->key == range.key)
+            {
+                ranges.erase(it);
+                break;
+            }
+        }
+    }
+
+    IOPLookupEntry& cached = lookup_cache[((uint32_t)range.key >> 2) & (LOOKUP_CACHE_SIZE - 1)];
+    if (cached.block && cached.block->block_data == range.key)
+        cached.block = nullptr;
+    block_ends.erase(range.key);
+
+    jit_heap.invalidate_block(range.key);
+}
+
+IOPJitBlockRecord* IOP_JIT64::recompile_block(IOP& iop, uint64_t key)
+{
+    //Make sure inserting the block can't flush the heap behind our back
+    if (jit_heap.heap_is_full())
+        flush_all_blocks();
+
+    uint32_t start_PC = (uint32_t)key;
+    uint32_t end_PC;
+    IR::Block block = ir.translate(iop, start_PC, key >> 32, end_PC);
+
+    jit_block.clear();
+    cycles_pending = 0;
+
+    emitter.PUSH(REG_64::RBP);
+    emitter.PUSH(REG_64::R15);
+    emitter.SUB64_REG_IMM(0x28, REG_64::RSP);
+#ifdef _WIN32
+    emitter.MOV64_MR(REG_64::RCX, REG_64::R15);
+#else
+    emitter.MOV64_MR(REG_64::RDI, REG_64::R15);
+#endif
+
+    while (block.get_instruction_count() > 0)
+    {
+        IR::Instruction instr = block.get_next_instr();
+        emit_instruction(iop, instr);
+    }
+
+    IOPJitBlockRecord* record = jit_heap.insert_block(key, &jit_block);
+    block_ends[key] = end_PC;
+
+    //Only RAM can be written to, so blocks in the BIOS are never invalidated
+    uint32_t phys_start = start_PC & 0x1FFFFFFF;
+    uint32_t phys_end = phys_start + (end_PC - start_PC);
+    if (phys_end <= RAM_SIZE)
+    {
+        IOPCodeRange range;
+        range.key = key;
+        range.start = phys_start;
+        range.end = phys_end;
+        for (uint32_t region = phys_start >> REGION_SHIFT; region <= (phys_end - 1) >> REGION_SHIFT; region++)
+            code_regions[region].push_back(range);
+    }
+
+    return record;
+}
+
+void IOP_JIT64::emit_instruction(IOP &iop, IR::Instruction &instr)
+{
+    cycles_pending += instr.get_cycle_count();
+    switch (instr.op)
+    {
+        case IR::Opcode::Nop:
+            break;
+        case IR::Opcode::LoadConst:
+            load_const(instr);
+            break;
+        case IR::Opcode::MoveWordReg:
+            move_word_reg(instr);
+            break;
+        case IR::Opcode::AddWordImm:
+            add_word_imm(instr);
+            break;
+        case IR::Opcode::AndImm:
+            and_imm(instr);
+            break;
+        case IR::Opcode::OrImm:
+            or_imm(instr);
+            break;
+        case IR::Opcode::XorImm:
+            xor_imm(instr);
+            break;
+        case IR::Opcode::SetOnLessThanImmediate:
+            set_on_less_than_imm(instr, ConditionCode::L);
+            break;
+        case IR::Opcode::SetOnLessThanImmediateUnsigned:
+            set_on_less_than_imm(instr, ConditionCode::B);
+            break;
+        case IR::Opcode::AddWordReg:
+        case IR::Opcode::SubWordReg:
+        case IR::Opcode::AndReg:
+        case IR::Opcode::OrReg:
+        case IR::Opcode::XorReg:
+        case IR::Opcode::NorReg:
+            alu_reg(instr);
+            break;
+        case IR::Opcode::SetOnLessThan:
+            set_on_less_than(instr, ConditionCode::L);
+            break;
+        case IR::Opcode::SetOnLessThanUnsigned:
+            set_on_less_than(instr, ConditionCode::B);
+            break;
+        case IR::Opcode::ShiftLeftLogical:
+        case IR::Opcode::ShiftRightLogical:
+        case IR::Opcode::ShiftRightArithmetic:
+            shift_imm(instr);
+            break;
+        case IR::Opcode::ShiftLeftLogicalVariable:
+        case IR::Opcode::ShiftRightLogicalVariable:
+        case IR::Opcode::ShiftRightArithmeticVariable:
+            shift_variable(instr);
+            break;
+        case IR::Opcode::BranchEqual:
+            branch(instr, ConditionCode::NE);
+            break;
+        case IR::Opcode::BranchNotEqual:
+            branch(instr, ConditionCode::E);
+            break;
+        case IR::Opcode::BranchLessThanOrEqualZero:
+            branch(instr, ConditionCode::G);
+            break;
+        case IR::Opcode::BranchGreaterThanZero:
+            branch(instr, ConditionCode::LE);
+            break;
+        case IR::Opcode::FallbackInterpreter:
+            fallback_interpreter(instr);
+            break;
+        case IR::Opcode::MoveFromHI:
+        case IR::Opcode::MoveFromLO:
+        case IR::Opcode::MultiplyWord:
+        case IR::Opcode::MultiplyUnsignedWord:
+        case IR::Opcode::DivideWord:
+        case IR::Opcode::DivideUnsignedWord:
+            fallback_muldiv(instr);
+            break;
+        case IR::Opcode::Jump:
+        case IR::Opcode::JumpAndLink:
+        case IR::Opcode::JumpIndirect:
+        case IR::Opcode::JumpAndLinkIndirect:
+        case IR::Opcode::BranchLessThanZero:
+        case IR::Opcode::BranchGreaterThanOrEqualZero:
+            fallback_jump(instr);
+            break;
+        case IR::Opcode::SystemCall:
+            system_call(instr);
+            break;
+        case IR::Opcode::SavePC:
+            save_pc(instr);
+            break;
+        case IR::Opcode::MoveDelayedBranch:
+            move_delayed_branch(instr);
+            break;
+        default:
+            Errors::die("[IOP_JIT64] Unknown IR instruction %d", instr.op);
+    }
+}
+
+void IOP_JIT64::emit_epilogue()
+{
+    sync_cycles();
+    emitter.ADD64_REG_IMM(0x28, REG_64::RSP);
+    emitter.POP(REG_64::R15);
+    emitter.POP(REG_64::RBP);
+    emitter.RET();
+}
+
+void IOP_JIT64::sync_cycles()
+{
+    if (!cycles_pending)
+        return;
+
+    //cycles_to_run -= cycles
+    //muldiv_delay = max(muldiv_delay - cycles, 0)
+    emitter.SUB32_MEM_IMM((uint32_t)cycles_pending, REG_64::R15, offsets.cycles_to_run);
+    emitter.XOR32_REG(REG_64::RCX, REG_64::RCX);
+    emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX, offsets.muldiv_delay);
+    emitter.ADD32_REG_IMM((uint32_t)-cycles_pending, REG_64::RAX);
+    emitter.CMOVCC32_REG(ConditionCode::L, REG_64::RCX, REG_64::RAX);
+    emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, offsets.muldiv_delay);
+    cycles_pending = 0;
+}
+
+void IOP_JIT64::call_interpreter(IR::Instruction &instr)
+{
+    //The interpreter expects PC to point to the instruction being executed
+    emitter.MOV32_IMM_MEM(instr.get_return_addr(), REG_64::R15, offsets.PC);
+#ifdef _WIN32
+    emitter.MOV64_MR(REG_64::R15, REG_64::RCX);
+    emitter.MOV32_REG_IMM(instr.get_opcode(), REG_64::RDX);
+#else
+    emitter.MOV64_MR(REG_64::R15, REG_64::RDI);
+    emitter.MOV32_REG_IMM(instr.get_opcode(), REG_64::RSI);
+#endif
+    emitter.load_addr((uint64_t)&IOP_Interpreter::interpret, REG_64::RAX);
+    emitter.CALL_INDIR(REG_64::RAX);
+}
+
+void IOP_JIT64::load_const(IR::Instruction &instr)
+{
+    emitter.MOV32_IMM_MEM((uint32_t)instr.get_source(), REG_64::R15, GPR_OFFSET(instr.get_dest()));
+}
+
+void IOP_JIT64::move_word_reg(IR::Instruction &instr)
+{
+    emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX, GPR_OFFSET(instr.get_source()));
+    emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, GPR_OFFSET(instr.get_dest()));
+}
+
+void IOP_JIT64::add_word_imm(IR::Instruction &instr)
+{
+    emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX, GPR_OFFSET(instr.get_source()));
+    emitter.ADD32_REG_IMM((uint32_t)instr.get_source2(), REG_64::RAX);
+    emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, GPR_OFFSET(instr.get_dest()));
+}
+
+void IOP_JIT64::and_imm(IR::Instruction &instr)
+{
+    emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX, GPR_OFFSET(instr.get_source()));
+    emitter.AND32_REG_IMM((uint32_t)instr.get_source2(), REG_64::RAX);
+    emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, GPR_OFFSET(instr.get_dest()));
+}
+
+void IOP_JIT64::or_imm(IR::Instruction &instr)
+{
+    emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX, GPR_OFFSET(instr.get_source()));
+    emitter.OR32_REG_IMM((uint32_t)instr.get_source2(), REG_64::RAX);
+    emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, GPR_OFFSET(instr.get_dest()));
+}
+
+void IOP_JIT64::xor_imm(IR::Instruction &instr)
+{
+    emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX, GPR_OFFSET(instr.get_source()));
+    emitter.MOV32_REG_IMM((uint32_t)instr.get_source2(), REG_64::RCX);
+    emitter.XOR32_REG(REG_64::RCX, REG_64::RAX);
+    emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, GPR_OFFSET(instr.get_dest()));
+}
+
+void IOP_JIT64::set_on_less_than_imm(IR::Instruction &instr, ConditionCode cc)
+{
+    emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX, GPR_OFFSET(instr.get_source()));
+    emitter.CMP32_IMM((uint32_t)instr.get_source2(), REG_64::RAX);
+    emitter.SETCC_REG(cc, REG_64::RAX);
+    emitter.MOVZX8_TO_32(REG_64::RAX, REG_64::RAX);
+    emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, GPR_OFFSET(instr.get_dest()));
+}
+
+void IOP_JIT64::alu_reg(IR::Instruction &instr)
+{
+    emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX, GPR_OFFSET(instr.get_source()));
+    emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RCX, GPR_OFFSET(instr.get_source2()));
+    switch (instr.op)
+    {
+        case IR::Opcode::AddWordReg:
+            emitter.ADD32_REG(REG_64::RCX, REG_64::RAX);
+            break;
+        case IR::Opcode::SubWordReg:
+            emitter.SUB32_REG(REG_64::RCX, REG_64::RAX);
+            break;
+        case IR::Opcode::AndReg:
+            emitter.AND32_REG(REG_64::RCX, REG_64::RAX);
+            break;
+        case IR::Opcode::OrReg:
+            emitter.OR32_REG(REG_64::RCX, REG_64::RAX);
+            break;
+        case IR::Opcode::XorReg:
+            emitter.XOR32_REG(REG_64::RCX, REG_64::RAX);
+            break;
+        case IR::Opcode::NorReg:
+            emitter.OR32_REG(REG_64::RCX, REG_64::RAX);
+            emitter.NOT32(REG_64::RAX);
+            break;
+        default:
+            Errors::die("[IOP_JIT64] Unknown ALU operation %d", instr.op);
+    }
+    emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, GPR_OFFSET(instr.get_dest()));
+}
+
+void IOP_JIT64::set_on_less_than(IR::Instruction &instr, ConditionCode cc)
+{
+    emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX, GPR_OFFSET(instr.get_source()));
+    emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RCX, GPR_OFFSET(instr.get_source2()));
+    emitter.CMP32_REG(REG_64::RCX, REG_64::RAX);
+    emitter.SETCC_REG(cc, REG_64::RAX);
+    emitter.MOVZX8_TO_32(REG_64::RAX, REG_64::RAX);
+    emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, GPR_OFFSET(instr.get_dest()));
+}
+
+void IOP_JIT64::shift_imm(IR::Instruction &instr)
+{
+    uint8_t shift = (uint8_t)instr.get_source2();
+    emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX, GPR_OFFSET(instr.get_source()));
+    switch (instr.op)
+    {
+        case IR::Opcode::ShiftLeftLogical:
+            emitter.SHL32_REG_IMM(shift, REG_64::RAX);
+            break;
+        case IR::Opcode::ShiftRightLogical:
+            emitter.SHR32_REG_IMM(shift, REG_64::RAX);
+            break;
+        default:
+            emitter.SAR32_REG_IMM(shift, REG_64::RAX);
+            break;
+    }
+    emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, GPR_OFFSET(instr.get_dest()));
+}
+
+void IOP_JIT64::shift_variable(IR::Instruction &instr)
+{
+    //x86 masks the shift amount to 5 bits, just like MIPS
+    emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX, GPR_OFFSET(instr.get_source()));
+    emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RCX, GPR_OFFSET(instr.get_source2()));
+    switch (instr.op)
+    {
+        case IR::Opcode::ShiftLeftLogicalVariable:
+            emitter.SHL32_CL(REG_64::RAX);
+            break;
+        case IR::Opcode::ShiftRightLogicalVariable:
+            emitter.SHR32_CL(REG_64::RAX);
+            break;
+        default:
+            emitter.SAR32_CL(REG_64::RAX);
+            break;
+    }
+    emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, GPR_OFFSET(instr.get_dest()));
+}
+
+void IOP_JIT64::branch(IR::Instruction &instr, ConditionCode skip_cc)
+{
+    emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX, GPR_OFFSET(instr.get_source()));
+    if (instr.op == IR::Opcode::BranchEqual || instr.op == IR::Opcode::BranchNotEqual)
+    {
+        emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RCX, GPR_OFFSET(instr.get_source2()));
+        emitter.CMP32_REG(REG_64::RCX, REG_64::RAX);
+    }
+    else
+        emitter.CMP32_IMM(0, REG_64::RAX);
+    uint8_t* not_taken = emitter.JCC_NEAR_DEFERRED(skip_cc);
+
+    //Same state the interpreter is in while executing the delay slot of a taken branch
+    emitter.MOV32_IMM_MEM(instr.get_jump_dest(), REG_64::R15, offsets.new_PC);
+    emitter.MOV8_IMM_MEM(true, REG_64::R15, offsets.will_branch);
+    emitter.MOV32_IMM_MEM(0, REG_64::R15, offsets.branch_delay);
+
+    emitter.set_jump_dest(not_taken);
+}
+
+void IOP_JIT64::fallback_interpreter(IR::Instruction &instr)
+{
+    call_interpreter(instr);
+}
+
+void IOP_JIT64::fallback_muldiv(IR::Instruction &instr)
+{
+    //The mult/div delay is decremented every cycle, so it has to be up to date before it's read or restarted
+    sync_cycles();
+    call_interpreter(instr);
+}
+
+void IOP_JIT64::fallback_jump(IR::Instruction &instr)
+{
+    call_interpreter(instr);
+
+    //The interpreter loop decrements branch_delay after the jump itself, so do the same here
+    emitter.MOV32_IMM_MEM(0, REG_64::R15, offsets.branch_delay);
+}
+
+void IOP_JIT64::system_call(IR::Instruction &instr)
+{
+    //The exception handler sets PC to the vector minus 4, to offset PC being incremented afterwards
+    call_interpreter(instr);
+    emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX, offsets.PC);
+    emitter.ADD32_REG_IMM(4, REG_64::RAX);
+    emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, offsets.PC);
+    emit_epilogue();
+}
+
+void IOP_JIT64::save_pc(IR::Instruction &instr)
+{
+    emitter.MOV32_IMM_MEM(instr.get_jump_dest(), REG_64::R15, offsets.PC);
+    emit_epilogue();
+}
+
+void IOP_JIT64::move_delayed_branch(IR::Instruction &instr)
+{
+    //if (will_branch) { PC = new_PC; will_branch = false; } else PC = jump_fail_dest;
+    emitter.MOV32_REG_IMM(instr.get_jump_fail_dest(), REG_64::RAX);
+    emitter.CMP8_IMM_MEM(0, REG_64::R15, offsets.will_branch);
+    uint8_t* not_taken = emitter.JCC_NEAR_DEFERRED(ConditionCode::E);
+
+    emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX, offsets.new_PC);
+    emitter.MOV8_IMM_MEM(false, REG_64::R15, offsets.will_branch);
+
+    emitter.set_jump_dest(not_taken);
+    emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, offsets.PC);
+    emit_epilogue();
+}
@@ -0,0 +1,97 @@
+#ifndef IOP_JIT64_HPP
+#define IOP_JIT64_HPP
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+#include "../jitcommon/emitter64.hpp"
+#include "../jitcommon/ir_block.hpp"
+#include "../jitcommon/jitcache.hpp"
+#include "iop_jittrans.hpp"
+
+class IOP;
+
+typedef void (*IOPJitBlockFunc)(IOP& iop);
+
+//Part of IOP RAM translated into a block
+struct IOPCodeRange
+{
+    uint64_t key;
+    uint32_t start, end;
+};
+
+//Where the IOP's registers are relative to R15. The IOP isn't standard-layout, which offsetof is only
+//conditionally supported on, so they're measured on the IOP itself
+struct IOPOffsets
+{
+    uint32_t gpr, PC, new_PC, will_branch, branch_delay, cycles_to_run, muldiv_delay;
+};
+
+struct IOPLookupEntry
+{
+    IOPJitBlockRecord* block;
+    uint32_t end_PC;
+};
+
+class IOP_JIT64
+{
+    private:
+        constexpr static uint32_t RAM_SIZE = 1024 * 1024 * 2;
+        constexpr static int REGION_SHIFT = 8;
+        constexpr static int LOOKUP_CACHE_SIZE = 1024 * 16;
+
+        JitBlock jit_block;
+        IOPJitHeap jit_heap;
+        Emitter64 emitter;
+        IOP_JitTranslator ir;
+
+        //Direct-mapped on PC, checked before the block map
+        IOPLookupEntry lookup_cache[LOOKUP_CACHE_SIZE];
+
+        //Address after the last instruction of each block, for spotting loops
+        std::unordered_map<uint64_t, uint32_t> block_ends;
+
+        //Every block compiled from IOP RAM is listed under each 256-byte region it covers,
+        //so that a write only has to look at the blocks around it.
+        std::vector<IOPCodeRange> code_regions[RAM_SIZE >> REGION_SHIFT];
+
+        IOPOffsets offsets;
+
+        //Cycles of already emitted instructions not yet subtracted from cycles_to_run
+        int cycles_pending;
+
+        IOPJitBlockRecord* recompile_block(IOP& iop, uint64_t key);
+        void flush_all_blocks();
+        void erase_block(IOPCodeRange range);
+
+        void emit_instruction(IOP& iop, IR::Instruction& instr);
+        void emit_epilogue();
+        void sync_cycles();
+        void call_interpreter(IR::Instruction& instr);
+
+        void load_const(IR::Instruction& instr);
+        void move_word_reg(IR::Instruction& instr);
+        void add_word_imm(IR::Instruction& instr);
+        void and_imm(IR::Instruction& instr);
+        void or_imm(IR::Instruction& instr);
+        void xor_imm(IR::Instruction& instr);
+        void set_on_less_than_imm(IR::Instruction& instr, ConditionCode cc);
+        void alu_reg(IR::Instruction& instr);
+        void set_on_less_than(IR::Instruction& instr, ConditionCode cc);
+        void shift_imm(IR::Instruction& instr);
+        void shift_variable(IR::Instruction& instr);
+        void branch(IR::Instruction& instr, ConditionCode skip_cc);
+        void fallback_interpreter(IR::Instruction& instr);
+        void fallback_muldiv(IR::Instruction& instr);
+        void fallback_jump(IR::Instruction& instr);
+        void system_call(IR::Instruction& instr);
+        void save_pc(IR::Instruction& instr);
+        void move_delayed_branch(IR::Instruction& instr);
+    public:
+        IOP_JIT64();
+
+        void run(IOP& iop);
+        void reset(IOP& iop);
+        void invalidate(uint32_t addr, uint32_t size);
+};
+
+#endif // IOP_JIT64_HPP
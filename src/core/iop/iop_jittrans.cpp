@@ -0,0 +1,458 @@
+#include "iop_jittrans.hpp"
+#include "iop.hpp"
+
+/**
+ * The IOP translator emits one IR instruction per MIPS instruction, so that the recompiler can keep track of
+ * the cycles taken by each. Only simple ALU operations and conditional branches are translated into native
+ * operations; everything else (memory accesses, mult/div, COP0, jumps) calls into the IOP interpreter.
+ * Those keep their own IR opcode when the recompiler has to do more around the call, like finishing a jump.
+ *
+ * A block ends after a branch and its delay slot, after a syscall, or when it reaches MAX_BLOCK_INSTRS.
+ * The last IR instruction of every block tells the recompiler how to update PC:
+ * SavePC - PC is set to jump_dest
+ * MoveDelayedBranch - PC is set to the pending branch target if a branch was taken, or to jump_fail_dest otherwise
+ * SystemCall - PC has been set by the exception handler
+ */
+IR::Block IOP_JitTranslator::translate(IOP &iop, uint32_t PC, bool uncached, uint32_t& end_PC)
+{
+    IR::Block block;
+    std::vector<IR::Instruction> instrs;
+    int cycle_count = 0;
+    bool block_end = false;
+
+    //Each instruction costs a cycle, plus the waitstate for fetching it from uncached memory
+    instr_cycles = uncached ? 5 : 1;
+
+    uint32_t cur_PC = PC;
+    for (int i = 0; i < MAX_BLOCK_INSTRS && !block_end; i++)
+    {
+        uint32_t opcode = iop.read32(cur_PC);
+        translate_op(opcode, cur_PC, instrs);
+        cycle_count += instr_cycles;
+        cur_PC += 4;
+
+        if (is_branch(opcode))
+        {
+            uint32_t delay_opcode = iop.read32(cur_PC);
+
+            //A branch in a delay slot depends on whether the first branch was taken.
+            //Leave the delay slot to the interpreter in that case.
+            if (is_branch(delay_opcode))
+            {
+                IR::Instruction instr(IR::Opcode::SavePC);
+                instr.set_jump_dest(cur_PC);
+                instrs.push_back(instr);
+                block_end = true;
+                break;
+            }
+
+            translate_op(delay_opcode, cur_PC, instrs);
+            cycle_count += instr_cycles;
+            cur_PC += 4;
+
+            if (!ends_block(delay_opcode))
+            {
+                IR::Instruction instr(IR::Opcode::MoveDelayedBranch);
+                instr.set_jump_fail_dest(cur_PC);
+                instrs.push_back(instr);
+            }
+            block_end = true;
+        }
+        else if (ends_block(opcode))
+            block_end = true;
+    }
+
+    if (!block_end)
+    {
+        IR::Instruction instr(IR::Opcode::SavePC);
+        instr.set_jump_dest(cur_PC);
+        instrs.push_back(instr);
+    }
+
+    for (auto it = instrs.begin(); it != instrs.end(); ++it)
+        block.add_instr(*it);
+    block.set_cycle_count(cycle_count);
+
+    end_PC = cur_PC;
+    return block;
+}
+
+bool IOP_JitTranslator::is_branch(uint32_t opcode) const
+{
+    switch (opcode >> 26)
+    {
+        case 0x00:
+            //JR, JALR
+            return (opcode & 0x3E) == 0x08;
+        case 0x01:
+        case 0x02:
+        case 0x03:
+        case 0x04:
+        case 0x05:
+        case 0x06:
+        case 0x07:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool IOP_JitTranslator::ends_block(uint32_t opcode) const
+{
+    //SYSCALL jumps to the exception vector
+    return (opcode >> 26) == 0x00 && (opcode & 0x3F) == 0x0C;
+}
+
+void IOP_JitTranslator::translate_op(uint32_t opcode, uint32_t PC, std::vector<IR::Instruction>& instrs) const
+{
+    IR::Instruction instr(IR::Opcode::Nop);
+    instr.set_cycle_count(instr_cycles);
+
+    if (!opcode)
+    {
+        instrs.push_back(instr);
+        return;
+    }
+
+    uint8_t op = opcode >> 26;
+    uint8_t dest = (opcode >> 16) & 0x1F;
+    uint8_t source = (opcode >> 21) & 0x1F;
+    switch (op)
+    {
+        case 0x00:
+            translate_op_special(opcode, PC, instrs);
+            return;
+        case 0x01:
+            translate_op_regimm(opcode, PC, instrs);
+            return;
+        case 0x02:
+            // J
+            fallback_interpreter(instr, opcode, PC);
+            instr.op = IR::Opcode::Jump;
+            break;
+        case 0x03:
+            // JAL
+            fallback_interpreter(instr, opcode, PC);
+            instr.op = IR::Opcode::JumpAndLink;
+            break;
+        case 0x04:
+            // BEQ
+        case 0x05:
+            // BNE
+        case 0x06:
+            // BLEZ
+        case 0x07:
+            // BGTZ
+        {
+            static const IR::Opcode branch_ops[4] =
+            {
+                IR::Opcode::BranchEqual, IR::Opcode::BranchNotEqual,
+                IR::Opcode::BranchLessThanOrEqualZero, IR::Opcode::BranchGreaterThanZero
+            };
+            int32_t offset = ((int16_t)(opcode & 0xFFFF)) << 2;
+            instr.op = branch_ops[op - 0x04];
+            instr.set_source(source);
+            instr.set_source2(dest);
+            instr.set_jump_dest(PC + offset + 4);
+            instr.set_jump_fail_dest(PC + 8);
+            break;
+        }
+        case 0x08:
+            // ADDI
+        case 0x09:
+            // ADDIU
+            //The IOP interpreter doesn't raise overflow exceptions, so ADDI is the same as ADDIU
+            if (!dest)
+                break;
+            if (!source)
+            {
+                instr.op = IR::Opcode::LoadConst;
+                instr.set_dest(dest);
+                instr.set_source((uint32_t)(int32_t)(int16_t)(opcode & 0xFFFF));
+                break;
+            }
+            instr.op = IR::Opcode::AddWordImm;
+            instr.set_dest(dest);
+            instr.set_source(source);
+            instr.set_source2((uint32_t)(int32_t)(int16_t)(opcode & 0xFFFF));
+            break;
+        case 0x0A:
+            // SLTI
+            if (!dest)
+                break;
+            instr.op = IR::Opcode::SetOnLessThanImmediate;
+            instr.set_dest(dest);
+            instr.set_source(source);
+            instr.set_source2((uint32_t)(int32_t)(int16_t)(opcode & 0xFFFF));
+            break;
+        case 0x0B:
+            // SLTIU
+            if (!dest)
+                break;
+            instr.op = IR::Opcode::SetOnLessThanImmediateUnsigned;
+            instr.set_dest(dest);
+            instr.set_source(source);
+            instr.set_source2((uint32_t)(int32_t)(int16_t)(opcode & 0xFFFF));
+            break;
+        case 0x0C:
+            // ANDI
+            if (!dest)
+                break;
+            instr.op = IR::Opcode::AndImm;
+            instr.set_dest(dest);
+            instr.set_source(source);
+            instr.set_source2(opcode & 0xFFFF);
+            break;
+        case 0x0D:
+            // ORI
+            if (!dest)
+                break;
+            if (!source)
+            {
+                instr.op = IR::Opcode::LoadConst;
+                instr.set_dest(dest);
+                instr.set_source(opcode & 0xFFFF);
+                break;
+            }
+            instr.op = IR::Opcode::OrImm;
+            instr.set_dest(dest);
+            instr.set_source(source);
+            instr.set_source2(opcode & 0xFFFF);
+            break;
+        case 0x0E:
+            // XORI
+            if (!dest)
+                break;
+            instr.op = IR::Opcode::XorImm;
+            instr.set_dest(dest);
+            instr.set_source(source);
+            instr.set_source2(opcode & 0xFFFF);
+            break;
+        case 0x0F:
+            // LUI
+            if (!dest)
+                break;
+            instr.op = IR::Opcode::LoadConst;
+            instr.set_dest(dest);
+            instr.set_source((opcode & 0xFFFF) << 16);
+            break;
+        default:
+            //Loads, stores, and coprocessor instructions
+            fallback_interpreter(instr, opcode, PC);
+            break;
+    }
+    instrs.push_back(instr);
+}
+
+void IOP_JitTranslator::translate_op_special(uint32_t opcode, uint32_t PC, std::vector<IR::Instruction>& instrs) const
+{
+    IR::Instruction instr(IR::Opcode::Nop);
+    instr.set_cycle_count(instr_cycles);
+
+    uint8_t op = opcode & 0x3F;
+    uint8_t dest = (opcode >> 11) & 0x1F;
+    uint8_t source = (opcode >> 21) & 0x1F;
+    uint8_t source2 = (opcode >> 16) & 0x1F;
+    switch (op)
+    {
+        case 0x00:
+            // SLL
+        case 0x02:
+            // SRL
+        case 0x03:
+            // SRA
+        {
+            static const IR::Opcode shift_ops[4] =
+            {
+                IR::Opcode::ShiftLeftLogical, IR::Opcode::Null,
+                IR::Opcode::ShiftRightLogical, IR::Opcode::ShiftRightArithmetic
+            };
+            if (!dest)
+                break;
+            instr.op = shift_ops[op];
+            instr.set_dest(dest);
+            instr.set_source(source2);
+            instr.set_source2((opcode >> 6) & 0x1F);
+            break;
+        }
+        case 0x04:
+            // SLLV
+        case 0x06:
+            // SRLV
+        case 0x07:
+            // SRAV
+        {
+            static const IR::Opcode shift_ops[4] =
+            {
+                IR::Opcode::ShiftLeftLogicalVariable, IR::Opcode::Null,
+                IR::Opcode::ShiftRightLogicalVariable, IR::Opcode::ShiftRightArithmeticVariable
+            };
+            if (!dest)
+                break;
+            instr.op = shift_ops[op - 0x04];
+            instr.set_dest(dest);
+            instr.set_source(source2);
+            instr.set_source2(source);
+            break;
+        }
+        case 0x08:
+            // JR
+            fallback_interpreter(instr, opcode, PC);
+            instr.op = IR::Opcode::JumpIndirect;
+            break;
+        case 0x09:
+            // JALR
+            fallback_interpreter(instr, opcode, PC);
+            instr.op = IR::Opcode::JumpAndLinkIndirect;
+            break;
+        case 0x0C:
+            // SYSCALL
+            fallback_interpreter(instr, opcode, PC);
+            instr.op = IR::Opcode::SystemCall;
+            break;
+        case 0x10:
+            // MFHI
+            fallback_interpreter(instr, opcode, PC);
+            instr.op = IR::Opcode::MoveFromHI;
+            break;
+        case 0x12:
+            // MFLO
+            fallback_interpreter(instr, opcode, PC);
+            instr.op = IR::Opcode::MoveFromLO;
+            break;
+        case 0x18:
+            // MULT
+            fallback_interpreter(instr, opcode, PC);
+            instr.op = IR::Opcode::MultiplyWord;
+            break;
+        case 0x19:
+            // MULTU
+            fallback_interpreter(instr, opcode, PC);
+            instr.op = IR::Opcode::MultiplyUnsignedWord;
+            break;
+        case 0x1A:
+            // DIV
+            fallback_interpreter(instr, opcode, PC);
+            instr.op = IR::Opcode::DivideWord;
+            break;
+        case 0x1B:
+            // DIVU
+            fallback_interpreter(instr, opcode, PC);
+            instr.op = IR::Opcode::DivideUnsignedWord;
+            break;
+        case 0x20:
+            // ADD
+        case 0x21:
+            // ADDU
+            if (!dest)
+                break;
+            if (!source || !source2)
+            {
+                instr.op = IR::Opcode::MoveWordReg;
+                instr.set_dest(dest);
+                instr.set_source(source ? source : source2);
+                break;
+            }
+            instr.op = IR::Opcode::AddWordReg;
+            instr.set_dest(dest);
+            instr.set_source(source);
+            instr.set_source2(source2);
+            break;
+        case 0x22:
+            // SUB
+        case 0x23:
+            // SUBU
+            if (!dest)
+                break;
+            instr.op = IR::Opcode::SubWordReg;
+            instr.set_dest(dest);
+            instr.set_source(source);
+            instr.set_source2(source2);
+            break;
+        case 0x24:
+            // AND
+            if (!dest)
+                break;
+            instr.op = IR::Opcode::AndReg;
+            instr.set_dest(dest);
+            instr.set_source(source);
+            instr.set_source2(source2);
+            break;
+        case 0x25:
+            // OR
+            if (!dest)
+                break;
+            if (!source || !source2)
+            {
+                instr.op = IR::Opcode::MoveWordReg;
+                instr.set_dest(dest);
+                instr.set_source(source ? source : source2);
+                break;
+            }
+            instr.op = IR::Opcode::OrReg;
+            instr.set_dest(dest);
+            instr.set_source(source);
+            instr.set_source2(source2);
+            break;
+        case 0x26:
+            // XOR
+            if (!dest)
+                break;
+            instr.op = IR::Opcode::XorReg;
+            instr.set_dest(dest);
+            instr.set_source(source);
+            instr.set_source2(source2);
+            break;
+        case 0x27:
+            // NOR
+            if (!dest)
+                break;
+            instr.op = IR::Opcode::NorReg;
+            instr.set_dest(dest);
+            instr.set_source(source);
+            instr.set_source2(source2);
+            break;
+        case 0x2A:
+            // SLT
+            if (!dest)
+                break;
+            instr.op = IR::Opcode::SetOnLessThan;
+            instr.set_dest(dest);
+            instr.set_source(source);
+            instr.set_source2(source2);
+            break;
+        case 0x2B:
+            // SLTU
+            if (!dest)
+                break;
+            instr.op = IR::Opcode::SetOnLessThanUnsigned;
+            instr.set_dest(dest);
+            instr.set_source(source);
+            instr.set_source2(source2);
+            break;
+        default:
+            //MTHI, MTLO, and anything the interpreter doesn't know about
+            fallback_interpreter(instr, opcode, PC);
+            break;
+    }
+    instrs.push_back(instr);
+}
+
+void IOP_JitTranslator::translate_op_regimm(uint32_t opcode, uint32_t PC, std::vector<IR::Instruction>& instrs) const
+{
+    IR::Instruction instr;
+    instr.set_cycle_count(instr_cycles);
+
+    //BLTZ, BGEZ, BLTZAL, BGEZAL
+    fallback_interpreter(instr, opcode, PC);
+    instr.op = (opcode & (1 << 16)) ? IR::Opcode::BranchGreaterThanOrEqualZero : IR::Opcode::BranchLessThanZero;
+    instr.set_is_link(opcode & (1 << 20));
+    instrs.push_back(instr);
+}
+
+void IOP_JitTranslator::fallback_interpreter(IR::Instruction& instr, uint32_t opcode, uint32_t PC) const
+{
+    instr.op = IR::Opcode::FallbackInterpreter;
+    instr.set_opcode(opcode);
+    instr.set_return_addr(PC);
+}
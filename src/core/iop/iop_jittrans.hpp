@@ -0,0 +1,28 @@
+#ifndef IOP_JITTRANS_HPP
+#define IOP_JITTRANS_HPP
+#include <cstdint>
+#include <vector>
+#include "../jitcommon/ir_block.hpp"
+
+class IOP;
+
+class IOP_JitTranslator
+{
+    private:
+        //Longest run of instructions translated into a single block
+        constexpr static int MAX_BLOCK_INSTRS = 64;
+
+        int instr_cycles;
+
+        bool is_branch(uint32_t opcode) const;
+        bool ends_block(uint32_t opcode) const;
+
+        void translate_op(uint32_t opcode, uint32_t PC, std::vector<IR::Instruction>& instrs) const;
+        void translate_op_special(uint32_t opcode, uint32_t PC, std::vector<IR::Instruction>& instrs) const;
+        void translate_op_regimm(uint32_t opcode, uint32_t PC, std::vector<IR::Instruction>& instrs) const;
+        void fallback_interpreter(IR::Instruction& instr, uint32_t opcode, uint32_t PC) const;
+    public:
+        IR::Block translate(IOP& iop, uint32_t PC, bool uncached, uint32_t& end_PC);
+};
+
+#endif // IOP_JITTRANS_HPP
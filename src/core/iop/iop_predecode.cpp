@@ -0,0 +1,156 @@
+#include <algorithm>
+#include "iop_predecode.hpp"
+
+IOP_DecodedCache::Page* IOP_DecodedCache::get_page(uint32_t addr, bool create)
+{
+    std::unique_ptr<Page>* page;
+    if (addr < (RAM_PAGES << PAGE_SHIFT))
+        page = &ram_pages[addr >> PAGE_SHIFT];
+    else if (addr >= BIOS_START && addr < BIOS_START + (BIOS_PAGES << PAGE_SHIFT))
+        page = &bios_pages[(addr - BIOS_START) >> PAGE_SHIFT];
+    else
+        return nullptr;
+
+    if (!*page && create)
+        *page = std::make_unique<Page>();
+    return page->get();
+}
+
+IOP_DecodedBlock* IOP_DecodedCache::decode_block(IOP &cpu, Page &page, uint32_t addr)
+{
+    using namespace IOP_Interpreter;
+
+    std::unique_ptr<IOP_DecodedBlock> block = std::make_unique<IOP_DecodedBlock>();
+    block->start = addr;
+    block->valid = true;
+
+    uint32_t page_end = (addr | ((1 << PAGE_SHIFT) - 1)) + 1;
+    bool delay_slot = false;
+    while (addr < page_end)
+    {
+        uint32_t instr = cpu.read32(addr);
+        Handler func = decode(instr);
+        block->ops.push_back({func, instr});
+
+        int word = (addr >> 2) & (PAGE_WORDS - 1);
+        page.code_words[word / 32] |= 1u << (word & 31);
+        addr += 4;
+
+        if (delay_slot)
+            break;
+
+        //Syscalls jump straight to the exception vector, unknown ops are most likely data
+        if (func == &syscall || func == &interpret)
+            break;
+
+        if (func == &j || func == &jal || func == &jr || func == &jalr ||
+            func == &beq || func == &bne || func == &blez || func == &bgtz ||
+            func == &bltz || func == &bgez || func == &bltzal || func == &bgezal)
+            delay_slot = true;
+    }
+
+    IOP_DecodedBlock* result = block.get();
+    page.blocks.push_back(std::move(block));
+    return result;
+}
+
+IOP_DecodedBlock* IOP_DecodedCache::get_block(IOP &cpu, uint32_t PC)
+{
+    //Nothing can be running when a new block is looked up
+    retired.clear();
+
+    uint32_t addr = PC & 0x1FFFFFFF;
+    Page* page = get_page(addr, true);
+    if (!page)
+        return nullptr;
+
+    IOP_DecodedBlock*& block = page->entry[(addr >> 2) & (PAGE_WORDS - 1)];
+    if (!block)
+        block = decode_block(cpu, *page, addr);
+    return block;
+}
+
+void IOP_DecodedCache::invalidate_page(Page &page, uint32_t start, uint32_t end)
+{
+    int first_word = (start >> 2) & (PAGE_WORDS - 1);
+    int last_word = ((end - 1) >> 2) & (PAGE_WORDS - 1);
+
+    bool hit = false;
+    for (int i = first_word; i <= last_word && !hit; i++)
+        hit = page.code_words[i / 32] & (1u << (i & 31));
+
+    if (!hit)
+        return;
+
+    auto overlaps = [=](const std::unique_ptr<IOP_DecodedBlock>& block)
+    {
+        uint32_t block_end = block->start + block->ops.size() * 4;
+        return block->start < end && block_end > start;
+    };
+
+    for (std::unique_ptr<IOP_DecodedBlock>& block : page.blocks)
+    {
+        if (overlaps(block))
+        {
+            block->valid = false;
+            page.entry[(block->start >> 2) & (PAGE_WORDS - 1)] = nullptr;
+            retired.push_back(std::move(block));
+        }
+    }
+    page.blocks.erase(std::remove(page.blocks.begin(), page.blocks.end(), nullptr), page.blocks.end());
+
+    //Blocks may overlap each other, so the remaining ones have to mark their words again
+    std::fill(std::begin(page.code_words), std::end(page.code_words), 0);
+    for (std::unique_ptr<IOP_DecodedBlock>& block : page.blocks)
+    {
+        int word = (block->start >> 2) & (PAGE_WORDS - 1);
+        for (size_t i = 0; i < block->ops.size(); i++, word++)
+            page.code_words[word / 32] |= 1u << (word & 31);
+    }
+}
+
+//Only RAM is writable, so addr is an offset into IOP RAM
+void IOP_DecodedCache::invalidate(uint32_t addr, uint32_t size)
+{
+    const uint32_t page_size = 1 << PAGE_SHIFT;
+    uint32_t end = std::min(addr + size, (uint32_t)(RAM_PAGES << PAGE_SHIFT));
+    for (uint32_t page_start = addr & ~(page_size - 1); page_start < end; page_start += page_size)
+    {
+        Page* page = get_page(page_start, false);
+        if (!page || page->blocks.empty())
+            continue;
+
+        invalidate_page(*page, std::max(addr, page_start), std::min(end, page_start + page_size));
+    }
+}
+
+void IOP_DecodedCache::reset()
+{
+    for (std::unique_ptr<Page>& page : ram_pages)
+        page.reset();
+    for (std::unique_ptr<Page>& page : bios_pages)
+        page.reset();
+    retired.clear();
+}
+
+namespace IOP_Predecode
+{
+
+IOP_DecodedCache cache;
+
+IOP_DecodedBlock* get_block(IOP& cpu, uint32_t PC)
+{
+    return cache.get_block(cpu, PC);
+}
+
+void reset()
+{
+    cache.reset();
+}
+
+void invalidate(uint32_t addr, uint32_t size)
+{
+    cache.invalidate(addr, size);
+}
+
+};
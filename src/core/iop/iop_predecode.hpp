@@ -0,0 +1,66 @@
+#ifndef IOP_PREDECODE_HPP
+#define IOP_PREDECODE_HPP
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "iop_interpreter.hpp"
+
+struct IOP_DecodedOp
+{
+    IOP_Interpreter::Handler func;
+    uint32_t instruction;
+};
+
+//A straight run of decoded instructions, ending after a branch's delay slot or at a page boundary.
+//valid is cleared when the code underneath is overwritten, which may happen while the block is running.
+struct IOP_DecodedBlock
+{
+    uint32_t start;
+    bool valid;
+    std::vector<IOP_DecodedOp> ops;
+};
+
+//Decoded IOP code, keyed by physical address. Only RAM and the BIOS are cached.
+class IOP_DecodedCache
+{
+    private:
+        constexpr static int PAGE_SHIFT = 12;
+        constexpr static int PAGE_WORDS = (1 << PAGE_SHIFT) / 4;
+        constexpr static int RAM_PAGES = (1024 * 1024 * 2) >> PAGE_SHIFT;
+        constexpr static int BIOS_PAGES = (1024 * 1024 * 4) >> PAGE_SHIFT;
+        constexpr static uint32_t BIOS_START = 0x1FC00000;
+
+        struct Page
+        {
+            IOP_DecodedBlock* entry[PAGE_WORDS];
+
+            //One bit per word covered by a block, so data writes next to code stay cheap
+            uint32_t code_words[PAGE_WORDS / 32];
+            std::vector<std::unique_ptr<IOP_DecodedBlock>> blocks;
+        };
+
+        std::unique_ptr<Page> ram_pages[RAM_PAGES];
+        std::unique_ptr<Page> bios_pages[BIOS_PAGES];
+
+        //Invalidated blocks are kept alive until no block can be running
+        std::vector<std::unique_ptr<IOP_DecodedBlock>> retired;
+
+        Page* get_page(uint32_t addr, bool create);
+        IOP_DecodedBlock* decode_block(IOP& cpu, Page& page, uint32_t addr);
+        void invalidate_page(Page& page, uint32_t start, uint32_t end);
+    public:
+        IOP_DecodedBlock* get_block(IOP& cpu, uint32_t PC);
+        void invalidate(uint32_t addr, uint32_t size);
+        void reset();
+};
+
+namespace IOP_Predecode
+{
+
+IOP_DecodedBlock* get_block(IOP& cpu, uint32_t PC);
+void reset();
+void invalidate(uint32_t addr, uint32_t size);
+
+};
+
+#endif // IOP_PREDECODE_HPP
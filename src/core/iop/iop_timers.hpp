@@ -55,8 +55,8 @@ class IOPTiming
         void write_control(int index, uint16_t value);
         void write_target(int index, uint32_t value);
 
-        void load_state(std::ifstream& state);
-        void save_state(std::ofstream& state);
+        void load_state(std::istream& state);
+        void save_state(std::ostream& state);
 };
 
 #endif // IOP_TIMERS_HPP
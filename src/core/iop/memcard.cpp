@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 #include "../errors.hpp"
@@ -19,17 +20,20 @@ Memcard::Memcard()
 {
     mem = nullptr;
     file_opened = false;
+    is_dirty = false;
+    writer_exit = false;
 }
 
 Memcard::~Memcard()
 {
+    //Whatever the game wrote during the last frame still has to reach the file
+    save_if_dirty();
+    stop_writer();
     delete[] mem;
 }
 
 void Memcard::reset()
 {
-    is_dirty = false;
-
     start_transfer();
 
     //Initial value is needed for newer MCMANs to work
@@ -38,6 +42,9 @@ void Memcard::reset()
 
 bool Memcard::open(std::string file_name)
 {
+    save_if_dirty();
+    stop_writer();
+
     std::ifstream file(file_name, std::ios::binary);
 
     if (mem)
@@ -62,6 +69,19 @@ bool Memcard::open(std::string file_name)
         file.close();
 
         this->file_name = file_name;
+
+        page_dirty.assign(specs.page_count, false);
+        dirty_pages.clear();
+        is_dirty = false;
+
+        card_file.open(file_name, std::ios::in | std::ios::out | std::ios::binary);
+        if (card_file.is_open())
+        {
+            writer_exit = false;
+            writer = std::thread(&Memcard::writer_loop, this);
+        }
+        else
+            printf("[Memcard] %s can't be written, changes won't be saved\n", file_name.c_str());
     }
     else
     {
@@ -89,15 +109,103 @@ void Memcard::start_transfer()
     memset(response_buffer, 0, sizeof(response_buffer));
 }
 
+//Only copies the dirty pages, writing them out is left to the writer thread
 void Memcard::save_if_dirty()
 {
-    if (is_dirty && file_opened)
+    if (!is_dirty || !file_opened)
+        return;
+
+    if (writer.joinable())
     {
-        std::ofstream file(file_name, std::ios::binary);
-        file.write((char*)mem, 0x840000);
-        file.close();
-        is_dirty = false;
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        for (uint32_t page : dirty_pages)
+        {
+            pending_pages.push_back(page);
+            pending_data.insert(pending_data.end(), &mem[page * RAW_PAGE_SIZE], &mem[(page + 1) * RAW_PAGE_SIZE]);
+        }
+        writer_cv.notify_one();
+    }
+
+    for (uint32_t page : dirty_pages)
+        page_dirty[page] = false;
+    dirty_pages.clear();
+    is_dirty = false;
+}
+
+void Memcard::mark_dirty(uint32_t addr, uint32_t size)
+{
+    uint32_t end = std::min((addr + size + RAW_PAGE_SIZE - 1) / RAW_PAGE_SIZE, (uint32_t)page_dirty.size());
+    for (uint32_t page = addr / RAW_PAGE_SIZE; page < end; page++)
+    {
+        if (!page_dirty[page])
+        {
+            page_dirty[page] = true;
+            dirty_pages.push_back(page);
+        }
     }
+    is_dirty = true;
+}
+
+void Memcard::writer_loop()
+{
+    std::unique_lock<std::mutex> lock(writer_mutex);
+    while (true)
+    {
+        writer_cv.wait(lock, [this] { return writer_exit || !pending_pages.empty(); });
+
+        //Everything queued is written before the thread exits
+        if (pending_pages.empty())
+            break;
+
+        std::vector<uint32_t> pages;
+        std::vector<uint8_t> data;
+        pages.swap(pending_pages);
+        data.swap(pending_data);
+
+        lock.unlock();
+        write_pages(pages, data);
+        lock.lock();
+    }
+}
+
+void Memcard::write_pages(const std::vector<uint32_t> &pages, const std::vector<uint8_t> &data)
+{
+    //Pages are written in the order they were queued, so a page queued twice ends up with its newest copy.
+    //Runs of consecutive pages go out in one write.
+    size_t i = 0;
+    while (i < pages.size())
+    {
+        size_t run = 1;
+        while (i + run < pages.size() && pages[i + run] == pages[i] + run)
+            run++;
+
+        card_file.seekp((uint64_t)pages[i] * RAW_PAGE_SIZE);
+        card_file.write((const char*)&data[i * RAW_PAGE_SIZE], run * RAW_PAGE_SIZE);
+        i += run;
+    }
+    card_file.flush();
+
+    if (!card_file)
+    {
+        printf("[Memcard] Failed to write to %s\n", file_name.c_str());
+        card_file.clear();
+    }
+}
+
+void Memcard::stop_writer()
+{
+    if (writer.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex);
+            writer_exit = true;
+        }
+        writer_cv.notify_one();
+        writer.join();
+    }
+
+    if (card_file.is_open())
+        card_file.close();
 }
 
 uint8_t Memcard::write_serial(uint8_t data)
@@ -194,7 +302,7 @@ uint8_t Memcard::write_serial(uint8_t data)
                 cmd_length = 2;
                 response_end();
 
-                is_dirty = true;
+                mark_dirty(mem_addr, 528 * 16);
 
                 for (unsigned int i = 0; i < 528 * 16; i++)
                     mem[mem_addr + i] = 0xFF;
@@ -375,7 +483,7 @@ void Memcard::write_mem(uint8_t data)
     }
     else if (cmd_params - 1 < mem_write_size)
     {
-        is_dirty = true;
+        mark_dirty(mem_addr, 1);
         mem[mem_addr] = data;
         mem_addr++;
     }
@@ -1,7 +1,12 @@
 #ifndef MEMCARD_HPP
 #define MEMCARD_HPP
+#include <condition_variable>
 #include <cstdint>
+#include <fstream>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 struct MemcardSpecs
 {
@@ -13,6 +18,9 @@ struct MemcardSpecs
 class Memcard
 {
     private:
+        //Pages as stored in the file, including the ECC area
+        constexpr static uint32_t RAW_PAGE_SIZE = 0x200 + 16;
+
         MemcardSpecs specs;
         uint8_t* mem;
 
@@ -25,6 +33,24 @@ class Memcard
         bool file_opened;
         bool is_dirty;
 
+        //Pages written since the last save_if_dirty, only these go back to the file
+        std::vector<bool> page_dirty;
+        std::vector<uint32_t> dirty_pages;
+
+        //Copies of dirty pages waiting for the writer thread, which owns card_file
+        std::fstream card_file;
+        std::thread writer;
+        std::mutex writer_mutex;
+        std::condition_variable writer_cv;
+        std::vector<uint32_t> pending_pages;
+        std::vector<uint8_t> pending_data;
+        bool writer_exit;
+
+        void mark_dirty(uint32_t addr, uint32_t size);
+        void writer_loop();
+        void write_pages(const std::vector<uint32_t>& pages, const std::vector<uint8_t>& data);
+        void stop_writer();
+
         uint8_t response_buffer[1024];
         unsigned int response_read_pos;
         unsigned int response_write_pos;
@@ -28,12 +28,13 @@
 uint16_t SPU::spdif_irq = 0;
 uint16_t SPU::core_att[2];
 uint32_t SPU::IRQA[2];
-SPU::SPU(int id, IOP_INTC* intc, IOP_DMA* dma) : id(id), intc(intc), dma(dma)
+ADPCM_Cache SPU::adpcm_cache;
+SPU::SPU(int id, IOP_INTC* intc, IOP_DMA* dma) : id(id), intc(intc), dma(dma), audio_output(nullptr)
 { 
 
 }
 
-void SPU::reset(uint8_t* RAM)
+void SPU::reset(uint8_t* RAM, bool keep_output)
 {
     this->RAM = (uint16_t*)RAM;
     status.DMA_busy = false;
@@ -46,6 +47,7 @@ void SPU::reset(uint8_t* RAM)
     key_on = 0;
     key_off = 0xFFFFFF;
     spdif_irq = 0;
+    state_changed = true;
     current_buffer = 0;
     data_input_volume_l = 0x7FFF;
     data_input_volume_r = 0x7FFF;
@@ -63,10 +65,13 @@ void SPU::reset(uint8_t* RAM)
     MVOLL = {};
     MVOLR = {};
 
-    std::ostringstream fname;
-    fname << "spu_" << id << "_stream" << ".wav";
+    if (!keep_output || !coreout)
+    {
+        std::ostringstream fname;
+        fname << "spu_" << id << "_stream" << ".wav";
 
-    coreout = new WAVWriter(fname.str());
+        coreout.reset(new WAVWriter(fname.str()));
+    }
 
     clear_dma_req();
 
@@ -78,6 +83,8 @@ void SPU::reset(uint8_t* RAM)
     IRQA[id-1] = 0x800;
 
     ENDX = 0;
+
+    adpcm_cache.reset();
 }
 
 void SPU::spu_check_irq(uint32_t address)
@@ -99,6 +106,194 @@ void SPU::spu_irq(int index)
     intc->assert_irq(9);
 }
 
+//IRQA addresses that would raise an interrupt if touched right now
+int SPU::get_irq_targets(uint32_t* targets)
+{
+    int count = 0;
+    for (int j = 0; j < 2; j++)
+    {
+        if ((core_att[j] & (1 << 6)) && !(spdif_irq & (4 << j)))
+            targets[count++] = IRQA[j];
+    }
+    return count;
+}
+
+int SPU::samples_until_irq(int max)
+{
+    uint32_t targets[2];
+    int target_count = get_irq_targets(targets);
+    if (!target_count)
+        return max;
+
+    //Key on/off changes the voices after the next sample, so look again once it's done
+    if (key_on || key_off)
+        return 1;
+
+    max = buffer_samples_until_irq(targets, target_count, max);
+    max = reverb_samples_until_irq(targets, target_count, max);
+    for (int v = 0; v < 24; v++)
+        max = voice_samples_until_irq(v, targets, target_count, max);
+    return max;
+}
+
+//Walks the addresses voice_step() reads from, without decoding anything
+int SPU::voice_samples_until_irq(int voice_id, const uint32_t* targets, int target_count, int max)
+{
+    Voice &voice = voices[voice_id];
+    uint32_t addr = voice.current_addr;
+    uint32_t loop_addr = voice.loop_addr;
+    int loop_code = voice.loop_code;
+    unsigned sample_idx = voice.sample_idx;
+
+    auto hits = [&](uint32_t address)
+    {
+        for (int j = 0; j < target_count; j++)
+        {
+            if (address == targets[j])
+                return true;
+        }
+        return false;
+    };
+
+    //Switching blocks reads the header, then moves on like the real thing does
+    auto switch_block = [&]()
+    {
+        addr &= 0x000FFFF8;
+        uint16_t header = RAM[addr];
+        loop_code = (header >> 8) & 0x3;
+        if ((header & (1 << 10)) && !voice.loop_addr_specified)
+            loop_addr = addr;
+        sample_idx = 0;
+        bool hit = hits(addr);
+        addr = (addr + 1) & 0x000FFFFF;
+        return hit;
+    };
+
+    if (voice.new_block && switch_block())
+        return 1;
+
+    //Pitch modulation depends on the previous voice's output, so assume the fastest it can go.
+    //The addresses come in the same order either way, so a hit is never predicted late
+    uint32_t step = voice.pitch;
+    if ((voice_pitch_mod & (1 << voice_id)) && voice_id != 0)
+        step = 0x3FFF;
+    step = std::min(step, 0x3FFFu);
+    if (!step)
+        return max;
+
+    //The source sample the voice moves to on its k'th step is reached on output sample n
+    uint64_t k = 0;
+    while (true)
+    {
+        //Only every fourth source sample reads memory
+        unsigned next_idx = (sample_idx & ~3u) + 4;
+        k += next_idx - sample_idx;
+        sample_idx = next_idx;
+
+        int n = (int)((k * 0x1000 - voice.counter + step - 1) / step);
+        if (n >= max)
+            return max;
+
+        if (hits(addr))
+            return n;
+        addr = (addr + 1) & 0x000FFFFF;
+
+        if (sample_idx == 24 && (loop_code & 0x1))
+            addr = loop_addr | 1;
+
+        if (sample_idx == 28 && switch_block())
+            return n;
+    }
+}
+
+//The sound data input and output buffers, which move on by one every sample
+int SPU::buffer_samples_until_irq(const uint32_t* targets, int target_count, int max)
+{
+    uint32_t bases[10];
+    int base_count = 0;
+
+    uint32_t memout_offset = (id - 1) ? 0x800 : 0x0;
+    bases[base_count++] = VOICE1 + memout_offset;
+    bases[base_count++] = VOICE3 + memout_offset;
+    bases[base_count++] = MEMOUTL + memout_offset;
+    bases[base_count++] = MEMOUTR + memout_offset;
+    bases[base_count++] = MEMOUTEL + memout_offset;
+    bases[base_count++] = MEMOUTER + memout_offset;
+
+    //Core 0 writes its output there, core 1 reads it back
+    bases[base_count++] = SINL;
+    bases[base_count++] = SINR;
+    if (running_ADMA())
+    {
+        bases[base_count++] = get_memin_addr();
+        bases[base_count++] = get_memin_addr() + 0x200;
+    }
+
+    //Both halves of every buffer in one 0x200 ring
+    uint32_t pos = (current_buffer * 0x100) + buffer_pos;
+    for (int j = 0; j < target_count; j++)
+    {
+        for (int b = 0; b < base_count; b++)
+        {
+            uint32_t offset = targets[j] - bases[b];
+            if (offset >= 0x200)
+                continue;
+
+            int n = (int)((offset - pos) & 0x1FF) + 1;
+            max = std::min(max, n);
+        }
+    }
+    return max;
+}
+
+//Every address run_reverb() reads from and writes to, at every other sample
+int SPU::reverb_samples_until_irq(const uint32_t* targets, int target_count, int max)
+{
+    auto &r = reverb;
+    if (static_cast<int>(r.effect_area_end - r.effect_area_start) <= 0)
+        return max;
+
+    bool in_area = false;
+    for (int j = 0; j < target_count; j++)
+        in_area |= targets[j] >= r.effect_area_start && targets[j] <= r.effect_area_end;
+    if (!in_area)
+        return max;
+
+    uint32_t offsets[30];
+    int offset_count = 0;
+    for (uint32_t offset : {r.dLSAME, r.mLSAME - 1, r.dRSAME, r.mRSAME - 1,
+                            r.dRDIFF, r.mLDIFF - 1, r.dLDIFF, r.mRDIFF - 1,
+                            r.mLCOMB1, r.mLCOMB2, r.mLCOMB3, r.mLCOMB4,
+                            r.mRCOMB1, r.mRCOMB2, r.mRCOMB3, r.mRCOMB4,
+                            r.mLAPF1 - r.dAFP1, r.mRAPF1 - r.dAFP1, r.mLAPF2 - r.dAFP2, r.mRAPF2 - r.dAFP2})
+        offsets[offset_count++] = offset;
+    if (effect_enable)
+    {
+        for (uint32_t offset : {r.mLSAME, r.mRSAME, r.mLDIFF, r.mRDIFF, r.mLAPF1, r.mRAPF1, r.mLAPF2, r.mRAPF2})
+            offsets[offset_count++] = offset;
+    }
+
+    uint32_t size = r.effect_area_end - r.effect_area_start;
+    uint32_t effect_pos = r.effect_pos;
+    for (int n = r.cycle + 1; n < max; n += 2)
+    {
+        for (int i = 0; i < offset_count; i++)
+        {
+            uint32_t addr = r.effect_area_start + ((effect_pos + offsets[i]) % size);
+            for (int j = 0; j < target_count; j++)
+            {
+                if (addr == targets[j])
+                    return n;
+            }
+        }
+
+        effect_pos++;
+        if (effect_pos >= size + 1)
+            effect_pos = 0;
+    }
+    return max;
+}
+
 void SPU::switch_block(int voice_id)
 {
     Voice &voice = voices[voice_id];
@@ -112,7 +307,7 @@ void SPU::switch_block(int voice_id)
 
     voice.sample_idx = 0;
 
-    voice.pcm = voice.adpcm.decode_block((uint8_t*)(RAM+voice.current_addr));
+    voice.pcm = adpcm_cache.decode_block(voice.adpcm, RAM, voice.current_addr);
 
     spu_check_irq(voice.current_addr);
     voice.current_addr++;
@@ -125,7 +320,7 @@ void SPU::switch_block(int voice_id)
     voice.next_sample = voice.pcm.at(voice.sample_idx);
 }
 
-stereo_sample SPU::voice_gen_sample(int voice_id)
+void SPU::voice_step(int voice_id, int16_t mod_input)
 {
     Voice &voice = voices[voice_id];
 
@@ -138,7 +333,7 @@ stereo_sample SPU::voice_gen_sample(int voice_id)
     if ((voice_pitch_mod & (1 << voice_id)) && voice_id != 0)
     {
         // Todo: handle the glitchyness described by nocash?
-        int factor = voices[voice_id-1].outx;
+        int factor = mod_input;
         factor = factor + 0x8000;
         step = (step * factor) >> 15;
         step = step & 0xFFFF;
@@ -190,58 +385,139 @@ stereo_sample SPU::voice_gen_sample(int voice_id)
         voice.old1 = voice.next_sample;
         voice.next_sample = voice.pcm.at(voice.sample_idx);
     }
+}
 
-    int16_t output_sample = 0;
+void SPU::set_sync_func(std::function<void()> func)
+{
+    sync_func = func;
+}
+
+void SPU::set_audio_output(AudioOutput* output)
+{
+    audio_output = output;
+}
 
-    if (!(voice_noise_gen & (1 << voice_id)))
+void SPU::gen_samples(int count)
+{
+    while (count > 0)
     {
-        output_sample = interpolate(voice_id);
+        //Key on/off takes effect at the end of a sample, so a pending one gets a block to itself
+        int block_size = std::min(count, MAX_BLOCK_SAMPLES);
+        if (key_on || key_off)
+            block_size = 1;
+
+        render_block(block_size);
+
+        // Key off/on voices
+        update_voice_state();
+
+        count -= block_size;
     }
-    else
+}
+
+void SPU::render_block(int count)
+{
+    VoiceBlock block = {};
+
+    int16_t dry_l[MAX_BLOCK_SAMPLES] = {};
+    int16_t dry_r[MAX_BLOCK_SAMPLES] = {};
+    int16_t wet_l[MAX_BLOCK_SAMPLES] = {};
+    int16_t wet_r[MAX_BLOCK_SAMPLES] = {};
+    int16_t noise_output[MAX_BLOCK_SAMPLES] = {};
+    int16_t voice1_output[MAX_BLOCK_SAMPLES];
+    int16_t voice3_output[MAX_BLOCK_SAMPLES];
+    stereo_sample core_output[MAX_BLOCK_SAMPLES];
+
+    // The kernels take eight samples at a time, whatever ends up past count is never used
+    int padded_count = (count + 7) & ~7;
+
+    // Nothing the voices do feeds back into the noise generator, so step it ahead of them
+    for (int i = 0; i < count; i++)
     {
-        output_sample = noise.output;
+        noise_output[i] = noise.output;
+        noise.step();
     }
 
-    output_sample = (output_sample * voice.adsr.volume) >> 15;
-    voice.outx = output_sample;
-
-    if (voice_id == 1)
+    // Run each voice over the whole block before moving on to the next one.
+    // Stepping through the ADPCM data has to go sample by sample, the rest is done for many samples at once.
+    for (int v = 0; v < 24; v++)
     {
-        memout(VOICE1, output_sample);
+        Voice &voice = voices[v];
+        for (int i = 0; i < count; i++)
+        {
+            // block.output still holds the previous voice, which pitch modulates this one
+            voice_step(v, block.output[i]);
+
+            block.gauss_index[i] = (voice.counter & 0x0FF0) >> 4;
+            block.old3[i] = voice.old3;
+            block.old2[i] = voice.old2;
+            block.old1[i] = voice.old1;
+            block.next_sample[i] = voice.next_sample;
+            block.adsr_volume[i] = voice.adsr.volume;
+            block.left_volume[i] = voice.left_vol.value;
+            block.right_volume[i] = voice.right_vol.value;
+
+            voice.left_vol.advance();
+            voice.right_vol.advance();
+            voice.adsr.advance();
+        }
+
+        if (!(voice_noise_gen & (1 << v)))
+            interpolate_block(block, padded_count);
+        else
+            std::copy(noise_output, noise_output + padded_count, block.output);
+
+        for (int i = 0; i < padded_count; i += 8)
+        {
+            __m128i sample = _mm_loadu_si128((__m128i*)&block.output[i]);
+            sample = mulvol_x8(sample, _mm_loadu_si128((__m128i*)&block.adsr_volume[i]));
+            _mm_storeu_si128((__m128i*)&block.output[i], sample);
+
+            __m128i left = mulvol_x8(sample, _mm_loadu_si128((__m128i*)&block.left_volume[i]));
+            __m128i right = mulvol_x8(sample, _mm_loadu_si128((__m128i*)&block.right_volume[i]));
+            _mm_storeu_si128((__m128i*)&block.left[i], left);
+            _mm_storeu_si128((__m128i*)&block.right[i], right);
+        }
+        voice.outx = block.output[count - 1];
+
+        if (voice.mix_state.dry_l)
+            mix_block(dry_l, block.left, padded_count);
+        if (voice.mix_state.dry_r)
+            mix_block(dry_r, block.right, padded_count);
+        if (voice.mix_state.wet_l)
+            mix_block(wet_l, block.left, padded_count);
+        if (voice.mix_state.wet_r)
+            mix_block(wet_r, block.right, padded_count);
+
+        if (v == 1)
+            std::copy(block.output, block.output + count, voice1_output);
+        if (v == 3)
+            std::copy(block.output, block.output + count, voice3_output);
     }
-    if (voice_id == 3)
+
+    for (int i = 0; i < count; i++)
     {
-        memout(VOICE3, output_sample);
+        stereo_sample voices_dry, voices_wet;
+        voices_dry.left = dry_l[i];
+        voices_dry.right = dry_r[i];
+        voices_wet.left = wet_l[i];
+        voices_wet.right = wet_r[i];
+
+        memout(VOICE1, voice1_output[i]);
+        memout(VOICE3, voice3_output[i]);
+        core_output[i] = mix_sample(voices_dry, voices_wet);
     }
 
-    stereo_sample out;
-    out.left = (output_sample*voice.left_vol.value) >> 15;
-    out.right = (output_sample*voice.right_vol.value) >> 15;
-
-    voice.left_vol.advance();
-    voice.right_vol.advance();
-    voice.adsr.advance();
-
-    return out;
+    if (audio_output)
+        audio_output->push_samples(core_output, count);
 }
 
-void SPU::gen_sample()
+stereo_sample SPU::mix_sample(stereo_sample voices_dry, stereo_sample voices_wet)
 {
-
-    stereo_sample voices_dry = {};
-    stereo_sample voices_wet = {};
     stereo_sample core_dry = {};
     stereo_sample core_wet = {};
     stereo_sample memin = {};
 
-    for (int i = 0; i < 24; i++)
-    {
-        stereo_sample sample = voice_gen_sample(i);
-
-        voices_dry.mix(sample, voices[i].mix_state.dry_l, voices[i].mix_state.dry_r);
-        voices_wet.mix(sample, voices[i].mix_state.wet_l, voices[i].mix_state.wet_r);
-    }
-
     memout(MEMOUTL, voices_dry.left);
     memout(MEMOUTR, voices_dry.right);
     memout(MEMOUTEL, voices_wet.left);
@@ -289,20 +565,12 @@ void SPU::gen_sample()
         memout(SINR, core_output.right);
     }
 
-    // This would be where to get the PCM for an audio backend,
     // core_output on SPU2 represents the final mixed output.
-
     if (wav_output)
     {
         coreout->append_pcm_stereo(core_output);
     }
 
-    noise.step();
-
-    // Key off/on voices
-    update_voice_state();
-
-
     // Output/input buffer management
     buffer_pos++;
     if (buffer_pos == 0x100)
@@ -314,6 +582,8 @@ void SPU::gen_sample()
         if (running_ADMA())
             set_dma_req();
     }
+
+    return core_output;
 }
 
 static const uint8_t noise_add[64] = {
@@ -380,6 +650,8 @@ void SPU::pause_DMA()
 
 uint32_t SPU::read_DMA()
 {
+    sync_func();
+
     uint32_t value = RAM[current_addr];
     spu_check_irq(current_addr);
     current_addr++;
@@ -397,13 +669,18 @@ uint32_t SPU::read_DMA()
 
 void SPU::write_DMA(uint32_t value)
 {
+    sync_func();
+    state_changed = true;
+
     //printf("[SPU%d] Write mem $%08X ($%08X)\n", id, value, current_addr);
     RAM[current_addr] = value & 0xFFFF;
+    adpcm_cache.invalidate(current_addr);
     spu_check_irq(current_addr);
     current_addr++;
     current_addr &= 0x000FFFFF;
 
     RAM[current_addr] = value >> 16;
+    adpcm_cache.invalidate(current_addr);
     spu_check_irq(current_addr);
     current_addr++;
     current_addr &= 0x000FFFFF;
@@ -414,6 +691,9 @@ void SPU::write_DMA(uint32_t value)
 
 void SPU::write_ADMA(uint8_t *source_RAM)
 {
+    sync_func();
+    state_changed = true;
+
     int next_buffer = 1 - current_buffer;
 
     //if (ADMA_progress == 0)
@@ -424,12 +704,15 @@ void SPU::write_ADMA(uint8_t *source_RAM)
 
     if (ADMA_progress < 256)
     {
-        std::memcpy((RAM+get_memin_addr()+(next_buffer*0x100)+(ADMA_progress)), source_RAM, 4);
-
+        uint32_t addr = get_memin_addr()+(next_buffer*0x100)+(ADMA_progress);
+        std::memcpy((RAM+addr), source_RAM, 4);
+        adpcm_cache.invalidate(addr);
     }
     else if (ADMA_progress < 512)
     {
-        std::memcpy((RAM+0x200+get_memin_addr()+(next_buffer*0x100)+(ADMA_progress-0x100)), source_RAM, 4);
+        uint32_t addr = 0x200+get_memin_addr()+(next_buffer*0x100)+(ADMA_progress-0x100);
+        std::memcpy((RAM+addr), source_RAM, 4);
+        adpcm_cache.invalidate(addr);
     }
 
     ADMA_progress += 2;
@@ -456,6 +739,7 @@ void SPU::write(uint32_t addr, uint16_t data)
 {
     spu_check_irq(addr);
     RAM[addr] = data;
+    adpcm_cache.invalidate(addr);
 }
 
 uint16_t SPU::read_mem()
@@ -474,7 +758,8 @@ void SPU::write_mem(uint16_t value)
 {
     printf("[SPU%d] Write mem $%04X ($%08X)\n", id, value, current_addr);
     RAM[current_addr] = value;
-    
+    adpcm_cache.invalidate(current_addr);
+
     spu_check_irq(current_addr);
     current_addr++;
     current_addr &= 0x000FFFFF;
@@ -482,6 +767,8 @@ void SPU::write_mem(uint16_t value)
 
 uint16_t SPU::read16(uint32_t addr)
 {
+    sync_func();
+
     uint16_t reg = 0;
     addr &= 0x7FF;
     if (addr >= 0x760)
@@ -677,6 +964,9 @@ void SPU::write_reverb_reg32(uint32_t addr, uint16_t value)
 
 void SPU::write16(uint32_t addr, uint16_t value)
 {
+    sync_func();
+    state_changed = true;
+
     addr &= 0x7FF;
 
     if (addr >= 0x760)
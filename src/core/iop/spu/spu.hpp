@@ -2,7 +2,10 @@
 #define SPU_HPP
 #include <cstdint>
 #include <fstream>
+#include <functional>
+#include <memory>
 #include "spu_envelope.hpp"
+#include "../../audio/audio_output.hpp"
 #include "../../audio/utils.hpp"
 #include "spu_adpcm.hpp"
 #include "spu_utils.hpp"
@@ -171,7 +174,27 @@ class IOP_DMA;
 
 class SPU
 {
+    public:
+        //Largest number of samples rendered voice by voice in one go
+        constexpr static int MAX_BLOCK_SAMPLES = 128;
     private:
+        //One voice over a block, a plain array per value so that the kernels can work on eight samples at a time
+        struct VoiceBlock
+        {
+            uint8_t gauss_index[MAX_BLOCK_SAMPLES];
+            int16_t old3[MAX_BLOCK_SAMPLES];
+            int16_t old2[MAX_BLOCK_SAMPLES];
+            int16_t old1[MAX_BLOCK_SAMPLES];
+            int16_t next_sample[MAX_BLOCK_SAMPLES];
+            int16_t adsr_volume[MAX_BLOCK_SAMPLES];
+            int16_t left_volume[MAX_BLOCK_SAMPLES];
+            int16_t right_volume[MAX_BLOCK_SAMPLES];
+
+            int16_t output[MAX_BLOCK_SAMPLES];
+            int16_t left[MAX_BLOCK_SAMPLES];
+            int16_t right[MAX_BLOCK_SAMPLES];
+        };
+
         unsigned int id;
         IOP_INTC* intc;
         IOP_DMA* dma;
@@ -193,7 +216,8 @@ class SPU
         static uint16_t core_att[2];
         SPU_STAT status;
 
-        WAVWriter* coreout;
+        std::unique_ptr<WAVWriter> coreout;
+        AudioOutput* audio_output;
 
         static uint16_t spdif_irq;
 
@@ -237,12 +261,25 @@ class SPU
         uint32_t buffer_pos;
 
         static uint32_t IRQA[2];
+
+        // Shared by both cores, as either one can write over blocks the other is playing
+        static ADPCM_Cache adpcm_cache;
         uint32_t ENDX;
         uint32_t key_on;
         uint32_t key_off;
 
-        stereo_sample voice_gen_sample(int voice_id);
-        int16_t interpolate(int voice);
+        //Called before anything outside of the SPU looks at or changes its state,
+        //so that samples still owed to the past get rendered first
+        std::function<void()> sync_func;
+
+        //Set whenever the SPU is written to, as that can move the next IRQA hit
+        bool state_changed;
+
+        void voice_step(int voice_id, int16_t mod_input);
+        void interpolate_block(VoiceBlock& block, int count);
+
+        void render_block(int count);
+        stereo_sample mix_sample(stereo_sample voices_dry, stereo_sample voices_wet);
 
         void key_on_voice(int v);
         void key_off_voice(int v);
@@ -251,6 +288,10 @@ class SPU
 
         void spu_check_irq(uint32_t address);
         void spu_irq(int index);
+        int get_irq_targets(uint32_t* targets);
+        int voice_samples_until_irq(int voice_id, const uint32_t* targets, int target_count, int max);
+        int buffer_samples_until_irq(const uint32_t* targets, int target_count, int max);
+        int reverb_samples_until_irq(const uint32_t* targets, int target_count, int max);
 
         stereo_sample read_memin();
 
@@ -271,10 +312,18 @@ class SPU
         SPU(int id, IOP_INTC* intc, IOP_DMA* dma);
 
         bool running_ADMA();
+        bool IRQ_enabled();
         bool wav_output = false;
 
-        void reset(uint8_t* RAM);
-        void gen_sample();
+        //keep_output carries on with the current WAV dump rather than starting it over
+        void reset(uint8_t* RAM, bool keep_output = false);
+        void set_sync_func(std::function<void()> func);
+        void set_audio_output(AudioOutput* output);
+        void gen_samples(int count);
+
+        //How many samples have to be rendered before an IRQA hit from this core can be pending, at most max
+        int samples_until_irq(int max);
+        bool take_state_changed();
 
         void start_DMA(int size);
         void pause_DMA();
@@ -292,8 +341,8 @@ class SPU
 
         void gaussianConstructTable();
 
-        void load_state(std::ifstream& state);
-        void save_state(std::ofstream& state);
+        void load_state(std::istream& state);
+        void save_state(std::ostream& state);
 
 };
 
@@ -302,4 +351,16 @@ inline bool SPU::running_ADMA()
     return (autodma_ctrl & (1 << (id - 1)));
 }
 
+inline bool SPU::IRQ_enabled()
+{
+    return core_att[id - 1] & (1 << 6);
+}
+
+inline bool SPU::take_state_changed()
+{
+    bool changed = state_changed;
+    state_changed = false;
+    return changed;
+}
+
 #endif // SPU_HPP
@@ -48,3 +48,39 @@ std::array<int16_t, 28> ADPCM_Decoder::decode_block(uint8_t *block)
 
     return pcm;
 }
+
+ADPCM_Cache::ADPCM_Cache() : entries(SIZE)
+{
+    reset();
+}
+
+void ADPCM_Cache::reset()
+{
+    for (ADPCM_CacheEntry& entry : entries)
+        entry.addr = EMPTY;
+}
+
+//addr is the halfword address of the block's header
+std::array<int16_t, 28> ADPCM_Cache::decode_block(ADPCM_Decoder& decoder, uint16_t* RAM, uint32_t addr)
+{
+    ADPCM_CacheEntry& entry = entries[(addr >> 3) & (SIZE - 1)];
+    uint8_t* block = (uint8_t*)(RAM + addr);
+
+    if (entry.addr == addr && entry.hist1_in == decoder.hist1 && entry.hist2_in == decoder.hist2)
+    {
+        decoder.shift_factor = (*block & 0xF);
+        decoder.coef_index = ((*block >> 4) & 0xF);
+        decoder.flags = *(block+1);
+        decoder.hist1 = entry.hist1_out;
+        decoder.hist2 = entry.hist2_out;
+        return entry.pcm;
+    }
+
+    entry.addr = addr;
+    entry.hist1_in = decoder.hist1;
+    entry.hist2_in = decoder.hist2;
+    entry.pcm = decoder.decode_block(block);
+    entry.hist1_out = decoder.hist1;
+    entry.hist2_out = decoder.hist2;
+    return entry.pcm;
+}
@@ -2,6 +2,7 @@
 #define __PS_ADPCM_H
 #include <array>
 #include <cstdint>
+#include <vector>
 #include "spu_utils.hpp"
 
 class ADPCM_Decoder
@@ -10,10 +11,44 @@ class ADPCM_Decoder
         std::array<int16_t, 28> decode_block(uint8_t *block);
         uint8_t flags;
     private:
+        friend class ADPCM_Cache;
+
         uint8_t block[14];
         uint8_t shift_factor, coef_index;
         int32_t hist1, hist2;
 };
 
+struct ADPCM_CacheEntry
+{
+    uint32_t addr;
+    int32_t hist1_in, hist2_in;
+    int32_t hist1_out, hist2_out;
+    std::array<int16_t, 28> pcm;
+};
+
+//Blocks already decoded, direct mapped on their address in SPU RAM.
+//A block only decodes to the same PCM again if the predictor history going in is the same,
+//so the history is part of the tag.
+class ADPCM_Cache
+{
+    public:
+        ADPCM_Cache();
+
+        void reset();
+        std::array<int16_t, 28> decode_block(ADPCM_Decoder& decoder, uint16_t* RAM, uint32_t addr);
+        void invalidate(uint32_t addr);
+    private:
+        constexpr static int SIZE = 1 << 14;
+        constexpr static uint32_t EMPTY = 0xFFFFFFFF;
+
+        std::vector<ADPCM_CacheEntry> entries;
+};
+
+inline void ADPCM_Cache::invalidate(uint32_t addr)
+{
+    ADPCM_CacheEntry& entry = entries[(addr >> 3) & (SIZE - 1)];
+    if (entry.addr == (addr & ~0x7))
+        entry.addr = EMPTY;
+}
 
 #endif // __PS_ADPCM_H_
@@ -55,16 +55,26 @@ void SPU::gaussianConstructTable() {
 }
 
 
-int16_t SPU::interpolate(int voice)
+void SPU::interpolate_block(VoiceBlock& block, int count)
 {
-    int16_t i = (voices[voice].counter & 0x0ff0) >> 4;
-
-    int16_t out = 0;
-
-    out =  ((gaussianTable[0x0FF-i] * (voices[voice].old3)) >> 15);
-    out += ((gaussianTable[0x1FF-i] * (voices[voice].old2)) >> 15);
-    out += ((gaussianTable[0x100+i] * (voices[voice].old1)) >> 15);
-    out += ((gaussianTable[0x000+i] * (voices[voice].next_sample)) >> 15);
+    int16_t gauss[4][MAX_BLOCK_SAMPLES];
+    for (int i = 0; i < count; i++)
+    {
+        uint8_t index = block.gauss_index[i];
+        gauss[0][i] = gaussianTable[0x0FF - index];
+        gauss[1][i] = gaussianTable[0x1FF - index];
+        gauss[2][i] = gaussianTable[0x100 + index];
+        gauss[3][i] = gaussianTable[0x000 + index];
+    }
 
-    return out;
+    // Each tap is shifted down on its own before they're summed up
+    for (int i = 0; i < count; i += 8)
+    {
+        __m128i out;
+        out = mulvol_x8(_mm_loadu_si128((__m128i*)&gauss[0][i]), _mm_loadu_si128((__m128i*)&block.old3[i]));
+        out = _mm_add_epi16(out, mulvol_x8(_mm_loadu_si128((__m128i*)&gauss[1][i]), _mm_loadu_si128((__m128i*)&block.old2[i])));
+        out = _mm_add_epi16(out, mulvol_x8(_mm_loadu_si128((__m128i*)&gauss[2][i]), _mm_loadu_si128((__m128i*)&block.old1[i])));
+        out = _mm_add_epi16(out, mulvol_x8(_mm_loadu_si128((__m128i*)&gauss[3][i]), _mm_loadu_si128((__m128i*)&block.next_sample[i])));
+        _mm_storeu_si128((__m128i*)&block.output[i], out);
+    }
 }
@@ -2,6 +2,7 @@
 #define __SPU_UTILS_H_
 #include <cstdint>
 #include <algorithm>
+#include <emmintrin.h>
 
 inline int16_t clamp16(int input)
 {
@@ -13,6 +14,25 @@ inline int16_t mulvol(int one, int two)
     return static_cast<int16_t>((one * two) >> 15);
 }
 
+// mulvol on eight lanes at once, keeping the low 16 bits of each product >> 15 like the cast above
+inline __m128i mulvol_x8(__m128i one, __m128i two)
+{
+    __m128i lo = _mm_mullo_epi16(one, two);
+    __m128i hi = _mm_mulhi_epi16(one, two);
+    return _mm_or_si128(_mm_slli_epi16(hi, 1), _mm_srli_epi16(lo, 15));
+}
+
+// stereo_sample::mix over a run of one channel, count being a multiple of eight
+inline void mix_block(int16_t* dest, const int16_t* src, int count)
+{
+    for (int i = 0; i < count; i += 8)
+    {
+        __m128i a = _mm_loadu_si128((__m128i*)&dest[i]);
+        __m128i b = _mm_loadu_si128((const __m128i*)&src[i]);
+        _mm_storeu_si128((__m128i*)&dest[i], _mm_adds_epi16(a, b));
+    }
+}
+
 struct stereo_sample
 {
     int16_t left = 0;
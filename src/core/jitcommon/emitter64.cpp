@@ -57,36 +57,35 @@ void Emitter64::rexw_r_rm(REG_64 reg, REG_64 rm)
     block->write<uint8_t>(rex);
 }
 
-void Emitter64::vex(REG_64 source, REG_64 source2, REG_64 dest, bool packed)
+void Emitter64::vex(REG_64 source, REG_64 source2, REG_64 dest, VEX_PREFIX prefix, VEX_MAP map)
 {
-    if (source2 & 0x8)
-        vex3(source, source2, dest, packed);
+    //The two-byte form can only encode the 0F map and has no B/X extension bits
+    if ((source2 & 0x8) || map != VEX_MAP::_0F)
+        vex3(source, source2, dest, prefix, map);
     else
-        vex2(source, dest, packed);
+        vex2(source, dest, prefix);
 }
 
-void Emitter64::vex2(REG_64 source, REG_64 dest, bool packed)
+void Emitter64::vex2(REG_64 source, REG_64 dest, VEX_PREFIX prefix)
 {
     block->write<uint8_t>(0xC5);
-    uint8_t result = 0xF8;
-    if (!packed)
-        result |= 0x2;
+    uint8_t result = 0xF8 | (uint8_t)prefix;
     if (dest & 0x8)
         result -= 0x80;
     result += -(source << 3);
     block->write<uint8_t>(result);
 }
 
-void Emitter64::vex3(REG_64 source, REG_64 source2, REG_64 dest, bool packed)
+void Emitter64::vex3(REG_64 source, REG_64 source2, REG_64 dest, VEX_PREFIX prefix, VEX_MAP map)
 {
     block->write<uint8_t>(0xC4);
-    uint8_t result = 0xC1;
+    uint8_t result = 0xE0 | (uint8_t)map;
     if (dest & 0x8)
         result -= 0x80;
+    if (source2 & 0x8)
+        result -= 0x20;
     block->write<uint8_t>(result);
-    result = 0x78;
-    if (!packed)
-        result |= 0x2;
+    result = 0x78 | (uint8_t)prefix;
     result += -(source << 3);
     block->write<uint8_t>(result);
 }
@@ -2588,21 +2587,75 @@ void Emitter64::CVTTPS2DQ(REG_64 xmm_source, REG_64 xmm_dest)
 
 void Emitter64::VADDSS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
 {
-    vex(xmm_source, xmm_source2, xmm_dest, false);
+    vex(xmm_source, xmm_source2, xmm_dest, VEX_PREFIX::F3);
+    block->write<uint8_t>(0x58);
+    modrm(0b11, xmm_dest, xmm_source2);
+}
+
+void Emitter64::VADDPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex(xmm_source, xmm_source2, xmm_dest, VEX_PREFIX::NONE);
     block->write<uint8_t>(0x58);
-    modrm(0b11, 0, xmm_source2);
+    modrm(0b11, xmm_dest, xmm_source2);
+}
+
+void Emitter64::VSUBPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex(xmm_source, xmm_source2, xmm_dest, VEX_PREFIX::NONE);
+    block->write<uint8_t>(0x5C);
+    modrm(0b11, xmm_dest, xmm_source2);
+}
+
+void Emitter64::VMULPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
+{
+    vex(xmm_source, xmm_source2, xmm_dest, VEX_PREFIX::NONE);
+    block->write<uint8_t>(0x59);
+    modrm(0b11, xmm_dest, xmm_source2);
 }
 
 void Emitter64::VMINPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
 {
-    vex(xmm_source, xmm_source2, xmm_dest, true);
+    vex(xmm_source, xmm_source2, xmm_dest, VEX_PREFIX::NONE);
     block->write<uint8_t>(0x5D);
-    modrm(0b11, 0, xmm_source2);
+    modrm(0b11, xmm_dest, xmm_source2);
 }
 
 void Emitter64::VMAXPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest)
 {
-    vex(xmm_source, xmm_source2, xmm_dest, true);
+    vex(xmm_source, xmm_source2, xmm_dest, VEX_PREFIX::NONE);
     block->write<uint8_t>(0x5F);
-    modrm(0b11, 0, xmm_source2);
+    modrm(0b11, xmm_dest, xmm_source2);
+}
+
+void Emitter64::VPERMILPS(uint8_t imm, REG_64 xmm_source, REG_64 xmm_dest)
+{
+    //No vvvv operand, so encode XMM0 as the first source (vvvv = 1111b)
+    vex(REG_64::XMM0, xmm_source, xmm_dest, VEX_PREFIX::_66, VEX_MAP::_0F3A);
+    block->write<uint8_t>(0x04);
+    modrm(0b11, xmm_dest, xmm_source);
+    block->write<uint8_t>(imm);
+}
+
+void Emitter64::VBROADCASTSS(REG_64 xmm_source, REG_64 xmm_dest)
+{
+    vex(REG_64::XMM0, xmm_source, xmm_dest, VEX_PREFIX::_66, VEX_MAP::_0F38);
+    block->write<uint8_t>(0x18);
+    modrm(0b11, xmm_dest, xmm_source);
+}
+
+void Emitter64::VPMINSD_XMM_FROM_MEM(REG_64 indir_source, REG_64 xmm_source, REG_64 xmm_dest)
+{
+    vex(xmm_source, indir_source, xmm_dest, VEX_PREFIX::_66, VEX_MAP::_0F38);
+    block->write<uint8_t>(0x39);
+    if ((indir_source & 7) == 5)
+    {
+        modrm(0b01, xmm_dest, indir_source);
+        block->write<uint8_t>(0);
+    }
+    else
+    {
+        modrm(0, xmm_dest, indir_source);
+        if ((indir_source & 7) == 4)
+            block->write<uint8_t>(0x24);
+    }
 }
@@ -49,6 +49,22 @@ enum class ConditionCode
     G = 15, NLE = 15
 };
 
+//Implied legacy prefix (VEX.pp) and opcode map (VEX.mmmmm) of a VEX-encoded instruction
+enum class VEX_PREFIX
+{
+    NONE = 0,
+    _66 = 1,
+    F3 = 2,
+    F2 = 3
+};
+
+enum class VEX_MAP
+{
+    _0F = 1,
+    _0F38 = 2,
+    _0F3A = 3
+};
+
 class Emitter64
 {
     private:
@@ -61,9 +77,9 @@ class Emitter64
         void rexw_rm(REG_64 rm);
         void rexw_r_rm(REG_64 reg, REG_64 rm);
         void modrm(uint8_t mode, uint8_t reg, uint8_t rm);
-        void vex(REG_64 source, REG_64 source2, REG_64 dest, bool packed);
-        void vex2(REG_64 source, REG_64 dest, bool packed);
-        void vex3(REG_64 source, REG_64 source2, REG_64 dest, bool packed);
+        void vex(REG_64 source, REG_64 source2, REG_64 dest, VEX_PREFIX prefix, VEX_MAP map = VEX_MAP::_0F);
+        void vex2(REG_64 source, REG_64 dest, VEX_PREFIX prefix);
+        void vex3(REG_64 source, REG_64 source2, REG_64 dest, VEX_PREFIX prefix, VEX_MAP map);
 
         int get_rip_offset(uint64_t addr);
     public:
@@ -355,9 +371,19 @@ class Emitter64
         //Convert truncated floats into 32-bit signed integers
         void CVTTPS2DQ(REG_64 xmm_source, REG_64 xmm_dest);
 
+        //AVX three-operand forms: dest = source OP source2
         void VADDSS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VADDPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VSUBPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+        void VMULPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
         void VMINPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
         void VMAXPS(REG_64 xmm_source, REG_64 xmm_source2, REG_64 xmm_dest);
+
+        void VPERMILPS(uint8_t imm, REG_64 xmm_source, REG_64 xmm_dest);
+        void VPMINSD_XMM_FROM_MEM(REG_64 indir_source, REG_64 xmm_source, REG_64 xmm_dest);
+
+        //AVX2
+        void VBROADCASTSS(REG_64 xmm_source, REG_64 xmm_dest);
 };
 
 #endif // EMITTER64_HPP
@@ -0,0 +1,60 @@
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+#include "hostcpu.hpp"
+
+static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuidex(info, leaf, subleaf);
+    for (int i = 0; i < 4; i++)
+        regs[i] = info[i];
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t xgetbv(uint32_t index)
+{
+#ifdef _MSC_VER
+    return _xgetbv(index);
+#else
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+    return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+static bool detect_avx2()
+{
+    uint32_t regs[4];
+    cpuid(0, 0, regs);
+    if (regs[0] < 7)
+        return false;
+
+    //AVX and OSXSAVE
+    cpuid(1, 0, regs);
+    if ((regs[2] & (1 << 28 | 1 << 27)) != (1 << 28 | 1 << 27))
+        return false;
+
+    //XCR0 must have both the SSE and AVX state enabled
+    if ((xgetbv(0) & 0x6) != 0x6)
+        return false;
+
+    cpuid(7, 0, regs);
+    return regs[1] & (1 << 5);
+}
+
+namespace HostCPU
+{
+    bool has_avx2()
+    {
+        static const bool avx2 = detect_avx2();
+        return avx2;
+    }
+};
@@ -0,0 +1,10 @@
+#ifndef HOSTCPU_HPP
+#define HOSTCPU_HPP
+
+namespace HostCPU
+{
+    //True if the host CPU supports AVX2 and the OS saves the upper YMM state
+    bool has_avx2();
+};
+
+#endif // HOSTCPU_HPP
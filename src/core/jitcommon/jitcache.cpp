@@ -6,6 +6,7 @@
 #endif
 
 #include <limits>
+#include <vector>
 #include <cstring>
 
 #include "../errors.hpp"
@@ -525,6 +526,11 @@ void EEJitHeap::invalidate_ee_page(uint32_t page)
         // kill all PCs in the page.
         if(kv->second.block_array) {
             for(uint32_t idx = 0; idx < 1024; idx++) {
+                // and forget them in the lookup cache, the dispatcher would jump into freed memory otherwise
+                EEJitBlockRecord*& cached = lookup_cache[(page * 1024 + idx) & 0x7FFF];
+                if(cached == &kv->second.block_array[idx]) {
+                    cached = nullptr;
+                }
                 if(kv->second.block_array[idx].literals_start) {
                     jit_free(kv->second.block_array[idx].literals_start);
                 }
@@ -551,6 +557,27 @@ void EEJitHeap::invalidate_ee_page(uint32_t page)
 
 }
 
+/*!
+ * Free every page whose code was translated from host memory in [start, end), or whose virtual page
+ * no longer maps onto the memory its code was translated from.
+ */
+void EEJitHeap::invalidate_memory(uint8_t** tlb_map, const uint8_t* start, const uint8_t* end)
+{
+    std::vector<uint32_t> stale_pages;
+    for (auto& page : ee_page_record_map)
+    {
+        uint8_t* mem = page.second.mem;
+        if (!mem)
+            continue;
+
+        if ((mem < end && mem + 4096 > start) || tlb_map[page.first] != mem)
+            stale_pages.push_back(page.first);
+    }
+
+    for (uint32_t page : stale_pages)
+        invalidate_ee_page(page);
+}
+
 /*!
  * Return a matching block
  * returns nullptr if the block isn't found.
@@ -590,7 +617,7 @@ void EEJitHeap::flush_all_blocks()
 /*!
  * Add a completed block to the JIT heap
  */
-EEJitBlockRecord* EEJitHeap::insert_block(uint32_t PC, JitBlock *block)
+EEJitBlockRecord* EEJitHeap::insert_block(uint32_t PC, JitBlock *block, uint8_t* mem)
 {
     // compute block size
     uint8_t *code_start = block->get_code_start();
@@ -632,6 +659,7 @@ EEJitBlockRecord* EEJitHeap::insert_block(uint32_t PC, JitBlock *block)
     if (!page_record->block_array)
     {
         page_record->block_array = new EEJitBlockRecord[1024];
+        page_record->mem = mem;
         page_record->valid = true;
         memset(page_record->block_array, 0, 1024 * sizeof(EEJitBlockRecord));
     }
@@ -218,6 +218,25 @@ public:
         block_map.clear();
     }
 
+    /*!
+     * Remove a single block from the lookup. The code stays on the heap until the next flush,
+     * so a block may safely invalidate itself while it is running.
+     */
+    void invalidate_block(DataType data)
+    {
+        block_map.erase(data);
+    }
+
+    std::size_t get_used_size()
+    {
+        return heap_cur - heap;
+    }
+
+    std::size_t get_block_count()
+    {
+        return block_map.size();
+    }
+
     bool heap_is_full()
     {
         if (heap_top - heap_cur < (JitBlock::JIT_MAX_BLOCK_CODESIZE + JitBlock::JIT_MAX_BLOCK_LITERALSIZE)) //Check we have 5mb spare (max block size)
@@ -298,6 +317,15 @@ using VUJitBlockRecord = JitBlockRecord<VUBlockState>;
 using VUJitHeap = JitUnorderedMapHeap<VUBlockState, VUBlockStateHash>;
 
 
+////////////////////////
+// IOP Implementation
+////////////////////////
+
+// Keyed on the block's PC, with bit 32 set when the block was compiled for uncached instruction fetches
+using IOPJitBlockRecord = JitBlockRecord<uint64_t>;
+using IOPJitHeap = JitUnorderedMapHeap<uint64_t, GSU64Hash>;
+
+
 ////////////////////////
 // EE Implementation
 ////////////////////////
@@ -315,6 +343,7 @@ struct EEJitBlockRecordData {
 
 struct EEPageRecord {
     JitBlockRecord<EEJitBlockRecordData>* block_array = nullptr; // nullptr if there is no cached code in this block.
+    uint8_t* mem = nullptr; // host memory the code was translated from, nullptr if it wasn't translated from memory.
     bool valid = false;
 };
 
@@ -367,9 +396,10 @@ public:
 
     EEJitBlockRecord* lookup_cache[1024 * 32];
 
-    EEJitBlockRecord *insert_block(uint32_t PC, JitBlock* block);
+    EEJitBlockRecord *insert_block(uint32_t PC, JitBlock* block, uint8_t* mem = nullptr);
     void flush_all_blocks();
     void invalidate_ee_page(uint32_t page);
+    void invalidate_memory(uint8_t** tlb_map, const uint8_t* start, const uint8_t* end);
     EEJitBlockRecord *find_block(uint32_t PC);
 };
 
@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <zlib.h>
+#include "rewind.hpp"
+
+RewindBuffer::SnapshotBuf::SnapshotBuf() : output(nullptr)
+{
+
+}
+
+std::streamsize RewindBuffer::SnapshotBuf::xsputn(const char *s, std::streamsize count)
+{
+    output->insert(output->end(), (const uint8_t*)s, (const uint8_t*)s + count);
+    return count;
+}
+
+RewindBuffer::SnapshotBuf::int_type RewindBuffer::SnapshotBuf::overflow(int_type c)
+{
+    if (c != traits_type::eof())
+        output->push_back((uint8_t)c);
+    return traits_type::not_eof(c);
+}
+
+void RewindBuffer::SnapshotBuf::set_output(std::vector<uint8_t> *buffer)
+{
+    output = buffer;
+    setp(nullptr, nullptr);
+}
+
+void RewindBuffer::SnapshotBuf::set_input(std::vector<uint8_t> *buffer)
+{
+    char* data = (char*)buffer->data();
+    setg(data, data, data + buffer->size());
+}
+
+RewindBuffer::RewindBuffer() : budget(0), delta_bytes(0), out_stream(&out_buf), in_stream(&in_buf)
+{
+
+}
+
+void RewindBuffer::set_budget(uint64_t budget)
+{
+    if (budget < MIN_BUDGET)
+    {
+        printf("[Rewind] A budget of %llu MB is too small, using %llu MB\n",
+               (unsigned long long)(budget >> 20), (unsigned long long)(MIN_BUDGET >> 20));
+        budget = MIN_BUDGET;
+    }
+    this->budget = budget;
+    trim();
+}
+
+void RewindBuffer::clear()
+{
+    std::vector<uint8_t>().swap(current);
+    std::vector<uint8_t>().swap(next);
+    deltas.clear();
+    delta_bytes = 0;
+}
+
+std::ostream& RewindBuffer::begin_capture()
+{
+    //Snapshots are the same size more often than not, reserving avoids doubling the buffer while it fills
+    next.clear();
+    next.reserve(current.size());
+    out_buf.set_output(&next);
+    out_stream.clear();
+    return out_stream;
+}
+
+void RewindBuffer::end_capture()
+{
+    if (!current.empty())
+    {
+        deltas.emplace_back();
+        Delta& delta = deltas.back();
+        if (!make_delta(current, next, delta))
+        {
+            //Without a delta back to it, the current snapshot stays the newest
+            printf("[Rewind] Failed to compress a capture, dropping it\n");
+            deltas.pop_back();
+            next.clear();
+            return;
+        }
+        delta_bytes += get_delta_size(delta);
+    }
+    current.swap(next);
+    if (current.capacity() > current.size() + current.size() / 4)
+        current.shrink_to_fit();
+    trim();
+}
+
+uint64_t RewindBuffer::get_delta_size(const Delta &delta)
+{
+    return sizeof(Delta) + delta.pages.size() * sizeof(uint32_t) + delta.data.size();
+}
+
+bool RewindBuffer::make_delta(const std::vector<uint8_t> &older, const std::vector<uint8_t> &newer, Delta &delta)
+{
+    //Snapshots can differ in size, the shorter one reads as zeroes past its end
+    size_t size = std::max(older.size(), newer.size());
+    size_t common = std::min(older.size(), newer.size());
+    std::vector<uint8_t> raw;
+
+    delta.size = older.size();
+    for (size_t start = 0; start < size; start += PAGE_SIZE)
+    {
+        size_t len = std::min(PAGE_SIZE, size - start);
+        if (start + len <= common && !memcmp(&older[start], &newer[start], len))
+            continue;
+
+        delta.pages.push_back((uint32_t)(start / PAGE_SIZE));
+        size_t pos = raw.size();
+        raw.resize(pos + PAGE_SIZE);
+        for (size_t i = 0; i < PAGE_SIZE; i++)
+        {
+            uint8_t a = (start + i < older.size()) ? older[start + i] : 0;
+            uint8_t b = (start + i < newer.size()) ? newer[start + i] : 0;
+            raw[pos + i] = a ^ b;
+        }
+    }
+
+    delta.raw_size = raw.size();
+    if (raw.empty())
+        return true;
+
+    uLongf compressed_size = compressBound(raw.size());
+    delta.data.resize(compressed_size);
+    if (compress2(delta.data.data(), &compressed_size, raw.data(), raw.size(), Z_BEST_SPEED) != Z_OK)
+        return false;
+    delta.data.resize(compressed_size);
+    delta.data.shrink_to_fit();
+    delta.pages.shrink_to_fit();
+    return true;
+}
+
+bool RewindBuffer::apply_delta(const Delta &delta, std::vector<uint8_t> &snapshot)
+{
+    if (delta.pages.empty())
+    {
+        snapshot.resize(delta.size);
+        return true;
+    }
+
+    std::vector<uint8_t> raw(delta.raw_size);
+    uLongf raw_size = delta.raw_size;
+    if (uncompress(raw.data(), &raw_size, delta.data.data(), delta.data.size()) != Z_OK || raw_size != delta.raw_size)
+        return false;
+
+    size_t end = ((size_t)delta.pages.back() + 1) * PAGE_SIZE;
+    if (snapshot.size() < end)
+        snapshot.resize(end, 0);
+
+    const uint8_t* page_data = raw.data();
+    for (uint32_t page : delta.pages)
+    {
+        uint8_t* dest = &snapshot[(size_t)page * PAGE_SIZE];
+        for (size_t i = 0; i < PAGE_SIZE; i++)
+            dest[i] ^= page_data[i];
+        page_data += PAGE_SIZE;
+    }
+
+    snapshot.resize(delta.size);
+    return true;
+}
+
+void RewindBuffer::trim()
+{
+    while (!deltas.empty() && get_memory_usage() > budget)
+    {
+        Delta& oldest = deltas.front();
+        delta_bytes -= get_delta_size(oldest);
+        deltas.pop_front();
+    }
+}
+
+bool RewindBuffer::rewind(int steps)
+{
+    if (current.empty() || steps < 0 || (size_t)steps > deltas.size())
+        return false;
+
+    for (int i = 0; i < steps; i++)
+    {
+        Delta& delta = deltas.back();
+        if (!apply_delta(delta, current))
+        {
+            //The history can't be trusted past a broken delta
+            clear();
+            return false;
+        }
+
+        delta_bytes -= get_delta_size(delta);
+        deltas.pop_back();
+    }
+    return true;
+}
+
+std::istream& RewindBuffer::read_current()
+{
+    in_buf.set_input(&current);
+    in_stream.clear();
+    return in_stream;
+}
+
+int RewindBuffer::get_count()
+{
+    if (current.empty())
+        return 0;
+    return (int)deltas.size() + 1;
+}
+
+uint64_t RewindBuffer::get_memory_usage()
+{
+    return current.capacity() + next.capacity() + delta_bytes;
+}
@@ -0,0 +1,85 @@
+#ifndef REWIND_HPP
+#define REWIND_HPP
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+//In-memory history of save states for rewinding.
+//Only the newest snapshot is kept whole. Every older one is stored as the pages that differ from the
+//snapshot after it, XORed against it and deflated, so memory that didn't change between captures costs
+//next to nothing. Rewinding walks the deltas back from the newest snapshot.
+class RewindBuffer
+{
+    private:
+        constexpr static size_t PAGE_SIZE = 4096;
+
+        //A state is about 40 MB, mostly RAM and VRAM. Two of them are always held, anything less would keep no deltas
+        constexpr static uint64_t MIN_BUDGET = 128ULL * 1024 * 1024;
+
+        //Serializes straight into a snapshot, and deserializes straight out of one
+        class SnapshotBuf : public std::streambuf
+        {
+            private:
+                std::vector<uint8_t>* output;
+            protected:
+                std::streamsize xsputn(const char* s, std::streamsize count) override;
+                int_type overflow(int_type c) override;
+            public:
+                SnapshotBuf();
+
+                void set_output(std::vector<uint8_t>* buffer);
+                void set_input(std::vector<uint8_t>* buffer);
+        };
+
+        struct Delta
+        {
+            //Size of the older snapshot
+            uint64_t size;
+
+            std::vector<uint32_t> pages;
+            std::vector<uint8_t> data;
+            uint64_t raw_size;
+        };
+
+        uint64_t budget;
+        uint64_t delta_bytes;
+
+        std::vector<uint8_t> current, next;
+        std::deque<Delta> deltas;
+
+        SnapshotBuf out_buf, in_buf;
+        std::ostream out_stream;
+        std::istream in_stream;
+
+        static uint64_t get_delta_size(const Delta& delta);
+        bool make_delta(const std::vector<uint8_t>& older, const std::vector<uint8_t>& newer, Delta& delta);
+        bool apply_delta(const Delta& delta, std::vector<uint8_t>& snapshot);
+        void trim();
+    public:
+        RewindBuffer();
+
+        //Oldest snapshots are dropped once the whole history takes more than budget bytes. That includes
+        //the newest snapshot and the buffer the next capture goes into, roughly two full states.
+        //Budgets below MIN_BUDGET are raised to it
+        void set_budget(uint64_t budget);
+        void clear();
+
+        //Serialize a state into the returned stream, then call end_capture().
+        //A capture that can't be stored is dropped, leaving the history as it was
+        std::ostream& begin_capture();
+        void end_capture();
+
+        //Goes back steps captures from the newest, dropping everything newer. 0 is the newest capture
+        bool rewind(int steps);
+
+        //The newest snapshot, to deserialize a state from
+        std::istream& read_current();
+
+        int get_count();
+        uint64_t get_memory_usage();
+};
+
+#endif // REWIND_HPP
@@ -0,0 +1,333 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <zlib.h>
+#include "savestate.hpp"
+
+namespace SaveState
+{
+
+constexpr int DIRECTORY_ENTRY_SIZE = ID_LEN + 8 * 3 + 4 * 2;
+
+//Runs func(0) through func(count - 1) spread over the host's cores
+static void parallel_for(size_t count, const std::function<void(size_t)>& func)
+{
+    size_t worker_count = std::min((size_t)std::max(std::thread::hardware_concurrency(), 1u), count);
+    if (worker_count <= 1)
+    {
+        for (size_t i = 0; i < count; i++)
+            func(i);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]
+    {
+        for (size_t i = next++; i < count; i = next++)
+            func(i);
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < worker_count; i++)
+        workers.emplace_back(worker);
+    worker();
+    for (std::thread& t : workers)
+        t.join();
+}
+
+static uint32_t get_frame_count(uint64_t raw_size)
+{
+    return (uint32_t)((raw_size + FRAME_SIZE - 1) / FRAME_SIZE);
+}
+
+Writer::Writer(uint32_t major, uint32_t minor, uint32_t rev) : major(major), minor(minor), rev(rev)
+{
+
+}
+
+Writer::Chunk& Writer::add_chunk(const char *id)
+{
+    chunks.emplace_back();
+    Chunk& chunk = chunks.back();
+    memset(&chunk.entry, 0, sizeof(chunk.entry));
+    strncpy(chunk.entry.id, id, ID_LEN);
+    chunk.data = nullptr;
+    return chunk;
+}
+
+std::ostream& Writer::section(const char *id)
+{
+    return add_chunk(id).stream;
+}
+
+void Writer::block(const char *id, const void *data, uint64_t size)
+{
+    Chunk& chunk = add_chunk(id);
+    chunk.block_data.assign((const uint8_t*)data, (const uint8_t*)data + size);
+    chunk.data = chunk.block_data.data();
+    chunk.entry.raw_size = size;
+}
+
+void Writer::compress_chunks()
+{
+    struct Job
+    {
+        Chunk* chunk;
+        uint32_t frame;
+    };
+    std::vector<Job> jobs;
+
+    for (Chunk& chunk : chunks)
+    {
+        if (!chunk.data)
+        {
+            chunk.stream_data = chunk.stream.str();
+            chunk.data = (const uint8_t*)chunk.stream_data.data();
+            chunk.entry.raw_size = chunk.stream_data.size();
+        }
+
+        if (chunk.entry.raw_size < MIN_COMPRESS_SIZE)
+            continue;
+
+        chunk.entry.frame_count = get_frame_count(chunk.entry.raw_size);
+        chunk.frames.resize(chunk.entry.frame_count);
+        for (uint32_t i = 0; i < chunk.entry.frame_count; i++)
+            jobs.push_back({&chunk, i});
+    }
+
+    parallel_for(jobs.size(), [&](size_t i)
+    {
+        Chunk& chunk = *jobs[i].chunk;
+        uint64_t start = (uint64_t)jobs[i].frame * FRAME_SIZE;
+        uLong size = (uLong)std::min(FRAME_SIZE, chunk.entry.raw_size - start);
+
+        std::vector<uint8_t>& frame = chunk.frames[jobs[i].frame];
+        uLongf compressed_size = compressBound(size);
+        frame.resize(compressed_size);
+        if (compress2(frame.data(), &compressed_size, chunk.data + start, size, Z_BEST_SPEED) != Z_OK)
+            frame.clear();
+        else
+            frame.resize(compressed_size);
+    });
+
+    //Keep whatever didn't get any smaller as it is
+    for (Chunk& chunk : chunks)
+    {
+        if (chunk.frames.empty())
+            continue;
+
+        uint64_t stored_size = chunk.entry.frame_count * sizeof(uint32_t);
+        bool failed = false;
+        for (std::vector<uint8_t>& frame : chunk.frames)
+        {
+            stored_size += frame.size();
+            failed |= frame.empty();
+        }
+
+        if (failed || stored_size >= chunk.entry.raw_size)
+        {
+            chunk.frames.clear();
+            chunk.entry.frame_count = 0;
+            continue;
+        }
+
+        chunk.entry.flags |= CHUNK_DEFLATE;
+        chunk.entry.stored_size = stored_size;
+    }
+}
+
+bool Writer::write(const std::string &file_name)
+{
+    compress_chunks();
+
+    std::ofstream file(file_name, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    uint32_t chunk_count = (uint32_t)chunks.size();
+    file.write("DOBIE", 5);
+    file.write((char*)&major, sizeof(major));
+    file.write((char*)&minor, sizeof(minor));
+    file.write((char*)&rev, sizeof(rev));
+    file.write(CONTAINER_TAG, sizeof(CONTAINER_TAG));
+    file.write((char*)&CONTAINER_VERSION, sizeof(CONTAINER_VERSION));
+    file.write((char*)&chunk_count, sizeof(chunk_count));
+
+    uint64_t offset = (uint64_t)file.tellp() + chunk_count * DIRECTORY_ENTRY_SIZE;
+    for (Chunk& chunk : chunks)
+    {
+        ChunkEntry& entry = chunk.entry;
+        if (!(entry.flags & CHUNK_DEFLATE))
+            entry.stored_size = entry.raw_size;
+        entry.offset = offset;
+        offset += entry.stored_size;
+
+        file.write(entry.id, ID_LEN);
+        file.write((char*)&entry.offset, sizeof(entry.offset));
+        file.write((char*)&entry.stored_size, sizeof(entry.stored_size));
+        file.write((char*)&entry.raw_size, sizeof(entry.raw_size));
+        file.write((char*)&entry.flags, sizeof(entry.flags));
+        file.write((char*)&entry.frame_count, sizeof(entry.frame_count));
+    }
+
+    for (Chunk& chunk : chunks)
+    {
+        if (chunk.entry.flags & CHUNK_DEFLATE)
+        {
+            for (std::vector<uint8_t>& frame : chunk.frames)
+            {
+                uint32_t frame_size = (uint32_t)frame.size();
+                file.write((char*)&frame_size, sizeof(frame_size));
+            }
+            for (std::vector<uint8_t>& frame : chunk.frames)
+                file.write((char*)frame.data(), frame.size());
+        }
+        else
+            file.write((char*)chunk.data, chunk.entry.raw_size);
+    }
+
+    return file.good();
+}
+
+bool Reader::open(std::ifstream &&file)
+{
+    this->file = std::move(file);
+    directory.clear();
+    chunk_data.clear();
+    sections.clear();
+
+    char tag[sizeof(CONTAINER_TAG)];
+    uint32_t version, chunk_count;
+    this->file.read(tag, sizeof(tag));
+    this->file.read((char*)&version, sizeof(version));
+    this->file.read((char*)&chunk_count, sizeof(chunk_count));
+    if (!this->file || memcmp(tag, CONTAINER_TAG, sizeof(tag)) || version > CONTAINER_VERSION)
+        return false;
+
+    for (uint32_t i = 0; i < chunk_count; i++)
+    {
+        ChunkEntry entry;
+        this->file.read(entry.id, ID_LEN);
+        this->file.read((char*)&entry.offset, sizeof(entry.offset));
+        this->file.read((char*)&entry.stored_size, sizeof(entry.stored_size));
+        this->file.read((char*)&entry.raw_size, sizeof(entry.raw_size));
+        this->file.read((char*)&entry.flags, sizeof(entry.flags));
+        this->file.read((char*)&entry.frame_count, sizeof(entry.frame_count));
+        if (!this->file)
+            return false;
+
+        directory[std::string(entry.id, strnlen(entry.id, ID_LEN))] = entry;
+    }
+    return true;
+}
+
+bool Reader::has(const char *id)
+{
+    return directory.count(id);
+}
+
+uint64_t Reader::get_size(const char *id)
+{
+    auto it = directory.find(id);
+    if (it == directory.end())
+        return 0;
+    return it->second.raw_size;
+}
+
+bool Reader::read_chunks()
+{
+    struct Job
+    {
+        uint8_t* dest;
+        uLongf size;
+        const uint8_t* src;
+        uLong src_size;
+    };
+    std::vector<Job> jobs;
+    std::list<std::vector<uint8_t>> compressed_chunks;
+
+    file.clear();
+    file.seekg(0, std::ios::end);
+    uint64_t file_size = file.tellg();
+
+    //All of the file is read on this thread, only decompression is spread over the host's cores
+    for (auto& it : directory)
+    {
+        const ChunkEntry& entry = it.second;
+        if (entry.offset > file_size || entry.stored_size > file_size - entry.offset)
+            return false;
+
+        std::string& data = chunk_data[it.first];
+        data.resize(entry.raw_size);
+        file.seekg(entry.offset);
+        if (!(entry.flags & CHUNK_DEFLATE))
+        {
+            if (entry.stored_size != entry.raw_size || !file.read(&data[0], entry.raw_size))
+                return false;
+            continue;
+        }
+
+        if (entry.frame_count != get_frame_count(entry.raw_size) ||
+            entry.stored_size < entry.frame_count * sizeof(uint32_t))
+            return false;
+
+        std::vector<uint32_t> frame_sizes(entry.frame_count);
+        file.read((char*)frame_sizes.data(), entry.frame_count * sizeof(uint32_t));
+
+        uint64_t compressed_size = 0;
+        for (uint32_t size : frame_sizes)
+            compressed_size += size;
+        if (!file || compressed_size + entry.frame_count * sizeof(uint32_t) != entry.stored_size)
+            return false;
+
+        compressed_chunks.emplace_back(compressed_size);
+        std::vector<uint8_t>& compressed = compressed_chunks.back();
+        if (!file.read((char*)compressed.data(), compressed_size))
+            return false;
+
+        uint64_t offset = 0;
+        for (uint32_t i = 0; i < entry.frame_count; i++)
+        {
+            uint64_t start = (uint64_t)i * FRAME_SIZE;
+            jobs.push_back({(uint8_t*)&data[start], (uLongf)std::min(FRAME_SIZE, entry.raw_size - start),
+                            compressed.data() + offset, frame_sizes[i]});
+            offset += frame_sizes[i];
+        }
+    }
+
+    std::atomic<bool> ok(true);
+    parallel_for(jobs.size(), [&](size_t i)
+    {
+        uLongf size = jobs[i].size;
+        if (uncompress(jobs[i].dest, &size, jobs[i].src, jobs[i].src_size) != Z_OK || size != jobs[i].size)
+            ok = false;
+    });
+    return ok;
+}
+
+std::istream& Reader::section(const char *id)
+{
+    auto it = chunk_data.find(id);
+    if (it == chunk_data.end())
+    {
+        //An empty stream makes every read from it fail
+        sections.emplace_back();
+        sections.back().setstate(std::ios::failbit);
+    }
+    else
+        sections.emplace_back(it->second);
+    return sections.back();
+}
+
+bool Reader::block(const char *id, void *dest, uint64_t size)
+{
+    auto it = chunk_data.find(id);
+    if (it == chunk_data.end() || it->second.size() != size)
+        return false;
+    memcpy(dest, it->second.data(), size);
+    return true;
+}
+
+};
@@ -0,0 +1,99 @@
+#ifndef SAVESTATE_HPP
+#define SAVESTATE_HPP
+#include <cstdint>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//Save states are a chunked container. After the usual "DOBIE" signature and version comes a directory
+//of chunks, one per subsystem section, followed by the chunk data. Large chunks are split into frames
+//that are deflated independently, so that they can be compressed and decompressed in parallel.
+namespace SaveState
+{
+    constexpr char CONTAINER_TAG[4] = {'C', 'H', 'N', 'K'};
+    constexpr uint32_t CONTAINER_VERSION = 1;
+    constexpr int ID_LEN = 8;
+
+    //Chunks smaller than this are stored as-is
+    constexpr uint64_t MIN_COMPRESS_SIZE = 4096;
+    constexpr uint64_t FRAME_SIZE = 1024 * 1024;
+
+    enum CHUNK_FLAGS
+    {
+        CHUNK_DEFLATE = 1 << 0
+    };
+
+    struct ChunkEntry
+    {
+        char id[ID_LEN];
+        uint64_t offset;
+        uint64_t stored_size;
+        uint64_t raw_size;
+        uint32_t flags;
+        uint32_t frame_count;
+    };
+
+    class Writer
+    {
+        private:
+            struct Chunk
+            {
+                ChunkEntry entry;
+
+                //Points either at a copied block or at the section serialized into stream
+                const uint8_t* data;
+                std::vector<uint8_t> block_data;
+                std::ostringstream stream;
+                std::string stream_data;
+
+                std::vector<std::vector<uint8_t>> frames;
+            };
+
+            uint32_t major, minor, rev;
+            std::list<Chunk> chunks;
+
+            Chunk& add_chunk(const char* id);
+            void compress_chunks();
+        public:
+            Writer(uint32_t major, uint32_t minor, uint32_t rev);
+
+            //The stream to serialize a section into
+            std::ostream& section(const char* id);
+
+            //Copies size bytes at data, so the memory is free to change as soon as this returns
+            void block(const char* id, const void* data, uint64_t size);
+
+            //Only touches memory owned by the writer, so it is safe to call from another thread
+            bool write(const std::string& file_name);
+    };
+
+    class Reader
+    {
+        private:
+            std::ifstream file;
+            std::unordered_map<std::string, ChunkEntry> directory;
+            std::unordered_map<std::string, std::string> chunk_data;
+            std::list<std::istringstream> sections;
+        public:
+            //file must be positioned right after the version. Returns false if no chunk directory follows
+            bool open(std::ifstream&& file);
+
+            bool has(const char* id);
+            uint64_t get_size(const char* id);
+
+            //Reads and decompresses every chunk up front, so that a broken state is caught before any of it is loaded.
+            //Returns false if any chunk is truncated or fails to decompress
+            bool read_chunks();
+
+            //The stream to deserialize a section from. Stays valid as long as the reader
+            std::istream& section(const char* id);
+
+            bool block(const char* id, void* dest, uint64_t size);
+    };
+};
+
+#endif // SAVESTATE_HPP
@@ -26,19 +26,21 @@ void Scheduler::reset()
 
     closest_event_time = TimestampLimit::max();
 
-    events.clear();
+    event_pool.clear();
+    event_heap_pos.clear();
+    free_event_slots.clear();
+    event_heap.clear();
     timers.clear();
 
     timer_event_id = register_function([this] (uint64_t param) { timer_event(param);});
 }
 
-unsigned int Scheduler::calculate_run_cycles()
+unsigned int Scheduler::calculate_run_cycles(int max_cycles)
 {
-    if (!events.size())
+    if (!event_heap.size())
         Errors::die("[Scheduler] No events registered");
-    const static int MAX_CYCLES = 32;
-    if (ee_cycles.count + MAX_CYCLES <= closest_event_time)
-        run_cycles = MAX_CYCLES;
+    if (ee_cycles.count + max_cycles <= closest_event_time)
+        run_cycles = max_cycles;
     else
     {
         int64_t delta = closest_event_time - ee_cycles.count;
@@ -87,33 +89,175 @@ uint64_t Scheduler::add_event(int func_id, uint64_t delta, uint64_t param)
 {
     if (func_id < 0 || func_id >= registered_funcs.size())
         Errors::die("[Scheduler] Out-of-bounds func_id given in add_event");
-    SchedulerEvent event;
+    int slot = alloc_event_slot();
+    SchedulerEvent& event = event_pool[slot];
     event.func_id = func_id;
     event.time_to_run = ee_cycles.count + delta;
     event.param = param;
-    event.event_id = next_event_id;
+    event.event_id = (next_event_id << EVENT_SLOT_BITS) | slot;
+    event.pulse = false;
 
     next_event_id++;
 
     closest_event_time = std::min(event.time_to_run, closest_event_time);
 
-    events.push_back(event);
+    event_heap_pos[slot] = event_heap.size();
+    event_heap.push_back(slot);
+    heap_sift_up(event_heap.size() - 1);
 
     return event.event_id;
 }
 
 void Scheduler::delete_event(uint64_t event_id)
 {
-    for (auto it = events.begin(); it != events.end(); it++)
+    int slot = get_event_slot(event_id);
+    if (slot < 0)
+        Errors::die("[Scheduler] No event ID %lld found in delete_event", event_id);
+
+    //An event that is currently firing is released once its function returns
+    if (event_heap_pos[slot] < 0)
+        return;
+
+    heap_remove(event_heap_pos[slot]);
+    free_event_slot(slot);
+    update_closest_event_time();
+}
+
+void Scheduler::delete_events(int func_id)
+{
+    std::vector<int> slots;
+    for (int slot : event_heap)
     {
-        if (it->event_id == event_id)
-        {
-            events.erase(it);
-            return;
-        }
+        if (event_pool[slot].func_id == func_id)
+            slots.push_back(slot);
+    }
+
+    for (int slot : slots)
+    {
+        heap_remove(event_heap_pos[slot]);
+        free_event_slot(slot);
+    }
+    update_closest_event_time();
+}
+
+int Scheduler::alloc_event_slot()
+{
+    if (free_event_slots.size())
+    {
+        int slot = free_event_slots.back();
+        free_event_slots.pop_back();
+        return slot;
     }
 
-    Errors::die("[Scheduler] No event ID %lld found in delete_event", event_id);
+    if (event_pool.size() > EVENT_SLOT_MASK)
+        Errors::die("[Scheduler] Too many events pending");
+
+    event_pool.emplace_back();
+    event_heap_pos.push_back(-1);
+    return event_pool.size() - 1;
+}
+
+void Scheduler::free_event_slot(int slot)
+{
+    event_pool[slot].event_id = ~0ULL;
+    free_event_slots.push_back(slot);
+}
+
+//Returns -1 if the ID doesn't belong to a live event
+int Scheduler::get_event_slot(uint64_t event_id)
+{
+    uint64_t slot = event_id & EVENT_SLOT_MASK;
+    if (slot >= event_pool.size() || event_pool[slot].event_id != event_id)
+        return -1;
+    return (int)slot;
+}
+
+bool Scheduler::event_before(int slot_a, int slot_b)
+{
+    const SchedulerEvent& a = event_pool[slot_a];
+    const SchedulerEvent& b = event_pool[slot_b];
+    if (a.time_to_run != b.time_to_run)
+        return a.time_to_run < b.time_to_run;
+    return a.event_id < b.event_id;
+}
+
+void Scheduler::heap_sift_up(int pos)
+{
+    int slot = event_heap[pos];
+    while (pos > 0)
+    {
+        int parent = (pos - 1) / 2;
+        if (!event_before(slot, event_heap[parent]))
+            break;
+        event_heap[pos] = event_heap[parent];
+        event_heap_pos[event_heap[pos]] = pos;
+        pos = parent;
+    }
+    event_heap[pos] = slot;
+    event_heap_pos[slot] = pos;
+}
+
+void Scheduler::heap_sift_down(int pos)
+{
+    int size = event_heap.size();
+    int slot = event_heap[pos];
+    while (true)
+    {
+        int child = pos * 2 + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && event_before(event_heap[child + 1], event_heap[child]))
+            child++;
+        if (!event_before(event_heap[child], slot))
+            break;
+        event_heap[pos] = event_heap[child];
+        event_heap_pos[event_heap[pos]] = pos;
+        pos = child;
+    }
+    event_heap[pos] = slot;
+    event_heap_pos[slot] = pos;
+}
+
+//Takes an event out of the heap without releasing its slot
+void Scheduler::heap_remove(int pos)
+{
+    int slot = event_heap[pos];
+    int last = event_heap.back();
+    event_heap.pop_back();
+    event_heap_pos[slot] = -1;
+
+    if (pos < event_heap.size())
+    {
+        event_heap[pos] = last;
+        event_heap_pos[last] = pos;
+        heap_sift_up(pos);
+        heap_sift_down(event_heap_pos[last]);
+    }
+}
+
+void Scheduler::update_closest_event_time()
+{
+    if (event_heap.size())
+        closest_event_time = event_pool[event_heap[0]].time_to_run;
+    else
+        closest_event_time = TimestampLimit::max();
+}
+
+void Scheduler::set_event_time(uint64_t event_id, int64_t time)
+{
+    int slot = get_event_slot(event_id);
+    if (slot < 0)
+        Errors::die("[Scheduler] No event ID %lld found in set_event_time", event_id);
+
+    event_pool[slot].time_to_run = time;
+
+    //A firing event isn't in the heap, and is released once its function returns
+    if (event_heap_pos[slot] < 0)
+        return;
+
+    heap_sift_up(event_heap_pos[slot]);
+    heap_sift_down(event_heap_pos[slot]);
+    update_closest_event_time();
 }
 
 uint64_t Scheduler::convert_to_ee_cycles(uint64_t cycles, uint64_t clockrate)
@@ -148,9 +292,7 @@ int64_t Scheduler::calculate_timer_event_delta(uint64_t timer_id)
 void Scheduler::update_timer_event_time(uint64_t timer_id)
 {
     int64_t time = ee_cycles.count + calculate_timer_event_delta(timer_id);
-    SchedulerEvent* event = get_event_ptr(timers[timer_id].event_id);
-    event->time_to_run = time;
-    closest_event_time = std::min(time, closest_event_time);
+    set_event_time(timers[timer_id].event_id, time);
 }
 
 void Scheduler::update_timer_counter(uint64_t timer_id)
@@ -202,17 +344,6 @@ void Scheduler::timer_event(uint64_t index)
     restart_timer(index);
 }
 
-SchedulerEvent* Scheduler::get_event_ptr(uint64_t event_id)
-{
-    for (auto it = events.begin(); it != events.end(); it++)
-    {
-        if (it->event_id == event_id)
-            return &(*it);
-    }
-
-    Errors::die("[Scheduler] No event ID %lld found in get_event_ptr", event_id);
-}
-
 uint64_t Scheduler::create_timer(int callback_id, uint64_t overflow_mask, uint64_t param)
 {
     if (callback_id < 0 || callback_id >= timer_callbacks.size())
@@ -258,8 +389,7 @@ void Scheduler::set_timer_pause(uint64_t timer_id, bool paused)
     if (paused)
     {
         update_timer_counter(timer_id);
-        SchedulerEvent* event = get_event_ptr(timers[timer_id].event_id);
-        event->time_to_run = TimestampLimit::max();
+        set_event_time(timers[timer_id].event_id, TimestampLimit::max());
     }
     else
     {
@@ -329,21 +459,19 @@ void Scheduler::process_events()
 {
     if (ee_cycles.count >= closest_event_time)
     {
-        int64_t new_time = 0x7FFFFFFFULL << 32ULL;
-        for (auto it = events.begin(); it != events.end(); )
+        int64_t fire_time = closest_event_time;
+        while (event_heap.size() && event_pool[event_heap[0]].time_to_run <= fire_time)
         {
-            if (it->time_to_run <= closest_event_time)
-            {
-                std::function<void(uint64_t)> func = registered_funcs[it->func_id];
-                func(it->param);
-                it = events.erase(it);
-            }
-            else
-            {
-                new_time = std::min(it->time_to_run, new_time);
-                it++;
-            }
+            //The event stays allocated while it fires so that its function can still look it up
+            int slot = event_heap[0];
+            heap_remove(0);
+
+            int func_id = event_pool[slot].func_id;
+            uint64_t param = event_pool[slot].param;
+            registered_funcs[func_id](param);
+
+            free_event_slot(slot);
         }
-        closest_event_time = new_time;
+        update_closest_event_time();
     }
 }
@@ -2,7 +2,6 @@
 #define SCHEDULER_HPP
 #include <cstdint>
 #include <functional>
-#include <list>
 #include <vector>
 
 struct CycleCount
@@ -45,10 +44,28 @@ class Scheduler
         std::vector<std::function<void(uint64_t)> > registered_funcs;
         std::vector<std::function<void(uint64_t, bool)> > timer_callbacks;
         std::vector<SchedulerTimer> timers;
-        std::list<SchedulerEvent> events;
+
+        //Events live in a pool of slots, and a binary min-heap of slot indices orders them by time to run.
+        //The low bits of an event ID hold its slot, the high bits a sequence number that breaks ties in insertion order.
+        std::vector<SchedulerEvent> event_pool;
+        std::vector<int> event_heap_pos;
+        std::vector<int> free_event_slots;
+        std::vector<int> event_heap;
 
         int64_t closest_event_time;
 
+        constexpr static int EVENT_SLOT_BITS = 16;
+        constexpr static uint64_t EVENT_SLOT_MASK = (1 << EVENT_SLOT_BITS) - 1;
+
+        bool event_before(int slot_a, int slot_b);
+        void heap_sift_up(int pos);
+        void heap_sift_down(int pos);
+        void heap_remove(int pos);
+        void update_closest_event_time();
+        int alloc_event_slot();
+        void free_event_slot(int slot);
+        int get_event_slot(uint64_t event_id);
+
         uint64_t convert_to_ee_cycles(uint64_t cycles, uint64_t clockrate);
 
         int64_t calculate_timer_event_delta(uint64_t timer_id);
@@ -56,18 +73,19 @@ class Scheduler
         void update_timer_counter(uint64_t timer_id);
 
         void timer_event(uint64_t index);
-
-        SchedulerEvent* get_event_ptr(uint64_t event_id);
     public:
         constexpr static uint64_t EE_CLOCKRATE = 294912000; //294.912 MHz
         constexpr static uint64_t BUS_CLOCKRATE = EE_CLOCKRATE / 2;
         constexpr static uint64_t IOP_CLOCKRATE = EE_CLOCKRATE / 8;
 
+        //Longest slice the EE runs for while other components need to stay close to it
+        constexpr static int DEFAULT_RUN_CYCLES = 32;
+
         Scheduler();
 
         void reset();
 
-        unsigned int calculate_run_cycles();
+        unsigned int calculate_run_cycles(int max_cycles = DEFAULT_RUN_CYCLES);
         unsigned int get_bus_run_cycles();
         unsigned int get_iop_run_cycles();
 
@@ -79,6 +97,10 @@ class Scheduler
 
         uint64_t add_event(int func_id, uint64_t delta, uint64_t param = 0);
         void delete_event(uint64_t event_id);
+        //Drops every pending event of a function, for owners that lost track of their event IDs
+        void delete_events(int func_id);
+        //Moves a pending event to an absolute EE cycle
+        void set_event_time(uint64_t event_id, int64_t time);
 
         uint64_t create_timer(int func_id, uint64_t overflow_mask, uint64_t param = 0);
         void restart_timer(uint64_t timer_id);
@@ -93,8 +115,8 @@ class Scheduler
         void update_cycle_counts();
         void process_events();
 
-        void load_state(std::ifstream& state);
-        void save_state(std::ofstream& state);
+        void load_state(std::istream& state);
+        void save_state(std::ostream& state);
 };
 
 inline int64_t Scheduler::get_ee_cycles()
@@ -1,13 +1,37 @@
+#include <algorithm>
 #include <fstream>
 #include <cstring>
+#include <sstream>
 #include "emulator.hpp"
+#include "savestate.hpp"
+#include "ee/ee_jit.hpp"
+#include "iop/iop_jit.hpp"
 
 #define VER_MAJOR 0
 #define VER_MINOR 0
-#define VER_REV 50
+#define VER_REV 53
+
+//Revisions before 53 were one uncompressed stream of sections, which can still be loaded.
+//51 added the GS thread's GIF packet state, and 52 the cycle of the last rendered sound sample
+#define VER_REV_OLDEST_STREAM 50
+#define VER_REV_LAST_STREAM 52
 
 using namespace std;
 
+//Chunks every state has to have, in load order. Blocks of memory have a fixed size, sections are 0
+static const struct
+{
+    const char* id;
+    uint64_t block_size;
+} STATE_CHUNKS[] =
+{
+    {"EMU", 0}, {"RDRAM", 1024 * 1024 * 32}, {"IOPRAM", 1024 * 1024 * 2}, {"SPURAM", 1024 * 1024 * 2},
+    {"SCRATCH", 0}, {"EE", 0}, {"COP0", 0}, {"FPU", 0}, {"IOP", 0}, {"VU0", 0}, {"VU1", 0},
+    {"INTC", 0}, {"IOPINTC", 0}, {"TIMERS", 0}, {"IOPTMR", 0}, {"DMAC", 0}, {"IOPDMA", 0},
+    {"GIF", 0}, {"SIF", 0}, {"VIF0", 0}, {"VIF1", 0}, {"CDVD", 0}, {"GS", 0},
+    {"SCHED", 0}, {"PAD", 0}, {"SPU", 0}, {"SPU2", 0}
+};
+
 bool Emulator::request_load_state(const char *file_name)
 {
     ifstream state(file_name, ios::binary);
@@ -33,6 +57,9 @@ bool Emulator::request_save_state(const char *file_name)
 void Emulator::load_state(const char *file_name)
 {
     load_requested = false;
+
+    //The state being loaded may still be on its way to the disk
+    finish_save_state();
     printf("[Emulator] Loading state...\n");
     ifstream state(file_name, ios::binary);
     if (!state.is_open())
@@ -56,145 +83,358 @@ void Emulator::load_state(const char *file_name)
     state.read((char*)&minor, sizeof(minor));
     state.read((char*)&rev, sizeof(rev));
 
-    if (major != VER_MAJOR || minor != VER_MINOR || rev != VER_REV)
+    bool stream = major == VER_MAJOR && minor == VER_MINOR &&
+                  rev >= VER_REV_OLDEST_STREAM && rev <= VER_REV_LAST_STREAM;
+    if (!stream && (major != VER_MAJOR || minor != VER_MINOR || rev != VER_REV))
     {
         state.close();
         Errors::non_fatal("Save state doesn't match version");
         return;
     }
 
-    reset();
-
-    //Emulator info
-    state.read((char*)&VBLANK_sent, sizeof(VBLANK_sent));
-    state.read((char*)&frames, sizeof(frames));
+    if (stream)
+    {
+        load_stream_state(state, rev);
+        return;
+    }
 
-    //RAM
-    state.read((char*)RDRAM, 1024 * 1024 * 32);
-    state.read((char*)IOP_RAM, 1024 * 1024 * 2);
-    state.read((char*)SPU_RAM, 1024 * 1024 * 2);
-    state.read((char*)scratchpad, 1024 * 16);
-    state.read((char*)iop_scratchpad, 1024);
-    state.read((char*)&iop_scratchpad_start, sizeof(iop_scratchpad_start));
+    //Everything is read and checked before the first section is loaded, so a broken state leaves the emulator alone
+    SaveState::Reader reader;
+    if (!reader.open(std::move(state)))
+    {
+        Errors::non_fatal("Save state invalid");
+        return;
+    }
 
-    //CPUs
-    cpu.load_state(state);
-    cp0.load_state(state);
-    fpu.load_state(state);
-    iop.load_state(state);
-    vu0.load_state(state);
-    vu1.load_state(state);
+    for (auto& chunk : STATE_CHUNKS)
+    {
+        if (!reader.has(chunk.id) || (chunk.block_size && reader.get_size(chunk.id) != chunk.block_size))
+        {
+            Errors::non_fatal("Save state is incomplete");
+            return;
+        }
+    }
 
-    //Interrupt registers
-    intc.load_state(state);
-    iop_intc.load_state(state);
+    if (!reader.read_chunks())
+    {
+        Errors::non_fatal("Save state is corrupted");
+        return;
+    }
 
-    //Timers
-    timers.load_state(state);
-    iop_timers.load_state(state);
+    load_sections([&](const char* id) -> istream& { return reader.section(id); },
+                  [&](const char* id, void* data, uint64_t size) { reader.block(id, data, size); }, rev);
 
-    //DMA
-    dmac.load_state(state);
-    iop_dma.load_state(state);
+    //The history leads up to a different point in time
+    clear_rewind_history();
+    printf("[Emulator] Success!\n");
+}
 
-    //"Interfaces"
-    gif.load_state(state);
-    sif.load_state(state);
-    vif0.load_state(state);
-    vif1.load_state(state);
+//Stream states hold the very same sections back to back. Nothing says where they end, so a truncated one
+//only shows once it has been loaded. The current state is kept in memory to go back to in that case
+void Emulator::load_stream_state(ifstream &file, uint32_t rev)
+{
+    stringstream data;
+    data << file.rdbuf();
+    if (!data)
+    {
+        Errors::non_fatal("Failed to load save state");
+        return;
+    }
 
-    //CDVD
-    cdvd.load_state(state);
+    stringstream backup;
+    save_sections([&](const char*) -> ostream& { return backup; },
+                  [&](const char*, const void* mem, uint64_t size) { backup.write((const char*)mem, size); });
 
-    //GS
-    //Important note - this serialization function is located in gs.cpp as it contains a lot of thread-specific details
-    gs.load_state(state);
+    load_sections([&](const char*) -> istream& { return data; },
+                  [&](const char*, void* mem, uint64_t size) { data.read((char*)mem, size); }, rev);
 
-    scheduler.load_state(state);
-    pad.load_state(state);
-    spu.load_state(state);
-    spu2.load_state(state);
+    if (!data)
+    {
+        load_sections([&](const char*) -> istream& { return backup; },
+                      [&](const char*, void* mem, uint64_t size) { backup.read((char*)mem, size); }, VER_REV);
+        Errors::non_fatal("Save state is corrupted");
+        return;
+    }
 
-    state.close();
+    clear_rewind_history();
     printf("[Emulator] Success!\n");
 }
 
 void Emulator::save_state(const char *file_name)
 {
     save_requested = false;
+    finish_save_state();
     printf("[Emulator] Saving state...\n");
-    ofstream state(file_name, ios::binary);
-    if (!state.is_open())
+
+    //Only the snapshot is taken here, compressing and writing it happens on save_thread
+    std::unique_ptr<SaveState::Writer> writer(new SaveState::Writer(VER_MAJOR, VER_MINOR, VER_REV));
+
+    save_sections([&](const char* id) -> ostream& { return writer->section(id); },
+                  [&](const char* id, const void* data, uint64_t size) { writer->block(id, data, size); });
+
+    std::string path = file_name;
+    save_thread = std::thread([this, path](std::unique_ptr<SaveState::Writer> writer)
     {
-        Errors::non_fatal("Failed to save state");
+        if (writer->write(path))
+            printf("[Emulator] Saved state to %s\n", path.c_str());
+        else
+            save_failed = true;
+    }, std::move(writer));
+}
+
+void Emulator::finish_save_state()
+{
+    if (save_thread.joinable())
+        save_thread.join();
+}
+
+void Emulator::set_rewind(int interval, uint64_t budget)
+{
+    rewind_interval_setting = interval;
+    rewind_budget_setting = budget;
+    rewind_settings_changed = true;
+}
+
+void Emulator::request_rewind(int steps)
+{
+    rewind_steps = steps;
+    rewind_requested = true;
+}
+
+int Emulator::get_rewind_count()
+{
+    return rewind_count;
+}
+
+void Emulator::update_rewind_settings()
+{
+    if (rewind_settings_changed.exchange(false))
+    {
+        rewind_interval = rewind_interval_setting;
+        rewind_countdown = rewind_interval;
+        rewind_buffer.set_budget(rewind_budget_setting);
+        if (!rewind_interval)
+            rewind_clear_requested = true;
+    }
+
+    if (rewind_clear_requested.exchange(false))
+        clear_rewind_history();
+}
+
+void Emulator::clear_rewind_history()
+{
+    rewind_buffer.clear();
+    rewind_countdown = rewind_interval;
+    rewind_count = 0;
+}
+
+//Rewind snapshots are the sections back to back, like stream states
+void Emulator::capture_rewind_state()
+{
+    rewind_countdown = rewind_interval;
+    ostream& state = rewind_buffer.begin_capture();
+    save_sections([&](const char*) -> ostream& { return state; },
+                  [&](const char*, const void* data, uint64_t size) { state.write((const char*)data, size); });
+    rewind_buffer.end_capture();
+    rewind_count = rewind_buffer.get_count();
+}
+
+//Reads a block of memory over the current contents a page at a time, noting the offsets of the pages that changed
+static void restore_block(istream& state, uint8_t* mem, uint64_t size, vector<uint32_t>& changed_pages)
+{
+    uint8_t page[4096];
+    for (uint64_t offset = 0; offset < size; offset += sizeof(page))
+    {
+        size_t len = (size_t)min<uint64_t>(sizeof(page), size - offset);
+        state.read((char*)page, len);
+        if (memcmp(mem + offset, page, len))
+        {
+            memcpy(mem + offset, page, len);
+            changed_pages.push_back((uint32_t)offset);
+        }
+    }
+}
+
+void Emulator::rewind_state()
+{
+    rewind_requested = false;
+    rewind_countdown = rewind_interval;
+    bool rewound = rewind_buffer.rewind(rewind_steps);
+    rewind_count = rewind_buffer.get_count();
+    if (!rewound)
+    {
+        printf("[Emulator] Can't rewind %d captures back\n", (int)rewind_steps);
         return;
     }
 
-    uint32_t major = VER_MAJOR;
-    uint32_t minor = VER_MINOR;
-    uint32_t rev = VER_REV;
+    //The translated code is kept, except for what came from memory that the snapshot changes
+    vector<uint32_t> RDRAM_changes, IOP_RAM_changes, SPU_RAM_changes;
+    uint8_t old_scratchpad[sizeof(scratchpad)];
+    memcpy(old_scratchpad, scratchpad, sizeof(scratchpad));
+
+    istream& state = rewind_buffer.read_current();
+    load_sections([&](const char*) -> istream& { return state; },
+                  [&](const char*, void* data, uint64_t size)
+                  {
+                      vector<uint32_t>& changes = (data == RDRAM) ? RDRAM_changes :
+                                                  (data == IOP_RAM) ? IOP_RAM_changes : SPU_RAM_changes;
+                      restore_block(state, (uint8_t*)data, size, changes);
+                  }, VER_REV, true);
+
+    //Runs of changed pages are dropped at once, as each call goes through every page of translated EE code
+    for (size_t i = 0; i < RDRAM_changes.size();)
+    {
+        size_t end = i + 1;
+        while (end < RDRAM_changes.size() && RDRAM_changes[end] == RDRAM_changes[end - 1] + 4096)
+            end++;
+        EE_JIT::invalidate(&cpu, RDRAM + RDRAM_changes[i], (end - i) * 4096);
+        i = end;
+    }
+
+    //This also drops the code of virtual pages that are mapped elsewhere now, even if no memory changed
+    bool scratchpad_changed = memcmp(old_scratchpad, scratchpad, sizeof(scratchpad)) != 0;
+    EE_JIT::invalidate(&cpu, scratchpad, scratchpad_changed ? sizeof(scratchpad) : 0);
+
+    for (uint32_t offset : IOP_RAM_changes)
+        IOP_JIT::invalidate(offset, 4096);
 
-    //Sanity check and version
-    state << "DOBIE";
-    state.write((char*)&major, sizeof(uint32_t));
-    state.write((char*)&minor, sizeof(uint32_t));
-    state.write((char*)&rev, sizeof(uint32_t));
+    printf("[Emulator] Rewound %d captures\n", (int)rewind_steps);
+}
+
+void Emulator::load_sections(const function<istream&(const char*)>& section,
+                             const function<void(const char*, void*, uint64_t)>& block, uint32_t rev,
+                             bool rewinding)
+{
+    if (rewinding)
+    {
+        reset_hardware(true);
+        EE_JIT::reset(false);
+    }
+    else
+        reset();
 
     //Emulator info
-    state.write((char*)&VBLANK_sent, sizeof(VBLANK_sent));
-    state.write((char*)&frames, sizeof(frames));
+    istream& info = section("EMU");
+    info.read((char*)&VBLANK_sent, sizeof(VBLANK_sent));
+    info.read((char*)&frames, sizeof(frames));
+    if (rev >= 52)
+        info.read((char*)&sound_sample_cycles, sizeof(sound_sample_cycles));
 
     //RAM
-    state.write((char*)RDRAM, 1024 * 1024 * 32);
-    state.write((char*)IOP_RAM, 1024 * 1024 * 2);
-    state.write((char*)SPU_RAM, 1024 * 1024 * 2);
-    state.write((char*)scratchpad, 1024 * 16);
-    state.write((char*)iop_scratchpad, 1024);
-    state.write((char*)&iop_scratchpad_start, sizeof(iop_scratchpad_start));
+    block("RDRAM", RDRAM, 1024 * 1024 * 32);
+    block("IOPRAM", IOP_RAM, 1024 * 1024 * 2);
+    block("SPURAM", SPU_RAM, 1024 * 1024 * 2);
+    istream& scratch = section("SCRATCH");
+    scratch.read((char*)scratchpad, 1024 * 16);
+    scratch.read((char*)iop_scratchpad, 1024);
+    scratch.read((char*)&iop_scratchpad_start, sizeof(iop_scratchpad_start));
 
     //CPUs
-    cpu.save_state(state);
-    cp0.save_state(state);
-    fpu.save_state(state);
-    iop.save_state(state);
-    vu0.save_state(state);
-    vu1.save_state(state);
+    cpu.load_state(section("EE"));
+    cp0.load_state(section("COP0"));
+    fpu.load_state(section("FPU"));
+    iop.load_state(section("IOP"));
+    vu0.load_state(section("VU0"));
+    vu1.load_state(section("VU1"));
 
     //Interrupt registers
-    intc.save_state(state);
-    iop_intc.save_state(state);
+    intc.load_state(section("INTC"));
+    iop_intc.load_state(section("IOPINTC"));
 
     //Timers
-    timers.save_state(state);
-    iop_timers.save_state(state);
+    timers.load_state(section("TIMERS"));
+    iop_timers.load_state(section("IOPTMR"));
 
     //DMA
-    dmac.save_state(state);
-    iop_dma.save_state(state);
+    dmac.load_state(section("DMAC"));
+    iop_dma.load_state(section("IOPDMA"));
 
     //"Interfaces"
-    gif.save_state(state);
-    sif.save_state(state);
-    vif0.save_state(state);
-    vif1.save_state(state);
+    gif.load_state(section("GIF"));
+    sif.load_state(section("SIF"));
+    vif0.load_state(section("VIF0"));
+    vif1.load_state(section("VIF1"));
 
     //CDVD
-    cdvd.save_state(state);
+    cdvd.load_state(section("CDVD"));
 
     //GS
     //Important note - this serialization function is located in gs.cpp as it contains a lot of thread-specific details
-    gs.save_state(state);
+    gs.load_state(section("GS"), rev >= 51);
 
-    scheduler.save_state(state);
-    pad.save_state(state);
-    spu.save_state(state);
-    spu2.save_state(state);
+    scheduler.load_state(section("SCHED"));
+    pad.load_state(section("PAD"));
+    spu.load_state(section("SPU"));
+    spu2.load_state(section("SPU2"));
 
-    state.close();
-    printf("Success!\n");
+    //Sound was generated one sample at a time, with the event for the next one still pending
+    if (rev < 52)
+        sound_sample_cycles = scheduler.get_ee_cycles();
+
+    //The pending sound event can't be told apart from any other by its ID, so it's scheduled anew.
+    //States from before it was retimed in place can also hold stale ones
+    scheduler.delete_events(spu_event_id);
+    start_sound_sample_event();
+}
+
+void Emulator::save_sections(const function<ostream&(const char*)>& section,
+                             const function<void(const char*, const void*, uint64_t)>& block)
+{
+    //Emulator info
+    ostream& info = section("EMU");
+    info.write((char*)&VBLANK_sent, sizeof(VBLANK_sent));
+    info.write((char*)&frames, sizeof(frames));
+    info.write((char*)&sound_sample_cycles, sizeof(sound_sample_cycles));
+
+    //RAM
+    block("RDRAM", RDRAM, 1024 * 1024 * 32);
+    block("IOPRAM", IOP_RAM, 1024 * 1024 * 2);
+    block("SPURAM", SPU_RAM, 1024 * 1024 * 2);
+    ostream& scratch = section("SCRATCH");
+    scratch.write((char*)scratchpad, 1024 * 16);
+    scratch.write((char*)iop_scratchpad, 1024);
+    scratch.write((char*)&iop_scratchpad_start, sizeof(iop_scratchpad_start));
+
+    //CPUs
+    cpu.save_state(section("EE"));
+    cp0.save_state(section("COP0"));
+    fpu.save_state(section("FPU"));
+    iop.save_state(section("IOP"));
+    vu0.save_state(section("VU0"));
+    vu1.save_state(section("VU1"));
+
+    //Interrupt registers
+    intc.save_state(section("INTC"));
+    iop_intc.save_state(section("IOPINTC"));
+
+    //Timers
+    timers.save_state(section("TIMERS"));
+    iop_timers.save_state(section("IOPTMR"));
+
+    //DMA
+    dmac.save_state(section("DMAC"));
+    iop_dma.save_state(section("IOPDMA"));
+
+    //"Interfaces"
+    gif.save_state(section("GIF"));
+    sif.save_state(section("SIF"));
+    vif0.save_state(section("VIF0"));
+    vif1.save_state(section("VIF1"));
+
+    //CDVD
+    cdvd.save_state(section("CDVD"));
+
+    //GS
+    //Important note - this serialization function is located in gs.cpp as it contains a lot of thread-specific details
+    gs.save_state(section("GS"));
+
+    scheduler.save_state(section("SCHED"));
+    pad.save_state(section("PAD"));
+    spu.save_state(section("SPU"));
+    spu2.save_state(section("SPU2"));
 }
 
-void EmotionEngine::load_state(ifstream &state)
+void EmotionEngine::load_state(istream &state)
 {
     state.read((char*)&cycle_count, sizeof(cycle_count));
     state.read((char*)&cycles_to_run, sizeof(cycles_to_run));
@@ -217,7 +457,7 @@ void EmotionEngine::load_state(ifstream &state)
     state.read((char*)&deci2handlers, sizeof(Deci2Handler) * deci2size);
 }
 
-void EmotionEngine::save_state(ofstream &state)
+void EmotionEngine::save_state(ostream &state)
 {
     state.write((char*)&cycle_count, sizeof(cycle_count));
     state.write((char*)&cycles_to_run, sizeof(cycles_to_run));
@@ -240,7 +480,7 @@ void EmotionEngine::save_state(ofstream &state)
     state.write((char*)&deci2handlers, sizeof(Deci2Handler) * deci2size);
 }
 
-void Cop0::load_state(ifstream &state)
+void Cop0::load_state(istream &state)
 {
     state.read((char*)&gpr, sizeof(gpr));
     state.read((char*)&status, sizeof(status));
@@ -257,7 +497,7 @@ void Cop0::load_state(ifstream &state)
         map_tlb(&tlb[i]);
 }
 
-void Cop0::save_state(ofstream &state)
+void Cop0::save_state(ostream &state)
 {
     state.write((char*)&gpr, sizeof(gpr));
     state.write((char*)&status, sizeof(status));
@@ -270,7 +510,7 @@ void Cop0::save_state(ofstream &state)
     state.write((char*)&tlb, sizeof(tlb));
 }
 
-void Cop1::load_state(ifstream &state)
+void Cop1::load_state(istream &state)
 {
     for (int i = 0; i < 32; i++)
         state.read((char*)&gpr[i].u, sizeof(uint32_t));
@@ -278,7 +518,7 @@ void Cop1::load_state(ifstream &state)
     state.read((char*)&control, sizeof(control));
 }
 
-void Cop1::save_state(ofstream &state)
+void Cop1::save_state(ostream &state)
 {
     for (int i = 0; i < 32; i++)
         state.write((char*)&gpr[i].u, sizeof(uint32_t));
@@ -286,7 +526,7 @@ void Cop1::save_state(ofstream &state)
     state.write((char*)&control, sizeof(control));
 }
 
-void IOP::load_state(ifstream &state)
+void IOP::load_state(istream &state)
 {
     state.read((char*)&gpr, sizeof(gpr));
     state.read((char*)&LO, sizeof(LO));
@@ -305,7 +545,7 @@ void IOP::load_state(ifstream &state)
     state.read((char*)&cop0.EPC, sizeof(cop0.EPC));
 }
 
-void IOP::save_state(ofstream &state)
+void IOP::save_state(ostream &state)
 {
     state.write((char*)&gpr, sizeof(gpr));
     state.write((char*)&LO, sizeof(LO));
@@ -324,7 +564,7 @@ void IOP::save_state(ofstream &state)
     state.write((char*)&cop0.EPC, sizeof(cop0.EPC));
 }
 
-void VectorUnit::load_state(ifstream &state)
+void VectorUnit::load_state(istream &state)
 {
     for (int i = 0; i < 32; i++)
         state.read((char*)&gpr[i].u, sizeof(uint32_t) * 4);
@@ -379,6 +619,9 @@ void VectorUnit::load_state(ifstream &state)
         state.read((char*)&data_mem, 1024 * 16);
     }
 
+    //The loaded program may not match the one the JIT and interpreter last saw
+    vumem_is_dirty = true;
+
     state.read((char*)&running, sizeof(running));
     state.read((char*)&PC, sizeof(PC));
     state.read((char*)&new_PC, sizeof(new_PC));
@@ -391,7 +634,7 @@ void VectorUnit::load_state(ifstream &state)
     state.read((char*)&ebit_delay_slot, sizeof(ebit_delay_slot));
 }
 
-void VectorUnit::save_state(ofstream &state)
+void VectorUnit::save_state(ostream &state)
 {
     for (int i = 0; i < 32; i++)
         state.write((char*)&gpr[i].u, sizeof(uint32_t) * 4);
@@ -457,7 +700,7 @@ void VectorUnit::save_state(ofstream &state)
     state.write((char*)&ebit_delay_slot, sizeof(ebit_delay_slot));
 }
 
-void INTC::load_state(ifstream &state)
+void INTC::load_state(istream &state)
 {
     state.read((char*)&INTC_MASK, sizeof(INTC_MASK));
     state.read((char*)&INTC_STAT, sizeof(INTC_STAT));
@@ -465,7 +708,7 @@ void INTC::load_state(ifstream &state)
     state.read((char*)&read_stat_count, sizeof(read_stat_count));
 }
 
-void INTC::save_state(ofstream &state)
+void INTC::save_state(ostream &state)
 {
     state.write((char*)&INTC_MASK, sizeof(INTC_MASK));
     state.write((char*)&INTC_STAT, sizeof(INTC_STAT));
@@ -473,43 +716,43 @@ void INTC::save_state(ofstream &state)
     state.write((char*)&read_stat_count, sizeof(read_stat_count));
 }
 
-void IOP_INTC::load_state(ifstream &state)
+void IOP_INTC::load_state(istream &state)
 {
     state.read((char*)&I_CTRL, sizeof(I_CTRL));
     state.read((char*)&I_STAT, sizeof(I_STAT));
     state.read((char*)&I_MASK, sizeof(I_MASK));
 }
 
-void IOP_INTC::save_state(ofstream &state)
+void IOP_INTC::save_state(ostream &state)
 {
     state.write((char*)&I_CTRL, sizeof(I_CTRL));
     state.write((char*)&I_STAT, sizeof(I_STAT));
     state.write((char*)&I_MASK, sizeof(I_MASK));
 }
 
-void EmotionTiming::load_state(ifstream &state)
+void EmotionTiming::load_state(istream &state)
 {
     state.read((char*)&timers, sizeof(timers));
     state.read((char*)&events, sizeof(events));
 }
 
-void EmotionTiming::save_state(ofstream &state)
+void EmotionTiming::save_state(ostream &state)
 {
     state.write((char*)&timers, sizeof(timers));
     state.write((char*)&events, sizeof(events));
 }
 
-void IOPTiming::load_state(ifstream &state)
+void IOPTiming::load_state(istream &state)
 {
     state.read((char*)&timers, sizeof(timers));
 }
 
-void IOPTiming::save_state(ofstream &state)
+void IOPTiming::save_state(ostream &state)
 {
     state.write((char*)&timers, sizeof(timers));
 }
 
-void DMAC::load_state(ifstream &state)
+void DMAC::load_state(istream &state)
 {
     state.read((char*)&channels, sizeof(channels));
 
@@ -545,7 +788,7 @@ void DMAC::load_state(ifstream &state)
     }
 }
 
-void DMAC::save_state(ofstream &state)
+void DMAC::save_state(ostream &state)
 {
     state.write((char*)&channels, sizeof(channels));
 
@@ -579,7 +822,7 @@ void DMAC::save_state(ofstream &state)
     }
 }
 
-void IOP_DMA::load_state(ifstream &state)
+void IOP_DMA::load_state(istream &state)
 {
     state.read((char*)&channels, sizeof(channels));
 
@@ -607,7 +850,7 @@ void IOP_DMA::load_state(ifstream &state)
     apply_dma_functions();
 }
 
-void IOP_DMA::save_state(ofstream &state)
+void IOP_DMA::save_state(ostream &state)
 {
     state.write((char*)&channels, sizeof(channels));
 
@@ -628,7 +871,7 @@ void IOP_DMA::save_state(ofstream &state)
     state.write((char*)&DICR, sizeof(DICR));
 }
 
-void GraphicsInterface::load_state(ifstream &state)
+void GraphicsInterface::load_state(istream &state)
 {
     int size;
     uint128_t FIFO_buffer[16];
@@ -649,7 +892,7 @@ void GraphicsInterface::load_state(ifstream &state)
     state.read((char*)&gif_temporary_stop, sizeof(gif_temporary_stop));
 }
 
-void GraphicsInterface::save_state(ofstream &state)
+void GraphicsInterface::save_state(ostream &state)
 {
     int size = FIFO.size();
     uint128_t FIFO_buffer[16];
@@ -675,7 +918,7 @@ void GraphicsInterface::save_state(ofstream &state)
     state.write((char*)&gif_temporary_stop, sizeof(gif_temporary_stop));
 }
 
-void SubsystemInterface::load_state(ifstream &state)
+void SubsystemInterface::load_state(istream &state)
 {
     state.read((char*)&mscom, sizeof(mscom));
     state.read((char*)&smcom, sizeof(smcom));
@@ -699,7 +942,7 @@ void SubsystemInterface::load_state(ifstream &state)
         SIF1_FIFO.push(buffer[i]);
 }
 
-void SubsystemInterface::save_state(ofstream &state)
+void SubsystemInterface::save_state(ostream &state)
 {
     state.write((char*)&mscom, sizeof(mscom));
     state.write((char*)&smcom, sizeof(smcom));
@@ -731,7 +974,7 @@ void SubsystemInterface::save_state(ofstream &state)
         SIF1_FIFO.push(buffer[i]);
 }
 
-void VectorInterface::load_state(ifstream &state)
+void VectorInterface::load_state(istream &state)
 {
     int size, internal_size;
     uint32_t FIFO_buffer[64];
@@ -783,7 +1026,7 @@ void VectorInterface::load_state(ifstream &state)
     state.read((char*)&VIF_ERR, sizeof(VIF_ERR));
 }
 
-void VectorInterface::save_state(ofstream &state)
+void VectorInterface::save_state(ostream &state)
 {
     int size = FIFO.size();
     int internal_size = internal_FIFO.size();
@@ -846,7 +1089,7 @@ void VectorInterface::save_state(ofstream &state)
     state.write((char*)&VIF_ERR, sizeof(VIF_ERR));
 }
 
-void CDVD_Drive::load_state(ifstream &state)
+void CDVD_Drive::load_state(istream &state)
 {
     state.read((char*)&file_size, sizeof(file_size));
     state.read((char*)&read_bytes_left, sizeof(read_bytes_left));
@@ -876,7 +1119,7 @@ void CDVD_Drive::load_state(ifstream &state)
     state.read((char*)&rtc, sizeof(rtc));
 }
 
-void CDVD_Drive::save_state(ofstream &state)
+void CDVD_Drive::save_state(ostream &state)
 {
     state.write((char*)&file_size, sizeof(file_size));
     state.write((char*)&read_bytes_left, sizeof(read_bytes_left));
@@ -906,7 +1149,7 @@ void CDVD_Drive::save_state(ofstream &state)
     state.write((char*)&rtc, sizeof(rtc));
 }
 
-void Scheduler::load_state(ifstream &state)
+void Scheduler::load_state(istream &state)
 {
     state.read((char*)&ee_cycles, sizeof(ee_cycles));
     state.read((char*)&bus_cycles, sizeof(bus_cycles));
@@ -914,17 +1157,29 @@ void Scheduler::load_state(ifstream &state)
     state.read((char*)&run_cycles, sizeof(run_cycles));
     state.read((char*)&closest_event_time, sizeof(closest_event_time));
 
-    events.clear();
+    event_pool.clear();
+    event_heap_pos.clear();
+    free_event_slots.clear();
+    event_heap.clear();
 
     int event_size = 0;
     state.read((char*)&event_size, sizeof(event_size));
 
+    //Event IDs are saved as plain sequence numbers, so give each event a slot again
+    vector<pair<uint64_t, uint64_t>> id_remap;
     for (int i = 0; i < event_size; i++)
     {
         SchedulerEvent event;
         state.read((char*)&event, sizeof(event));
 
-        events.push_back(event);
+        int slot = alloc_event_slot();
+        uint64_t new_id = (event.event_id << EVENT_SLOT_BITS) | slot;
+        id_remap.push_back({event.event_id, new_id});
+        event.event_id = new_id;
+        event_pool[slot] = event;
+
+        event_heap.push_back(slot);
+        heap_sift_up(event_heap.size() - 1);
     }
 
     state.read((char*)&next_event_id, sizeof(next_event_id));
@@ -939,11 +1194,22 @@ void Scheduler::load_state(ifstream &state)
         SchedulerTimer timer;
         state.read((char*)&timer, sizeof(timer));
 
+        for (auto& id : id_remap)
+        {
+            if (id.first == timer.event_id)
+            {
+                timer.event_id = id.second;
+                break;
+            }
+        }
+
         timers.push_back(timer);
     }
+
+    update_closest_event_time();
 }
 
-void Scheduler::save_state(ofstream &state)
+void Scheduler::save_state(ostream &state)
 {
     state.write((char*)&ee_cycles, sizeof(ee_cycles));
     state.write((char*)&bus_cycles, sizeof(bus_cycles));
@@ -951,12 +1217,13 @@ void Scheduler::save_state(ofstream &state)
     state.write((char*)&run_cycles, sizeof(run_cycles));
     state.write((char*)&closest_event_time, sizeof(closest_event_time));
 
-    int event_size = events.size();
+    int event_size = event_heap.size();
     state.write((char*)&event_size, sizeof(event_size));
 
-    for (auto it = events.begin(); it != events.end(); it++)
+    for (int i = 0; i < event_size; i++)
     {
-        SchedulerEvent event = *it;
+        SchedulerEvent event = event_pool[event_heap[i]];
+        event.event_id >>= EVENT_SLOT_BITS;
         state.write((char*)&event, sizeof(event));
     }
 
@@ -966,10 +1233,14 @@ void Scheduler::save_state(ofstream &state)
     state.write((char*)&timer_size, sizeof(timer_size));
 
     for (int i = 0; i < timer_size; i++)
-        state.write((char*)&timers[i], sizeof(SchedulerTimer));
+    {
+        SchedulerTimer timer = timers[i];
+        timer.event_id >>= EVENT_SLOT_BITS;
+        state.write((char*)&timer, sizeof(SchedulerTimer));
+    }
 }
 
-void Gamepad::load_state(ifstream &state)
+void Gamepad::load_state(istream &state)
 {
     state.read((char*)&command_buffer, sizeof(command_buffer));
     state.read((char*)&rumble_values, sizeof(rumble_values));
@@ -981,7 +1252,7 @@ void Gamepad::load_state(ifstream &state)
     state.read((char*)&config_mode, sizeof(config_mode));
 }
 
-void Gamepad::save_state(ofstream &state)
+void Gamepad::save_state(ostream &state)
 {
     state.write((char*)&command_buffer, sizeof(command_buffer));
     state.write((char*)&rumble_values, sizeof(rumble_values));
@@ -993,7 +1264,7 @@ void Gamepad::save_state(ofstream &state)
     state.write((char*)&config_mode, sizeof(config_mode));
 }
 
-void SPU::load_state(ifstream &state)
+void SPU::load_state(istream &state)
 {
     state.read((char*)&voices, sizeof(voices));
     state.read((char*)&core_att, sizeof(core_att));
@@ -1031,9 +1302,11 @@ void SPU::load_state(ifstream &state)
     state.read((char*)&voice_mixwet_right, sizeof(voice_mixwet_right));
     state.read((char*)&voice_pitch_mod, sizeof(voice_pitch_mod));
     state.read((char*)&voice_noise_gen, sizeof(voice_noise_gen));
+
+    adpcm_cache.reset();
 }
 
-void SPU::save_state(ofstream &state)
+void SPU::save_state(ostream &state)
 {
     state.write((char*)&voices, sizeof(voices));
     state.write((char*)&core_att, sizeof(core_att));
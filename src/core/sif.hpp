@@ -75,8 +75,8 @@ class SubsystemInterface
 
         void ee_log_sifrpc(uint32_t transfer_ptr, int len);
 
-        void load_state(std::ifstream& state);
-        void save_state(std::ofstream& state);
+        void load_state(std::istream& state);
+        void save_state(std::ostream& state);
 };
 
 inline int SubsystemInterface::get_SIF0_size()
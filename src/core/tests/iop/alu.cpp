@@ -20,6 +20,10 @@ const static uint32_t C_GARBAGE2[4] = {0xDEADBEEF, 0xDEADBEEE, 0xDEADBEED, 0xDEA
 #define RT 9
 #define RS 10
 
+//Each case is also compiled by the JIT as a block of the instruction, a jump and its delay slot
+const static uint32_t JIT_TEST_ADDR = 0x1000;
+const static uint32_t JIT_TEST_EXIT = (0x02 << 26) | ((JIT_TEST_ADDR + 0x10) >> 2);
+
 #define PRINT_R(rt, newline) \
     test_output << setw(8) << setfill('0') << hex << GET_U32(rt); \
     if (newline) test_output << "\n";
@@ -36,79 +40,86 @@ const static uint32_t C_GARBAGE2[4] = {0xDEADBEEF, 0xDEADBEEE, 0xDEADBEED, 0xDEA
 #define GET_S32(r) \
     (int32_t)iop.get_gpr(r)
 
-#define RRR(OP) \
-    IOP_Interpreter::OP(iop, (RD << 11) | (RT << 16) | (RS << 21));
+#define RUN_BOTH(OP, instr) \
+    { \
+        uint32_t in_d = GET_U32(RD), in_s = GET_U32(RS), in_t = GET_U32(RT); \
+        IOP_Interpreter::OP(iop, instr); \
+        check_jit(instr, in_d, in_s, in_t); \
+    }
+
+#define RRR(OP, FUNCT) \
+    RUN_BOTH(OP, (FUNCT | (RD << 11) | (RT << 16) | (RS << 21)))
 
-#define RRR_OP_DO_III(NAME, OP, d, s, t) \
+#define RRR_OP_DO_III(NAME, OP, FUNCT, d, s, t) \
     SET_U32(RD, d); SET_U32(RS, s); SET_U32(RT, t); \
-    RRR(OP) \
+    RRR(OP, FUNCT) \
     test_output << "  " << #NAME << " " << std::dec << GET_S32(RS) << ", " << GET_S32(RT) << ": "; PRINT_R(RD, 1)
 
-#define RRR_OP_DO_MMM(NAME, OP, d, s, t) \
+#define RRR_OP_DO_MMM(NAME, OP, FUNCT, d, s, t) \
     SET_M(RD, d); SET_M(RS, s); SET_M(RT, t); \
-    RRR(OP) \
+    RRR(OP, FUNCT) \
     test_output << "  " << #NAME << " " << #s << ", " << #t << ": "; PRINT_R(RD, 1);
 
-#define TEST_RRR(NAME, OP) \
+#define TEST_RRR(NAME, OP, FUNCT) \
     do { \
         test_output << #NAME << ":\n"; \
-        RRR_OP_DO_III(NAME, OP, 0x1337, 0, 0); \
-        RRR_OP_DO_III(NAME, OP, 0x1337, 0, 1); \
-        RRR_OP_DO_III(NAME, OP, 0x1337, 1, 1); \
-        RRR_OP_DO_III(NAME, OP, 0x1337, 1, 0); \
-        RRR_OP_DO_III(NAME, OP, 0x1337, 2, 2); \
-        RRR_OP_DO_III(NAME, OP, 0x1337, 0xFFFFFFFF, 1); \
-        RRR_OP_DO_III(NAME, OP, 0x1337, 0xFFFFFFFF, 0xFFFFFFFF); \
-        RRR_OP_DO_MMM(NAME, OP, C_GARBAGE1, C_ZERO, C_ZERO); \
-        RRR_OP_DO_MMM(NAME, OP, C_GARBAGE1, C_ZERO, C_ONE); \
-        RRR_OP_DO_MMM(NAME, OP, C_GARBAGE1, C_ONE, C_ZERO); \
-        RRR_OP_DO_MMM(NAME, OP, C_GARBAGE1, C_ONE, C_ONE); \
-        RRR_OP_DO_MMM(NAME, OP, C_GARBAGE1, C_ONE, C_NEGONE); \
-        RRR_OP_DO_MMM(NAME, OP, C_GARBAGE1, C_S16_MAX, C_S16_MAX); \
-        RRR_OP_DO_MMM(NAME, OP, C_GARBAGE1, C_S16_MIN, C_S16_MIN); \
-        RRR_OP_DO_MMM(NAME, OP, C_GARBAGE1, C_S32_MAX, C_S32_MAX); \
-        RRR_OP_DO_MMM(NAME, OP, C_GARBAGE1, C_S32_MIN, C_S32_MIN); \
-        RRR_OP_DO_MMM(NAME, OP, C_GARBAGE1, C_S64_MAX, C_S64_MAX); \
-        RRR_OP_DO_MMM(NAME, OP, C_GARBAGE1, C_S64_MIN, C_S64_MIN); \
-        RRR_OP_DO_MMM(NAME, OP, C_GARBAGE1, C_GARBAGE1, C_GARBAGE2); \
+        RRR_OP_DO_III(NAME, OP, FUNCT, 0x1337, 0, 0); \
+        RRR_OP_DO_III(NAME, OP, FUNCT, 0x1337, 0, 1); \
+        RRR_OP_DO_III(NAME, OP, FUNCT, 0x1337, 1, 1); \
+        RRR_OP_DO_III(NAME, OP, FUNCT, 0x1337, 1, 0); \
+        RRR_OP_DO_III(NAME, OP, FUNCT, 0x1337, 2, 2); \
+        RRR_OP_DO_III(NAME, OP, FUNCT, 0x1337, 0xFFFFFFFF, 1); \
+        RRR_OP_DO_III(NAME, OP, FUNCT, 0x1337, 0xFFFFFFFF, 0xFFFFFFFF); \
+        RRR_OP_DO_MMM(NAME, OP, FUNCT, C_GARBAGE1, C_ZERO, C_ZERO); \
+        RRR_OP_DO_MMM(NAME, OP, FUNCT, C_GARBAGE1, C_ZERO, C_ONE); \
+        RRR_OP_DO_MMM(NAME, OP, FUNCT, C_GARBAGE1, C_ONE, C_ZERO); \
+        RRR_OP_DO_MMM(NAME, OP, FUNCT, C_GARBAGE1, C_ONE, C_ONE); \
+        RRR_OP_DO_MMM(NAME, OP, FUNCT, C_GARBAGE1, C_ONE, C_NEGONE); \
+        RRR_OP_DO_MMM(NAME, OP, FUNCT, C_GARBAGE1, C_S16_MAX, C_S16_MAX); \
+        RRR_OP_DO_MMM(NAME, OP, FUNCT, C_GARBAGE1, C_S16_MIN, C_S16_MIN); \
+        RRR_OP_DO_MMM(NAME, OP, FUNCT, C_GARBAGE1, C_S32_MAX, C_S32_MAX); \
+        RRR_OP_DO_MMM(NAME, OP, FUNCT, C_GARBAGE1, C_S32_MIN, C_S32_MIN); \
+        RRR_OP_DO_MMM(NAME, OP, FUNCT, C_GARBAGE1, C_S64_MAX, C_S64_MAX); \
+        RRR_OP_DO_MMM(NAME, OP, FUNCT, C_GARBAGE1, C_S64_MIN, C_S64_MIN); \
+        RRR_OP_DO_MMM(NAME, OP, FUNCT, C_GARBAGE1, C_GARBAGE1, C_GARBAGE2); \
         test_output << "  " << #OP << " -> $00000000\n\n"; \
     } while (0)
 
-#define RRI(OP, t) \
-    IOP_Interpreter::OP(iop, t | (RD << 16) | (RS << 21));
+#define RRI(OP, OPCODE, t) \
+    RUN_BOTH(OP, (t | (RD << 16) | (RS << 21) | (OPCODE << 26)))
 
-#define RRI_OP_DO_III(OP, d, s, t) \
+#define RRI_OP_DO_III(OP, OPCODE, d, s, t) \
     SET_U32(RD, d); SET_U32(RS, s); \
-    RRI(OP, t) \
+    RRI(OP, OPCODE, t) \
     test_output << "  " << #OP << " " << dec << GET_S32(RS) << ", " << t << ": "; PRINT_R(RD, 1)
 
-#define RRI_OP_DO_MMI(OP, d, s, t) \
+#define RRI_OP_DO_MMI(OP, OPCODE, d, s, t) \
     SET_M(RD, d); SET_M(RS, s); \
-    RRI(OP, t) \
+    RRI(OP, OPCODE, t) \
     test_output << "  " << #OP << " " << #s << ", " << dec << t << ": "; PRINT_R(RD, 1);
 
-#define TEST_RRI(OP) \
+#define TEST_RRI(OP, OPCODE) \
     do { \
         test_output << #OP << ":\n"; \
-        RRI_OP_DO_III(OP, 0x1337, 0, 0); \
-        RRI_OP_DO_III(OP, 0x1337, 0, 1); \
-        RRI_OP_DO_III(OP, 0x1337, 1, 1); \
-        RRI_OP_DO_III(OP, 0x1337, 1, 0); \
-        RRI_OP_DO_III(OP, 0x1337, 2, 2); \
-        RRI_OP_DO_III(OP, 0x1337, 0xFFFFFFFF, 1); \
-        RRI_OP_DO_III(OP, 0x1337, 0xFFFFFFFF, 0xFFFF); \
-        RRI_OP_DO_MMI(OP, C_GARBAGE1, C_ZERO, 0); \
-        RRI_OP_DO_MMI(OP, C_GARBAGE1, C_ZERO, 1); \
-        RRI_OP_DO_MMI(OP, C_GARBAGE1, C_ONE, 0); \
-        RRI_OP_DO_MMI(OP, C_GARBAGE1, C_ONE, 1); \
-        RRI_OP_DO_MMI(OP, C_GARBAGE1, C_ONE, 0xFFFF); \
-        RRI_OP_DO_MMI(OP, C_GARBAGE1, C_S16_MAX, 0x7FFF); \
-        RRI_OP_DO_MMI(OP, C_GARBAGE1, C_S16_MIN, 0x8000); \
-        RRI_OP_DO_MMI(OP, C_GARBAGE1, C_S32_MAX, 0x7FFF); \
-        RRI_OP_DO_MMI(OP, C_GARBAGE1, C_S32_MIN, 0x8000); \
-        RRI_OP_DO_MMI(OP, C_GARBAGE1, C_S64_MAX, 0x7FFF); \
-        RRI_OP_DO_MMI(OP, C_GARBAGE1, C_S64_MIN, 0x8000); \
-        RRI_OP_DO_MMI(OP, C_GARBAGE1, C_GARBAGE1, 0xDEAD); \
+        RRI_OP_DO_III(OP, OPCODE, 0x1337, 0, 0); \
+        RRI_OP_DO_III(OP, OPCODE, 0x1337, 0, 1); \
+        RRI_OP_DO_III(OP, OPCODE, 0x1337, 1, 1); \
+        RRI_OP_DO_III(OP, OPCODE, 0x1337, 1, 0); \
+        RRI_OP_DO_III(OP, OPCODE, 0x1337, 2, 2); \
+        RRI_OP_DO_III(OP, OPCODE, 0x1337, 0xFFFFFFFF, 1); \
+        RRI_OP_DO_III(OP, OPCODE, 0x1337, 0xFFFFFFFF, 0xFFFF); \
+        RRI_OP_DO_MMI(OP, OPCODE, C_GARBAGE1, C_ZERO, 0); \
+        RRI_OP_DO_MMI(OP, OPCODE, C_GARBAGE1, C_ZERO, 1); \
+        RRI_OP_DO_MMI(OP, OPCODE, C_GARBAGE1, C_ONE, 0); \
+        RRI_OP_DO_MMI(OP, OPCODE, C_GARBAGE1, C_ONE, 1); \
+        RRI_OP_DO_MMI(OP, OPCODE, C_GARBAGE1, C_ONE, 0xFFFF); \
+        RRI_OP_DO_MMI(OP, OPCODE, C_GARBAGE1, C_S16_MAX, 0x7FFF); \
+        RRI_OP_DO_MMI(OP, OPCODE, C_GARBAGE1, C_S16_MIN, 0x8000); \
+        RRI_OP_DO_MMI(OP, OPCODE, C_GARBAGE1, C_S32_MAX, 0x7FFF); \
+        RRI_OP_DO_MMI(OP, OPCODE, C_GARBAGE1, C_S32_MIN, 0x8000); \
+        RRI_OP_DO_MMI(OP, OPCODE, C_GARBAGE1, C_S64_MAX, 0x7FFF); \
+        RRI_OP_DO_MMI(OP, OPCODE, C_GARBAGE1, C_S64_MIN, 0x8000); \
+        RRI_OP_DO_MMI(OP, OPCODE, C_GARBAGE1, C_GARBAGE1, 0xDEAD); \
         test_output << "  " << #OP << " -> $00000000\n\n"; \
     } while (0)
 
@@ -116,21 +127,51 @@ void Emulator::test_iop()
 {
     ofstream test_output("test_log.txt");
 
+    uint32_t old_PC = iop.get_PC();
+    uint32_t old_code[3];
+    for (int i = 0; i < 3; i++)
+        old_code[i] = iop_read32(JIT_TEST_ADDR + i * 4);
+    iop_write32(JIT_TEST_ADDR + 4, JIT_TEST_EXIT);
+    iop_write32(JIT_TEST_ADDR + 8, 0);
+
+    //Runs the instruction again through the JIT from the same registers. The interpreter's result is kept in RD.
+    int jit_mismatches = 0;
+    auto check_jit = [&](uint32_t instr, uint32_t in_d, uint32_t in_s, uint32_t in_t)
+    {
+        uint32_t expected = GET_U32(RD);
+        iop_write32(JIT_TEST_ADDR, instr);
+        SET_U32(RD, in_d); SET_U32(RS, in_s); SET_U32(RT, in_t);
+        iop.set_PC(JIT_TEST_ADDR);
+        iop.run_jit_block();
+        if (GET_U32(RD) != expected)
+        {
+            test_output << "  JIT mismatch on $" << setw(8) << setfill('0') << hex << instr << ": ";
+            PRINT_R(RD, 1);
+            jit_mismatches++;
+        }
+        SET_U32(RD, expected);
+    };
+
     test_output << "-- TEST BEGIN\n";
-    TEST_RRR(addu, addu);
-    TEST_RRI(addiu);
-    TEST_RRR(and, and_cpu);
-    TEST_RRI(andi);
-    TEST_RRR(nor, nor);
-    TEST_RRR(or, or_cpu);
-    TEST_RRI(ori);
-    TEST_RRR(slt, slt);
-    TEST_RRI(slti);
-    TEST_RRI(sltiu);
-    TEST_RRR(sltu, sltu);
-    TEST_RRR(subu, subu);
-    TEST_RRR(xor, xor_cpu);
-    TEST_RRI(xori);
+    TEST_RRR(addu, addu, 0x21);
+    TEST_RRI(addiu, 0x09);
+    TEST_RRR(and, and_cpu, 0x24);
+    TEST_RRI(andi, 0x0C);
+    TEST_RRR(nor, nor, 0x27);
+    TEST_RRR(or, or_cpu, 0x25);
+    TEST_RRI(ori, 0x0D);
+    TEST_RRR(slt, slt, 0x2A);
+    TEST_RRI(slti, 0x0A);
+    TEST_RRI(sltiu, 0x0B);
+    TEST_RRR(sltu, sltu, 0x2B);
+    TEST_RRR(subu, subu, 0x23);
+    TEST_RRR(xor, xor_cpu, 0x26);
+    TEST_RRI(xori, 0x0E);
+    test_output << "-- JIT MISMATCHES: " << dec << jit_mismatches << "\n";
     test_output << "-- TEST END\n";
     test_output.flush();
+
+    for (int i = 0; i < 3; i++)
+        iop_write32(JIT_TEST_ADDR + i * 4, old_code[i]);
+    iop.set_PC(old_PC);
 }
@@ -0,0 +1,323 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include "../core/emulator.hpp"
+#include "../core/errors.hpp"
+
+using namespace std;
+
+/**
+ * Headless GS dump replay benchmark.
+ *
+ * A .gsd dump is a header and the GS thread's state, followed by every message the GS thread received while recording.
+ * Dumps can be gzipped, which shrinks the mostly empty VRAM in the state to almost nothing.
+ * The messages are loaded into memory up front and fed to the GS thread as fast as it takes them, once per pass.
+ * Each pass reports frames, primitives and pixels per second. Lines, scanline triangles and sprites count their
+ * scissored spans or rectangle at once; the block triangle rasterizer counts each pixel it finds covered.
+ * With --crc, every frame's framebuffer is checksummed and written to a file. --check replays against such a file
+ * and fails on the first frame that differs, so rasterizer and JIT changes can be checked against a known good build.
+ * data/prims.gsd.gz is a small synthetic dump of lines, triangles and sprites, checked with
+ * "gsbench data/prims.gsd.gz --check data/prims.crc".
+ **/
+
+//The GS thread sleeps once it runs out of messages, so it gets woken up regularly while the queue fills
+const int WAKE_INTERVAL = 65536;
+
+struct Dump
+{
+    string state;
+    vector<GSMessage> messages;
+};
+
+struct PassResult
+{
+    uint64_t frames;
+    uint64_t prims;
+    uint64_t pixels;
+    double seconds;
+    vector<uint32_t> crcs;
+};
+
+static void print_usage()
+{
+    printf("Usage:\n");
+    printf("  gsbench <dump> [-n passes] [--crc <file>] [--check <file>]\n");
+}
+
+static double now_seconds()
+{
+    using namespace chrono;
+    return duration_cast<duration<double>>(steady_clock::now().time_since_epoch()).count();
+}
+
+static bool load_dump(const char* name, GraphicsSynthesizer& gs, Dump& dump)
+{
+    //gzread passes plain files through, so dumps may also be gzipped
+    gzFile file = gzopen(name, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Failed to open %s\n", name);
+        return false;
+    }
+
+    string data;
+    char buffer[65536];
+    int len;
+    while ((len = gzread(file, buffer, sizeof(buffer))) > 0)
+        data.append(buffer, (size_t)len);
+    bool read_error = len < 0;
+    gzclose(file);
+    if (read_error)
+    {
+        fprintf(stderr, "Failed to read %s\n", name);
+        return false;
+    }
+
+    //Loading the state once tells where the messages start
+    istringstream stream(data);
+    gs.reset();
+    if (!gs.load_dump(stream))
+    {
+        fprintf(stderr, "%s is not a GS dump\n", name);
+        return false;
+    }
+    size_t state_size = (size_t)stream.tellg();
+
+    size_t message_bytes = data.size() - state_size;
+    if (message_bytes % sizeof(GSMessage))
+        fprintf(stderr, "Warning: %s ends in a partial message\n", name);
+
+    dump.state = data.substr(0, state_size);
+    dump.messages.resize(message_bytes / sizeof(GSMessage));
+    memcpy(dump.messages.data(), data.data() + state_size, dump.messages.size() * sizeof(GSMessage));
+    return true;
+}
+
+static uint32_t framebuffer_crc(GraphicsSynthesizer& gs, uint32_t* frame)
+{
+    int w, h;
+    gs.get_inner_resolution(w, h);
+    return (uint32_t)crc32(0, (const Bytef*)frame, (uInt)(w * h * sizeof(uint32_t)));
+}
+
+static bool replay(GraphicsSynthesizer& gs, const Dump& dump, bool do_crc, PassResult& result)
+{
+    gs.reset();
+    istringstream state(dump.state);
+    gs.load_dump(state);
+
+    result.frames = 0;
+    result.crcs.clear();
+    int since_wake = 0;
+
+    double start = now_seconds();
+    for (const GSMessage& message : dump.messages)
+    {
+        switch (message.type)
+        {
+            //Messages that carry pointers into the recording process are reissued with our own buffers
+            case render_crt_t:
+            {
+                gs.render_CRT();
+                uint32_t* frame = gs.get_framebuffer();
+                if (do_crc)
+                    result.crcs.push_back(framebuffer_crc(gs, frame));
+                result.frames++;
+                since_wake = 0;
+                break;
+            }
+            case request_local_host_tx:
+                gs.request_gs_download();
+                since_wake = 0;
+                break;
+            case gsdump_t:
+                //End of the recording
+                goto done;
+            case save_state_t:
+            case load_state_t:
+            case memdump_t:
+            case die_t:
+                fprintf(stderr, "Dump contains a message that can't be replayed (%d)\n", message.type);
+                return false;
+            default:
+                gs.send_message(message);
+                if (++since_wake >= WAKE_INTERVAL)
+                {
+                    gs.wake_gs_thread();
+                    since_wake = 0;
+                }
+                break;
+        }
+    }
+
+done:
+    //Waiting on one more frame makes sure the GS thread is through every message before the clock stops
+    gs.render_CRT();
+    gs.get_framebuffer();
+    result.seconds = now_seconds() - start;
+
+    gs.get_draw_stats(result.prims, result.pixels);
+    return true;
+}
+
+static void print_result(const char* name, const PassResult& result)
+{
+    double frames = (double)result.frames;
+    printf("  %-8s %10.3f %12.1f %14.0f %14.3f\n", name, result.seconds * 1000.0 / max(frames, 1.0),
+           frames / result.seconds, (double)result.prims / result.seconds,
+           (double)result.pixels / result.seconds / 1000000.0);
+}
+
+//The file holds one "<frame> <crc>" line per frame, as written by --crc
+static bool check_crcs(const char* name, const vector<uint32_t>& crcs)
+{
+    ifstream file(name);
+    if (!file.is_open())
+    {
+        fprintf(stderr, "Failed to open %s\n", name);
+        return false;
+    }
+
+    vector<uint32_t> expected;
+    size_t frame;
+    string crc;
+    while (file >> frame >> crc)
+    {
+        if (frame != expected.size())
+        {
+            fprintf(stderr, "%s is not a CRC file (frame %zu out of order)\n", name, frame);
+            return false;
+        }
+        expected.push_back((uint32_t)strtoul(crc.c_str(), nullptr, 16));
+    }
+
+    for (size_t i = 0; i < min(crcs.size(), expected.size()); i++)
+    {
+        if (crcs[i] != expected[i])
+        {
+            printf("\nFrame %zu doesn't match %s: %08X, expected %08X\n", i, name, crcs[i], expected[i]);
+            return false;
+        }
+    }
+    if (crcs.size() != expected.size())
+    {
+        printf("\n%zu frames were drawn, %s has %zu\n", crcs.size(), name, expected.size());
+        return false;
+    }
+
+    printf("\nAll %zu frame CRCs match %s\n", crcs.size(), name);
+    return true;
+}
+
+static int run(const char* dump_name, int passes, const char* crc_name, const char* check_name)
+{
+    //Too large for the stack
+    unique_ptr<Emulator> e(new Emulator());
+    e->reset();
+    GraphicsSynthesizer& gs = e->get_gs();
+
+    Dump dump;
+    if (!load_dump(dump_name, gs, dump))
+        return 1;
+
+    vector<PassResult> results(passes);
+    for (int i = 0; i < passes; i++)
+    {
+        if (!replay(gs, dump, crc_name || check_name, results[i]))
+            return 1;
+    }
+
+    printf("%s: %zu messages, %llu frames, %llu primitives, %llu pixels per pass\n\n", dump_name, dump.messages.size(),
+           (unsigned long long)results[0].frames, (unsigned long long)results[0].prims,
+           (unsigned long long)results[0].pixels);
+    printf("  %-8s %10s %12s %14s %14s\n", "", "ms/frame", "frames/sec", "prims/sec", "Mpixels/sec");
+
+    PassResult total = {0, 0, 0, 0.0, {}};
+    for (int i = 0; i < passes; i++)
+    {
+        if (passes > 1)
+            print_result(("pass " + to_string(i + 1)).c_str(), results[i]);
+        total.frames += results[i].frames;
+        total.prims += results[i].prims;
+        total.pixels += results[i].pixels;
+        total.seconds += results[i].seconds;
+
+        if (results[i].crcs != results[0].crcs || results[i].prims != results[0].prims)
+            printf("Warning: pass %d doesn't match the first pass\n", i + 1);
+    }
+    print_result("total", total);
+
+    if (crc_name)
+    {
+        ofstream file(crc_name);
+        if (!file.is_open())
+        {
+            fprintf(stderr, "Failed to open %s for writing\n", crc_name);
+            return 1;
+        }
+
+        char line[32];
+        for (size_t i = 0; i < results[0].crcs.size(); i++)
+        {
+            snprintf(line, sizeof(line), "%zu %08X\n", i, results[0].crcs[i]);
+            file << line;
+        }
+        printf("\nWrote %zu frame CRCs to %s\n", results[0].crcs.size(), crc_name);
+    }
+
+    if (check_name && !check_crcs(check_name, results[0].crcs))
+        return 1;
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        print_usage();
+        return 1;
+    }
+
+    int passes = 1;
+    const char* crc_name = nullptr;
+    const char* check_name = nullptr;
+    for (int i = 2; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            passes = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--crc") && i + 1 < argc)
+            crc_name = argv[++i];
+        else if (!strcmp(argv[i], "--check") && i + 1 < argc)
+            check_name = argv[++i];
+        else
+        {
+            print_usage();
+            return 1;
+        }
+    }
+    if (passes < 1)
+        passes = 1;
+
+    try
+    {
+        return run(argv[1], passes, crc_name, check_name);
+    }
+    catch (non_fatal_error& err)
+    {
+        fprintf(stderr, "%s\n", err.what());
+        return 1;
+    }
+    catch (Emulation_error& err)
+    {
+        fprintf(stderr, "Emulation error: %s\n", err.what());
+        return 1;
+    }
+}
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include <QAudioDeviceInfo>
+#include <QAudioFormat>
+
+#include "audiodevice.hpp"
+
+AudioDevice::AudioDevice(QObject* parent) : QIODevice(parent), output(nullptr), read_pos(0), fill(0), playing(false)
+{
+    buffer.resize(BUFFER_SAMPLES);
+}
+
+AudioDevice::~AudioDevice()
+{
+    stop();
+}
+
+bool AudioDevice::start()
+{
+    if (output)
+        return true;
+
+    QAudioFormat format;
+    format.setSampleRate(48000);
+    format.setChannelCount(2);
+    format.setSampleSize(16);
+    format.setSampleType(QAudioFormat::SignedInt);
+    format.setByteOrder(QAudioFormat::LittleEndian);
+    format.setCodec("audio/pcm");
+
+    QAudioDeviceInfo info = QAudioDeviceInfo::defaultOutputDevice();
+    if (info.isNull() || !info.isFormatSupported(format))
+    {
+        printf("[Audio] No output device takes 48000 Hz 16-bit stereo\n");
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex);
+        read_pos = 0;
+        fill = 0;
+        playing = true;
+    }
+
+    open(QIODevice::ReadOnly);
+    output = new QAudioOutput(info, format, this);
+    output->setBufferSize((int)(BUFFER_SAMPLES * sizeof(stereo_sample)));
+    output->start(this);
+    if (output->error() != QAudio::NoError)
+    {
+        printf("[Audio] Failed to start the output device (%d)\n", output->error());
+        stop();
+        return false;
+    }
+    return true;
+}
+
+void AudioDevice::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex);
+        playing = false;
+        fill = 0;
+    }
+    space_available.notify_all();
+
+    if (output)
+    {
+        output->stop();
+        delete output;
+        output = nullptr;
+    }
+    if (isOpen())
+        close();
+}
+
+bool AudioDevice::is_playing()
+{
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+    return playing;
+}
+
+bool AudioDevice::isSequential() const
+{
+    return true;
+}
+
+//There is always something to play, silence fills in when the buffer runs dry
+qint64 AudioDevice::bytesAvailable() const
+{
+    return BUFFER_SAMPLES * sizeof(stereo_sample) + QIODevice::bytesAvailable();
+}
+
+qint64 AudioDevice::readData(char* data, qint64 max_size)
+{
+    size_t count = (size_t)max_size / sizeof(stereo_sample);
+    stereo_sample* out = (stereo_sample*)data;
+    size_t copied = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex);
+        while (copied < count && fill)
+        {
+            size_t len = std::min(std::min(count - copied, fill), BUFFER_SAMPLES - read_pos);
+            memcpy(out + copied, &buffer[read_pos], len * sizeof(stereo_sample));
+            read_pos = (read_pos + len) % BUFFER_SAMPLES;
+            fill -= len;
+            copied += len;
+        }
+    }
+    space_available.notify_one();
+
+    std::fill(out + copied, out + count, stereo_sample{});
+    return (qint64)(count * sizeof(stereo_sample));
+}
+
+qint64 AudioDevice::writeData(const char*, qint64)
+{
+    return 0;
+}
+
+//Blocks until the device has room. Should the device stop pulling, samples get dropped after a short wait,
+//so that the consumer thread can always be stopped
+void AudioDevice::push_samples(const stereo_sample* samples, size_t count)
+{
+    std::unique_lock<std::mutex> lock(buffer_mutex);
+    while (count)
+    {
+        bool has_room = space_available.wait_for(lock, std::chrono::milliseconds(100),
+                                                 [this] { return !playing || fill < BUFFER_SAMPLES; });
+        if (!has_room || !playing)
+            return;
+
+        size_t write_pos = (read_pos + fill) % BUFFER_SAMPLES;
+        size_t len = std::min(std::min(count, BUFFER_SAMPLES - fill), BUFFER_SAMPLES - write_pos);
+        memcpy(&buffer[write_pos], samples, len * sizeof(stereo_sample));
+        fill += len;
+        samples += len;
+        count -= len;
+    }
+}
+
+std::unique_ptr<AudioSink> AudioDevice::create_sink()
+{
+    return std::unique_ptr<AudioSink>(new AudioDeviceSink(this));
+}
+
+AudioDeviceSink::AudioDeviceSink(AudioDevice* device) : device(device)
+{
+
+}
+
+void AudioDeviceSink::write(const stereo_sample* samples, size_t count)
+{
+    device->push_samples(samples, count);
+}
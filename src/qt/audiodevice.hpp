@@ -0,0 +1,60 @@
+#ifndef AUDIODEVICE_HPP
+#define AUDIODEVICE_HPP
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <QAudioOutput>
+#include <QIODevice>
+
+#include "../core/audio/audio_sink.hpp"
+
+//Plays the emulator's output on the default audio device through Qt Multimedia.
+//The device pulls from a short buffer on Qt's schedule, and the sink handed to the emulator blocks until
+//there is room in that buffer, which paces AudioOutput's consumer thread to the device.
+class AudioDevice : public QIODevice
+{
+    Q_OBJECT
+    private:
+        //About 40 ms
+        constexpr static size_t BUFFER_SAMPLES = 2048;
+
+        QAudioOutput* output;
+
+        std::mutex buffer_mutex;
+        std::condition_variable space_available;
+        std::vector<stereo_sample> buffer;
+        size_t read_pos, fill;
+        bool playing;
+    protected:
+        qint64 readData(char* data, qint64 max_size) override;
+        qint64 writeData(const char* data, qint64 max_size) override;
+    public:
+        explicit AudioDevice(QObject* parent = nullptr);
+        ~AudioDevice();
+
+        bool start();
+        void stop();
+        bool is_playing();
+
+        bool isSequential() const override;
+        qint64 bytesAvailable() const override;
+
+        //Called from AudioOutput's consumer thread
+        void push_samples(const stereo_sample* samples, size_t count);
+        std::unique_ptr<AudioSink> create_sink();
+};
+
+class AudioDeviceSink : public AudioSink
+{
+    private:
+        AudioDevice* device;
+    public:
+        AudioDeviceSink(AudioDevice* device);
+
+        void write(const stereo_sample* samples, size_t count) override;
+};
+
+#endif // AUDIODEVICE_HPP
@@ -62,6 +62,34 @@ void EmuThread::set_vu1_mode(CPU_MODE mode)
     wait_for_lock([=]() { e.set_vu1_mode(mode); } );
 }
 
+void EmuThread::set_iop_mode(CPU_MODE mode)
+{
+    wait_for_lock([=]() { e.set_iop_mode(mode); } );
+}
+
+void EmuThread::set_rewind(bool enabled)
+{
+    e.set_rewind(enabled ? REWIND_INTERVAL_FRAMES : 0, REWIND_BUDGET);
+}
+
+//Goes back to the capture before the newest one, or to the only one there is
+void EmuThread::rewind()
+{
+    e.request_rewind(e.get_rewind_count() > 1 ? 1 : 0);
+}
+
+//Passing no sink stops the output, frames are then paced by the clock again
+void EmuThread::set_audio_output(std::unique_ptr<AudioSink> sink)
+{
+    wait_for_lock([&]()
+    {
+        if (sink)
+            e.start_audio_output(std::move(sink));
+        else
+            e.stop_audio_output();
+    } );
+}
+
 void EmuThread::load_BIOS(const uint8_t *BIOS)
 {
     wait_for_lock([=]() { e.load_BIOS(BIOS); } );
@@ -117,7 +145,11 @@ bool EmuThread::gsdump_read(const char *name)
         if (!gsdump.is_open())
             return 1;
         e.get_gs().reset();
-        e.get_gs().load_state(gsdump);
+        if (!e.get_gs().load_dump(gsdump))
+        {
+            gsdump.close();
+            return 1;
+        }
 
         printf("loaded gsdump\n");
         gsdump_reading = true;
@@ -248,6 +280,9 @@ void EmuThread::run()
                 e.get_resolution(new_w, new_h);
                 emit completed_frame(e.get_framebuffer(), w, h, new_w, new_h);
 
+                //With audio playing, the output draining its buffer paces frames instead of the clock
+                bool audio_paced = e.wait_for_audio_output();
+
                 //Update FPS
                 double FPS;
                 do
@@ -255,7 +290,7 @@ void EmuThread::run()
                     chrono::system_clock::time_point now = chrono::system_clock::now();
                     chrono::duration<double> elapsed_seconds = now - old_frametime;
                     FPS = 1.0 / elapsed_seconds.count();
-                } while (FPS > 60.0);
+                } while (!audio_paced && FPS > 60.0);
                 old_frametime = chrono::system_clock::now();
                 emit update_FPS(FPS);
             }
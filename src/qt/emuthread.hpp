@@ -12,6 +12,10 @@
 
 #define GSDUMP_BUFFERED_MESSAGES 100000
 
+//Half a second of history per capture, going back a few minutes in most games
+#define REWIND_INTERVAL_FRAMES 30
+#define REWIND_BUDGET (512ULL * 1024 * 1024)
+
 enum PAUSE_EVENT
 {
     GAME_NOT_LOADED,
@@ -50,6 +54,10 @@ class EmuThread : public QThread
         void set_ee_mode(CPU_MODE mode);
         void set_vu0_mode(CPU_MODE mode);
         void set_vu1_mode(CPU_MODE mode);
+        void set_iop_mode(CPU_MODE mode);
+        void set_rewind(bool enabled);
+        void set_audio_output(std::unique_ptr<AudioSink> sink);
+        void rewind();
         void load_BIOS(const uint8_t* BIOS);
         void load_ELF(QString name, const uint8_t* ELF, uint64_t ELF_size);
         void load_CDVD(const char* name, CDVD_CONTAINER type);
@@ -15,6 +15,7 @@
 #include "emuwindow.hpp"
 #include "settingswindow.hpp"
 #include "renderwidget.hpp"
+#include "audiodevice.hpp"
 #include "gamelistwidget.hpp"
 #include "bios.hpp"
 
@@ -32,6 +33,7 @@ EmuWindow::EmuWindow(QWidget *parent) : QMainWindow(parent)
         frametime_list[i] = 0.016;
 
     render_widget = new RenderWidget;
+    audio_device = new AudioDevice(this);
 
     connect(&emu_thread, &EmuThread::completed_frame,
         render_widget, &RenderWidget::draw_frame
@@ -67,6 +69,7 @@ EmuWindow::EmuWindow(QWidget *parent) : QMainWindow(parent)
     ee_mode = new QLabel;
     vu0_mode = new QLabel;
     vu1_mode = new QLabel;
+    iop_mode = new QLabel;
 
     frametime = new QLabel;
     avg_framerate = new QLabel;
@@ -80,6 +83,7 @@ EmuWindow::EmuWindow(QWidget *parent) : QMainWindow(parent)
     statusBar()->addPermanentWidget(ee_mode);
     statusBar()->addPermanentWidget(vu0_mode);
     statusBar()->addPermanentWidget(vu1_mode);
+    statusBar()->addPermanentWidget(iop_mode);
 
     create_menu();
 
@@ -397,6 +401,22 @@ void EmuWindow::create_menu()
     });
 
 
+    auto audio_action = new QAction(tr("&Audio Output"), this);
+    audio_action->setCheckable(true);
+    audio_action->setChecked(Settings::instance().audio_enabled);
+    connect(audio_action, &QAction::triggered, this, [=] (){
+        Settings::instance().audio_enabled = audio_action->isChecked();
+        Settings::instance().save();
+    });
+
+    auto rewind_action = new QAction(tr("Record &Rewind History"), this);
+    rewind_action->setCheckable(true);
+    rewind_action->setChecked(Settings::instance().rewind_enabled);
+    connect(rewind_action, &QAction::triggered, this, [=] (){
+        Settings::instance().rewind_enabled = rewind_action->isChecked();
+        Settings::instance().save();
+    });
+
     auto shutdown_action = new QAction(tr("&Shutdown"), this);
     connect(shutdown_action, &QAction::triggered, this, [=]() {
         emu_thread.pause(PAUSE_EVENT::GAME_NOT_LOADED);
@@ -411,6 +431,8 @@ void EmuWindow::create_menu()
     emulation_menu->addSeparator();
     emulation_menu->addAction(frame_action);
     emulation_menu->addAction(wavoutput_action);
+    emulation_menu->addAction(audio_action);
+    emulation_menu->addAction(rewind_action);
     emulation_menu->addSeparator();
     emulation_menu->addAction(shutdown_action);
 
@@ -589,6 +611,9 @@ void EmuWindow::keyPressEvent(QKeyEvent *event)
                 load_state();
             }
             break;
+        case Qt::Key_Backspace:
+            emu_thread.rewind();
+            break;
         case Qt::Key_F7:
             emu_thread.gsdump_single_frame();
             break;
@@ -911,4 +936,30 @@ void EmuWindow::update_status()
         vu1_mode->setText("VU1: Interpreter");
     }
     emu_thread.set_vu1_mode(mode);
+
+    if (Settings::instance().iop_jit_enabled)
+    {
+        mode = CPU_MODE::JIT;
+        iop_mode->setText("IOP: JIT");
+    }
+    else
+    {
+        mode = CPU_MODE::INTERPRETER;
+        iop_mode->setText("IOP: Interpreter");
+    }
+    emu_thread.set_iop_mode(mode);
+
+    emu_thread.set_rewind(Settings::instance().rewind_enabled);
+
+    bool audio_enabled = Settings::instance().audio_enabled;
+    if (audio_enabled && !audio_device->is_playing())
+    {
+        if (audio_device->start())
+            emu_thread.set_audio_output(audio_device->create_sink());
+    }
+    else if (!audio_enabled && audio_device->is_playing())
+    {
+        emu_thread.set_audio_output(nullptr);
+        audio_device->stop();
+    }
 }
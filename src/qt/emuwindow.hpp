@@ -15,6 +15,7 @@
 class SettingsWindow;
 class MemcardWindow;
 class RenderWidget;
+class AudioDevice;
 
 class EmuWindow : public QMainWindow
 {
@@ -24,6 +25,7 @@ class EmuWindow : public QMainWindow
         QLabel* ee_mode;
         QLabel* vu0_mode;
         QLabel* vu1_mode;
+        QLabel* iop_mode;
         QLabel* frametime;
         QLabel* avg_framerate;
 
@@ -44,6 +46,7 @@ class EmuWindow : public QMainWindow
         QAction* exit_action;
         QStackedWidget* stack_widget;
         RenderWidget* render_widget;
+        AudioDevice* audio_device;
 
         SettingsWindow* settings_window = nullptr;
         MemcardWindow* memcard_window = nullptr;
@@ -32,6 +32,9 @@ void Settings::reset()
     ee_jit_enabled = qsettings().value("ee_jit_enabled", true).toBool();
     vu0_jit_enabled = qsettings().value("vu0_jit_enabled", true).toBool();
     vu1_jit_enabled = qsettings().value("vu1_jit_enabled", true).toBool();
+    iop_jit_enabled = qsettings().value("iop_jit_enabled", false).toBool();
+    rewind_enabled = qsettings().value("rewind_enabled", false).toBool();
+    audio_enabled = qsettings().value("audio_enabled", false).toBool();
     last_used_directory = qsettings().value("last_used_dir", QDir::homePath()).toString();
     screenshot_directory = qsettings().value("screenshot_directory", QDir::homePath()).toString();
     rom_directories_to_add = QStringList();
@@ -71,6 +74,9 @@ void Settings::save()
     qsettings().setValue("ee_jit_enabled", ee_jit_enabled);
     qsettings().setValue("vu0_jit_enabled", vu0_jit_enabled);
     qsettings().setValue("vu1_jit_enabled", vu1_jit_enabled);
+    qsettings().setValue("iop_jit_enabled", iop_jit_enabled);
+    qsettings().setValue("rewind_enabled", rewind_enabled);
+    qsettings().setValue("audio_enabled", audio_enabled);
     qsettings().setValue("screenshot_directory", screenshot_directory);
     qsettings().setValue("memcard_path", memcard_path);
     qsettings().setValue("ui_scaling_factor", scaling_factor);
@@ -32,7 +32,10 @@ class Settings final : public QObject
 
         bool vu0_jit_enabled;
         bool vu1_jit_enabled;
+        bool iop_jit_enabled;
         bool ee_jit_enabled;
+        bool rewind_enabled;
+        bool audio_enabled;
         bool d_theme;
         bool l_theme;
 
@@ -21,9 +21,11 @@ GeneralTab::GeneralTab(QWidget* parent)
     QRadioButton* ee_jit_checkbox = new QRadioButton(tr("JIT"));
     QRadioButton* vu0_jit_checkbox = new QRadioButton(tr("JIT - Experimental"));
     QRadioButton* vu1_jit_checkbox = new QRadioButton(tr("JIT"));
+    QRadioButton* iop_jit_checkbox = new QRadioButton(tr("JIT - Experimental"));
     QRadioButton* ee_interpreter_checkbox = new QRadioButton(tr("Interpreter"));
     QRadioButton* vu0_interpreter_checkbox = new QRadioButton(tr("Interpreter"));
     QRadioButton* vu1_interpreter_checkbox = new QRadioButton(tr("Interpreter"));
+    QRadioButton* iop_interpreter_checkbox = new QRadioButton(tr("Interpreter"));
     QRadioButton* light_theme_checkbox = new QRadioButton(tr("Light Theme"));
     QRadioButton*  darktheme_checkbox = new QRadioButton(tr("Dark Theme"));
 
@@ -31,6 +33,7 @@ GeneralTab::GeneralTab(QWidget* parent)
     bool ee_jit = Settings::instance().ee_jit_enabled;
     bool vu0_jit = Settings::instance().vu0_jit_enabled;
     bool vu1_jit = Settings::instance().vu1_jit_enabled;
+    bool iop_jit = Settings::instance().iop_jit_enabled;
     bool l_theme = Settings::instance().l_theme;
     bool d_theme = Settings::instance().d_theme;
 
@@ -42,6 +45,8 @@ GeneralTab::GeneralTab(QWidget* parent)
     vu0_interpreter_checkbox->setChecked(!vu0_jit);
     vu1_jit_checkbox->setChecked(vu1_jit);
     vu1_interpreter_checkbox->setChecked(!vu1_jit);
+    iop_jit_checkbox->setChecked(iop_jit);
+    iop_interpreter_checkbox->setChecked(!iop_jit);
 
     connect(ee_jit_checkbox, &QRadioButton::clicked, this, [=]() {
         Settings::instance().ee_jit_enabled = true;
@@ -66,6 +71,14 @@ GeneralTab::GeneralTab(QWidget* parent)
     connect(vu1_interpreter_checkbox, &QRadioButton::clicked, this, [=]() {
         Settings::instance().vu1_jit_enabled = false;
     });
+
+    connect(iop_jit_checkbox, &QRadioButton::clicked, this, [=]() {
+        Settings::instance().iop_jit_enabled = true;
+    });
+
+    connect(iop_interpreter_checkbox, &QRadioButton::clicked, this, [=]() {
+        Settings::instance().iop_jit_enabled = false;
+    });
     connect(light_theme_checkbox, &QRadioButton::clicked, this, [=]() {
         Settings::instance().l_theme = true;
         Settings::instance().d_theme = false;
@@ -80,6 +93,7 @@ GeneralTab::GeneralTab(QWidget* parent)
         bool ee_jit_enabled = Settings::instance().ee_jit_enabled;
         bool vu0_jit_enabled = Settings::instance().vu0_jit_enabled;
         bool vu1_jit_enabled = Settings::instance().vu1_jit_enabled;
+        bool iop_jit_enabled = Settings::instance().iop_jit_enabled;
         bool  l_theme =Settings::instance().l_theme;
         bool  d_theme =Settings::instance().d_theme;
         ee_jit_checkbox->setChecked(ee_jit_enabled);
@@ -88,6 +102,8 @@ GeneralTab::GeneralTab(QWidget* parent)
         vu0_interpreter_checkbox->setChecked(!vu0_jit_enabled);
         vu1_jit_checkbox->setChecked(vu1_jit_enabled);
         vu1_interpreter_checkbox->setChecked(!vu1_jit_enabled);
+        iop_jit_checkbox->setChecked(iop_jit_enabled);
+        iop_interpreter_checkbox->setChecked(!iop_jit_enabled);
         light_theme_checkbox->setChecked(l_theme);
         darktheme_checkbox->setChecked(d_theme);
     });
@@ -114,6 +130,13 @@ GeneralTab::GeneralTab(QWidget* parent)
     QGroupBox* vu1_groupbox = new QGroupBox(tr("VU1"));
     vu1_groupbox->setLayout(vu1_layout);
 
+    QVBoxLayout* iop_layout = new QVBoxLayout;
+    iop_layout->addWidget(iop_jit_checkbox);
+    iop_layout->addWidget(iop_interpreter_checkbox);
+
+    QGroupBox* iop_groupbox = new QGroupBox(tr("IOP"));
+    iop_groupbox->setLayout(iop_layout);
+
     QVBoxLayout* ee_layout = new QVBoxLayout;
     ee_layout->addWidget(ee_jit_checkbox);
     ee_layout->addWidget(ee_interpreter_checkbox);
@@ -125,6 +148,7 @@ GeneralTab::GeneralTab(QWidget* parent)
     layout->addWidget(ee_groupbox);
     layout->addWidget(vu0_groupbox);
     layout->addWidget(vu1_groupbox);
+    layout->addWidget(iop_groupbox);
     layout->addWidget(theme_group);
     layout->addStretch(1);
 
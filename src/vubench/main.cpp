@@ -0,0 +1,344 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../core/emulator.hpp"
+#include "../core/errors.hpp"
+#include "../core/ee/vu_jit.hpp"
+
+using namespace std;
+
+/**
+ * Standalone benchmark for VU microprograms.
+ *
+ * A VU image is the state of a single VU (registers, pipelines, micro and data memory) captured out of
+ * a regular save state, along with the address the program should be started from.
+ * "run" executes the program repeatedly through the interpreter and the JIT and reports the emulated
+ * VU cycles per second of each, as well as JIT compile cost. Results can be saved as a baseline file
+ * and compared against on later runs.
+ *
+ * data/transform.vu is a synthetic VU1 image that runs 256 vectors through a 4x4 matrix with LQI, MULA/MADDA and
+ * SQI. Its instructions are spaced so that nothing stalls, so the interpreter and JIT must agree exactly on both
+ * cycles and registers. data/transform.baseline holds its results from one machine, as an example for --baseline.
+ **/
+
+const char IMAGE_MAGIC[8] = {'D', 'O', 'B', 'I', 'E', 'V', 'U', '\0'};
+const uint32_t IMAGE_VERSION = 1;
+
+//Upper bound for a single run, in case the program waits on something that isn't emulated here
+const uint64_t MAX_RUN_CYCLES = 50000000;
+
+struct ImageHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t vu_id;
+    uint32_t start_PC;
+    uint64_t state_size;
+};
+
+struct RunResult
+{
+    uint64_t cycles_per_run;
+    double seconds_per_run;
+    double first_run_seconds;
+};
+
+typedef map<string, double> Baseline;
+
+static void print_usage()
+{
+    printf("Usage:\n");
+    printf("  vubench capture <save state> <vu id> <start PC> <image>\n");
+    printf("  vubench run <image> [-n iterations] [--baseline <file>] [--save-baseline <file>]\n");
+}
+
+static double now_seconds()
+{
+    using namespace chrono;
+    return duration_cast<duration<double>>(steady_clock::now().time_since_epoch()).count();
+}
+
+static int capture(const char* state_name, int vu_id, uint32_t start_PC, const char* image_name)
+{
+    //Too large for the stack
+    unique_ptr<Emulator> e(new Emulator());
+    e->reset();
+    e->load_state(state_name);
+
+    ofstream image(image_name, ios::binary);
+    if (!image.is_open())
+    {
+        fprintf(stderr, "Failed to open %s for writing\n", image_name);
+        return 1;
+    }
+
+    ImageHeader header;
+    memcpy(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+    header.version = IMAGE_VERSION;
+    header.vu_id = vu_id;
+    header.start_PC = start_PC;
+    header.state_size = 0;
+    image.write((char*)&header, sizeof(header));
+
+    e->get_vu(vu_id).save_state(image);
+
+    header.state_size = (uint64_t)image.tellp() - sizeof(header);
+    image.seekp(0);
+    image.write((char*)&header, sizeof(header));
+    image.close();
+
+    printf("Captured VU%d with start PC $%04X to %s\n", vu_id, start_PC, image_name);
+    return 0;
+}
+
+static bool read_header(const char* image_name, ImageHeader& header)
+{
+    ifstream image(image_name, ios::binary);
+    if (!image.is_open())
+    {
+        fprintf(stderr, "Failed to open %s\n", image_name);
+        return false;
+    }
+
+    image.read((char*)&header, sizeof(header));
+    if (!image || memcmp(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) || header.version != IMAGE_VERSION)
+    {
+        fprintf(stderr, "%s is not a VU image\n", image_name);
+        return false;
+    }
+    return true;
+}
+
+//Restores the captured VU and starts the program. Returns false if the image no longer matches the VU's state layout.
+static bool load_image(const char* image_name, const ImageHeader& header, VectorUnit& vu)
+{
+    ifstream image(image_name, ios::binary);
+    image.seekg(sizeof(header));
+    vu.load_state(image);
+
+    if (!image || (uint64_t)image.tellg() - sizeof(header) != header.state_size)
+        return false;
+
+    vu.stop();
+    vu.start_program(header.start_PC, 0);
+    return true;
+}
+
+static bool run_program(const char* image_name, const ImageHeader& header, VectorUnit& vu, bool jit, uint64_t& cycles)
+{
+    if (!load_image(image_name, header, vu))
+        return false;
+
+    cycles = vu.run_standalone(jit, MAX_RUN_CYCLES);
+    if (vu.is_running())
+        fprintf(stderr, "Warning: program did not finish within %llu cycles\n", (unsigned long long)MAX_RUN_CYCLES);
+    return true;
+}
+
+static bool benchmark(const char* image_name, const ImageHeader& header, VectorUnit& vu, bool jit,
+                      int iterations, RunResult& result)
+{
+    uint64_t cycles;
+
+    //The first run pays for JIT compilation or for filling the interpreter's decode cache
+    double start = now_seconds();
+    if (!run_program(image_name, header, vu, jit, cycles))
+        return false;
+    result.first_run_seconds = now_seconds() - start;
+    result.cycles_per_run = cycles;
+
+    //Loading the image is kept out of the timed section
+    double total = 0.0;
+    for (int i = 0; i < iterations; i++)
+    {
+        if (!load_image(image_name, header, vu))
+            return false;
+        start = now_seconds();
+        vu.run_standalone(jit, MAX_RUN_CYCLES);
+        total += now_seconds() - start;
+    }
+    result.seconds_per_run = total / iterations;
+    return true;
+}
+
+static void snapshot_regs(VectorUnit& vu, vector<uint32_t>& regs)
+{
+    regs.clear();
+    for (int i = 0; i < 32; i++)
+    {
+        for (int j = 0; j < 4; j++)
+            regs.push_back(vu.get_gpr_u(i, j));
+    }
+    for (int i = 0; i < 16; i++)
+        regs.push_back(vu.get_int(i));
+}
+
+static bool load_baseline(const char* name, Baseline& baseline)
+{
+    ifstream file(name);
+    if (!file.is_open())
+        return false;
+
+    string key;
+    double value;
+    while (file >> key >> value)
+        baseline[key] = value;
+    return true;
+}
+
+static void save_baseline(const char* name, const Baseline& results)
+{
+    ofstream file(name);
+    for (auto& result : results)
+        file << result.first << " " << result.second << "\n";
+}
+
+static void print_comparison(const Baseline& results, const Baseline& baseline)
+{
+    printf("\nCompared to baseline:\n");
+    for (auto& result : results)
+    {
+        auto it = baseline.find(result.first);
+        if (it == baseline.end() || it->second == 0.0)
+            continue;
+        double change = (result.second - it->second) / it->second * 100.0;
+        printf("  %-24s %12.3f -> %12.3f (%+.1f%%)\n", result.first.c_str(), it->second, result.second, change);
+    }
+}
+
+static int run(const char* image_name, int iterations, const char* baseline_name, const char* save_name)
+{
+    ImageHeader header;
+    if (!read_header(image_name, header))
+        return 1;
+
+    unique_ptr<Emulator> e(new Emulator());
+    e->reset();
+    VectorUnit& vu = e->get_vu(header.vu_id);
+
+    RunResult interpreter, jit;
+    vector<uint32_t> interpreter_regs, jit_regs;
+
+    if (!benchmark(image_name, header, vu, false, iterations, interpreter))
+    {
+        fprintf(stderr, "%s was captured with a different VU state layout, recapture it\n", image_name);
+        return 1;
+    }
+    snapshot_regs(vu, interpreter_regs);
+
+    VU_JIT::reset(&vu);
+    if (!benchmark(image_name, header, vu, true, iterations, jit))
+    {
+        fprintf(stderr, "Failed to reload %s for the JIT runs\n", image_name);
+        return 1;
+    }
+    snapshot_regs(vu, jit_regs);
+
+    size_t block_count, code_size;
+    VU_JIT::get_cache_usage(&vu, block_count, code_size);
+
+    double interpreter_mhz = (double)interpreter.cycles_per_run / interpreter.seconds_per_run / 1000000.0;
+    double jit_mhz = (double)jit.cycles_per_run / jit.seconds_per_run / 1000000.0;
+    double compile_ms = (jit.first_run_seconds - jit.seconds_per_run) * 1000.0;
+
+    printf("VU%d program at $%04X, %d iterations\n\n", header.vu_id, header.start_PC, iterations);
+    printf("  %-12s %12s %14s %12s\n", "", "cycles/run", "us/run", "VU MHz");
+    printf("  %-12s %12llu %14.2f %12.3f\n", "interpreter", (unsigned long long)interpreter.cycles_per_run,
+           interpreter.seconds_per_run * 1000000.0, interpreter_mhz);
+    printf("  %-12s %12llu %14.2f %12.3f\n", "jit", (unsigned long long)jit.cycles_per_run,
+           jit.seconds_per_run * 1000000.0, jit_mhz);
+    printf("\n  JIT compile time: %.3f ms (first run minus a warm run)\n", compile_ms);
+    printf("  JIT blocks: %zu, code size: %zu bytes\n", block_count, code_size);
+
+    if (interpreter.cycles_per_run != jit.cycles_per_run)
+        printf("\nWarning: the interpreter and JIT disagree on the cycle count\n");
+    if (interpreter_regs != jit_regs)
+        printf("\nWarning: the interpreter and JIT ended with different register contents\n");
+
+    Baseline results;
+    results["interpreter_mhz"] = interpreter_mhz;
+    results["jit_mhz"] = jit_mhz;
+    results["jit_compile_ms"] = compile_ms;
+    results["jit_code_size"] = (double)code_size;
+
+    if (baseline_name)
+    {
+        Baseline baseline;
+        if (load_baseline(baseline_name, baseline))
+            print_comparison(results, baseline);
+        else
+            fprintf(stderr, "Failed to open baseline %s\n", baseline_name);
+    }
+
+    if (save_name)
+        save_baseline(save_name, results);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        print_usage();
+        return 1;
+    }
+
+    try
+    {
+        if (!strcmp(argv[1], "capture"))
+        {
+            if (argc != 6)
+            {
+                print_usage();
+                return 1;
+            }
+            int vu_id = atoi(argv[3]) ? 1 : 0;
+            uint32_t start_PC = (uint32_t)strtoul(argv[4], nullptr, 0);
+            return capture(argv[2], vu_id, start_PC, argv[5]);
+        }
+
+        if (!strcmp(argv[1], "run"))
+        {
+            int iterations = 100;
+            const char* baseline_name = nullptr;
+            const char* save_name = nullptr;
+            for (int i = 3; i < argc; i++)
+            {
+                if (!strcmp(argv[i], "-n") && i + 1 < argc)
+                    iterations = atoi(argv[++i]);
+                else if (!strcmp(argv[i], "--baseline") && i + 1 < argc)
+                    baseline_name = argv[++i];
+                else if (!strcmp(argv[i], "--save-baseline") && i + 1 < argc)
+                    save_name = argv[++i];
+                else
+                {
+                    print_usage();
+                    return 1;
+                }
+            }
+            if (iterations < 1)
+                iterations = 1;
+            return run(argv[2], iterations, baseline_name, save_name);
+        }
+    }
+    catch (non_fatal_error& err)
+    {
+        fprintf(stderr, "%s\n", err.what());
+        return 1;
+    }
+    catch (Emulation_error& err)
+    {
+        fprintf(stderr, "Emulation error: %s\n", err.what());
+        return 1;
+    }
+
+    print_usage();
+    return 1;
+}